@@ -0,0 +1,167 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#include "stdafx.h"
+#include "AmplitudePyramid.h"
+
+#include <math.h>
+
+// ----------------------------------------------------------------------------
+// RMS of equal length points (a short final point counts as a full one)
+//
+static AmplitudeLevel mergeLevels( const AmplitudeLevel* points, size_t count )
+{
+    AmplitudeLevel merged = { 32767, -32768, 0 };
+    double power = 0.0;
+
+    for ( size_t i=0; i < count; i++ ) {
+        merged.min_sample = min( merged.min_sample, points[i].min_sample );
+        merged.max_sample = max( merged.max_sample, points[i].max_sample );
+        power += (double)points[i].rms * points[i].rms;
+    }
+
+    if ( count == 0 )
+        merged.min_sample = merged.max_sample = 0;
+    else
+        merged.rms = (uint16_t)min( 32767.0, sqrt( power / count ) + 0.5 );
+
+    return merged;
+}
+
+// ----------------------------------------------------------------------------
+//
+AmplitudePyramid::AmplitudePyramid( UINT sample_rate ) :
+    m_frames_per_point( (sample_rate * AMPLITUDE_BASE_MS) / 1000 )
+{
+    m_pending.reset();
+}
+
+// ----------------------------------------------------------------------------
+//
+void AmplitudePyramid::addFrames( const int16_t* block, UINT frames, SimdLevel simd )
+{
+    STUDIO_ASSERT( m_frames_per_point > 0, "Amplitude pyramid has no sample rate" );
+
+    while ( frames > 0 ) {
+        UINT pending_frames = (UINT)(m_pending.count / 2);
+        UINT count = min( frames, m_frames_per_point - pending_frames );
+
+        accumulateLevels( block, count * 2, m_pending, simd );
+
+        block = &block[ count * 2 ];
+        frames -= count;
+
+        if ( pending_frames + count == m_frames_per_point )
+            finish();
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+void AmplitudePyramid::finish( void )
+{
+    if ( m_pending.count == 0 )
+        return;
+
+    AmplitudeLevel point;
+    point.min_sample = m_pending.min_sample;
+    point.max_sample = m_pending.max_sample;
+    point.rms = (uint16_t)min( 32767.0, sqrt( (double)m_pending.squares / m_pending.count ) + 0.5 );
+
+    addPoint( point );
+
+    m_pending.reset();
+}
+
+// ----------------------------------------------------------------------------
+// Every second point at a level completes a point at the level above
+//
+void AmplitudePyramid::addPoint( const AmplitudeLevel& point )
+{
+    AmplitudeLevel carry = point;
+
+    for ( size_t level=0; ; level++ ) {
+        if ( level == m_levels.size() )
+            m_levels.push_back( AmplitudeLevelArray() );
+
+        AmplitudeLevelArray& points = m_levels[level];
+
+        points.push_back( carry );
+
+        if ( (points.size() % 2) != 0 )
+            break;
+
+        carry = mergeLevels( &points[points.size()-2], 2 );
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+void AmplitudePyramid::startAt( DWORD start_ms )
+{
+    AmplitudeLevel silence = { 0, 0, 0 };
+
+    while ( getBase().size() < start_ms / AMPLITUDE_BASE_MS )
+        addPoint( silence );
+}
+
+// ----------------------------------------------------------------------------
+//
+void AmplitudePyramid::setBase( const AmplitudeLevel* points, size_t count )
+{
+    m_levels.clear();
+    m_pending.reset();
+
+    for ( size_t i=0; i < count; i++ )
+        addPoint( points[i] );
+}
+
+// ----------------------------------------------------------------------------
+//
+void AmplitudePyramid::getRange( DWORD start_ms, DWORD end_ms, UINT points, AmplitudeLevel* levels ) const
+{
+    if ( points == 0 )
+        return;
+
+    double span_ms = (end_ms > start_ms ? end_ms - start_ms : 0) / (double)points;
+
+    // Coarsest level whose points are no longer than an output point
+    size_t level = 0;
+    while ( level+1 < m_levels.size() && ((double)(AMPLITUDE_BASE_MS << (level+1))) <= span_ms )
+        level++;
+
+    static const AmplitudeLevelArray empty;
+    const AmplitudeLevelArray& source = m_levels.empty() ? empty : m_levels[level];
+    double point_ms = (double)(AMPLITUDE_BASE_MS << level);
+
+    for ( UINT i=0; i < points; i++ ) {
+        double from_ms = start_ms + i * span_ms;
+        size_t first = (size_t)(from_ms / point_ms);
+        size_t last = max( first+1, (size_t)ceil( (from_ms + span_ms) / point_ms ) );
+
+        first = min( first, source.size() );
+        last = min( last, source.size() );
+
+        levels[i] = mergeLevels( source.data() + first, last - first );
+    }
+}
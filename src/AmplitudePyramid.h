@@ -0,0 +1,80 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#pragma once
+
+#include "stdafx.h"
+#include "MusicPlayerApi.h"
+#include "AnalyzerKernels.h"
+
+typedef std::vector<AmplitudeLevel> AmplitudeLevelArray;
+
+// Min/max/RMS amplitude at AMPLITUDE_BASE_MS with every coarser power of two resolution
+// above it.  Levels are built as base points arrive so a range can be read at any zoom
+// while the track is still being analyzed.
+//
+class AmplitudePyramid
+{
+    UINT                        m_frames_per_point;     // Base point length (0 when loaded from the cache)
+    SampleLevels                m_pending;              // Base point being accumulated
+    std::vector<AmplitudeLevelArray> m_levels;          // m_levels[n] points are AMPLITUDE_BASE_MS << n long
+
+public:
+    AmplitudePyramid( UINT sample_rate=0 );
+
+    // Interleaved stereo frames
+    void addFrames( const int16_t* block, UINT frames, SimdLevel simd=getSimdLevel() );
+
+    // Closes any partial base point
+    void finish( void );
+
+    // Pads the base with silent points up to start_ms (analysis starting mid track)
+    void startAt( DWORD start_ms );
+
+    // Rebuilds all levels from saved base points
+    void setBase( const AmplitudeLevel* points, size_t count );
+
+    inline const AmplitudeLevelArray& getBase( void ) const {
+        static const AmplitudeLevelArray empty;
+        return m_levels.empty() ? empty : m_levels[0];
+    }
+
+    inline size_t getLevelCount( void ) const {
+        return m_levels.size();
+    }
+
+    // Points held by every level together
+    inline size_t getPointCount( void ) const {
+        size_t count = 0;
+        for ( const AmplitudeLevelArray& level : m_levels )
+            count += level.size();
+        return count;
+    }
+
+    // Fills points levels evenly covering start_ms to end_ms from the coarsest level 
+    // that still resolves them.  Each output merges at most three points.
+    void getRange( DWORD start_ms, DWORD end_ms, UINT points, AmplitudeLevel* levels ) const;
+
+private:
+    void addPoint( const AmplitudeLevel& point );
+};
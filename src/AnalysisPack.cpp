@@ -0,0 +1,937 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+#include "stdafx.h"
+#include "AnalysisPack.h"
+
+#include <io.h>
+
+#define PACK_MAGIC              "DMXP"
+#define PACK_RECORD_MAGIC       "PREC"
+#define PACK_INDEX_MAGIC        "DMXI"
+#define PACK_VERSION            1
+#define PACK_INDEX_VERSION      2                       // 2 adds slot flags
+#define PACK_ALIGN              8
+
+struct PackFileHeader {
+    char        magic[4];
+    UINT        version;
+    ULONGLONG   reserved;
+};
+
+// Followed by the encoded analysis, padded to PACK_ALIGN
+struct PackRecordHeader {
+    char        magic[4];
+    UINT        size;
+    ULONGLONG   key;
+};
+
+// ----------------------------------------------------------------------------
+//
+AnalysisPackWorker::AnalysisPackWorker( AnalysisPack* pack ) :
+    Threadable( "AnalysisPackWorker" ),
+    m_pack( pack )
+{
+}
+
+// ----------------------------------------------------------------------------
+//
+UINT AnalysisPackWorker::run(void)
+{
+    try {
+        if ( m_pack->hasLooseFiles() )
+            m_pack->importFiles( this );
+    }
+    catch ( std::exception& ex ) {
+        log( ex );
+    }
+
+    while ( isRunning() ) {
+        ::WaitForSingleObject( m_wake, PACK_COMPACT_WAKE_MS );
+
+        try {
+            m_pack->flushWrites();
+
+            if ( isRunning() && m_pack->needsCompaction() )
+                m_pack->compact();
+        }
+        catch ( std::exception& ex ) {
+            log( ex );
+        }
+    }
+
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+//
+AnalysisPack::AnalysisPack() :
+    m_pack_file( NULL ),
+    m_loose_files( false ),
+    m_worker( this ),
+    m_pending_version( 0 )
+{
+}
+
+// ----------------------------------------------------------------------------
+//
+AnalysisPack::~AnalysisPack()
+{
+    close();
+}
+
+// ----------------------------------------------------------------------------
+// FNV-1a (0 marks an empty slot)
+//
+ULONGLONG AnalysisPack::makeKey( LPCSTR link )
+{
+    ULONGLONG key = 14695981039346656037ULL;
+
+    while ( *link ) {
+        key ^= (BYTE)*link++;
+        key *= 1099511628211ULL;
+    }
+
+    return key != 0 ? key : 1;
+}
+
+// ----------------------------------------------------------------------------
+//
+size_t AnalysisPack::recordBytes( UINT size )
+{
+    return (sizeof(PackRecordHeader) + size + PACK_ALIGN - 1) & ~(size_t)(PACK_ALIGN - 1);
+}
+
+// ----------------------------------------------------------------------------
+// Index flags for encoded analysis
+//
+UINT AnalysisPack::recordFlags( const BYTE* contents, size_t size )
+{
+    return isTrackAnalysisFileComplete( contents, size ) ? PACK_SLOT_COMPLETE : 0;
+}
+
+// ----------------------------------------------------------------------------
+//
+bool AnalysisPack::open( LPCSTR directory )
+{
+    close();
+
+    CSingleLock flush_lock( &m_flush_lock, TRUE );
+    CSingleLock lock( &m_lock, TRUE );
+
+    m_directory = directory;
+    m_pack_filename.Format( "%s\\%s", directory, ANALYSIS_PACK_FILE );
+    m_index_filename.Format( "%s\\%s", directory, ANALYSIS_INDEX_FILE );
+
+    CString pattern;
+    pattern.Format( "%s\\*.analyze", directory );
+
+    m_loose_files = m_loose_index.scan( pattern ) > 0;
+
+    return openFiles();
+}
+
+// ----------------------------------------------------------------------------
+//
+void AnalysisPack::close( void )
+{
+    stopWorker();
+
+    CSingleLock flush_lock( &m_flush_lock, TRUE );
+    CSingleLock lock( &m_lock, TRUE );
+
+    closeFiles();
+}
+
+// ----------------------------------------------------------------------------
+//
+void AnalysisPack::startWorker( void )
+{
+    if ( isOpen() )
+        m_worker.startThread();
+}
+
+// ----------------------------------------------------------------------------
+//
+void AnalysisPack::stopWorker( void )
+{
+    m_worker.stopThread();
+
+    flushWrites();
+}
+
+// ----------------------------------------------------------------------------
+// A pack that is not one of ours is moved aside and a new one started.  One that cannot 
+// be mapped is left alone (analysis is not saved this session).
+//
+bool AnalysisPack::openFiles( void )
+{
+    if ( GetFileAttributes( m_pack_filename ) == INVALID_FILE_ATTRIBUTES ) {
+        FILE* hFile = _fsopen( m_pack_filename, "wb", _SH_DENYWR );
+        if ( hFile == NULL ) {
+            log( "Unable to create track analysis pack %s", (LPCSTR)m_pack_filename );
+            return false;
+        }
+
+        PackFileHeader header;
+        memset( &header, 0, sizeof(header) );
+        memcpy( header.magic, PACK_MAGIC, sizeof(header.magic) );
+        header.version = PACK_VERSION;
+
+        size_t written = fwrite( &header, sizeof(header), 1, hFile );
+        fclose( hFile );
+
+        if ( written != 1 ) {
+            log( "Unable to create track analysis pack %s", (LPCSTR)m_pack_filename );
+            DeleteFile( m_pack_filename );
+            return false;
+        }
+
+        DeleteFile( m_index_filename );
+    }
+
+    m_pack_file = _fsopen( m_pack_filename, "r+b", _SH_DENYWR );
+    if ( m_pack_file == NULL ) {
+        log( "Unable to open track analysis pack %s", (LPCSTR)m_pack_filename );
+        return false;
+    }
+
+    bool too_short = _filelengthi64( _fileno( m_pack_file ) ) < (__int64)sizeof(PackFileHeader);
+
+    if ( !too_short && !m_pack.open( m_pack_filename, false, PACK_VIEW_BYTES ) ) {
+        log( "Unable to map track analysis pack %s (error %lu)", (LPCSTR)m_pack_filename, GetLastError() );
+        closeFiles();
+        return false;
+    }
+
+    const PackFileHeader* header = too_short ? NULL :
+        reinterpret_cast<const PackFileHeader*>( m_pack.getRange( 0, sizeof(PackFileHeader) ) );
+
+    if ( header == NULL || memcmp( header->magic, PACK_MAGIC, 4 ) != 0 || header->version != PACK_VERSION ) {
+        log( "Track analysis pack %s is not valid and has been set aside", (LPCSTR)m_pack_filename );
+
+        closeFiles();
+
+        if ( !MoveFileEx( m_pack_filename, m_pack_filename + ".bad", MOVEFILE_REPLACE_EXISTING ) )
+            return false;
+
+        return openFiles();
+    }
+
+    if ( !m_index.open( m_index_filename, true ) || !checkIndex() ) {
+        log_status( "Rebuilding track analysis index %s", (LPCSTR)m_index_filename );
+
+        if ( !rebuildIndex() ) {
+            closeFiles();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+//
+void AnalysisPack::closeFiles( void )
+{
+    m_index.close();
+    m_pack.close();
+
+    if ( m_pack_file != NULL ) {
+        fclose( m_pack_file );
+        m_pack_file = NULL;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// The index must describe exactly the pack as it is on disk
+//
+bool AnalysisPack::checkIndex( void )
+{
+    if ( m_index.getSize() < sizeof(PackIndexHeader) )
+        return false;
+
+    const PackIndexHeader* header = getIndexHeader();
+
+    return memcmp( header->magic, PACK_INDEX_MAGIC, 4 ) == 0 &&
+           header->version == PACK_INDEX_VERSION &&
+           header->slot_count > 0 &&
+           m_index.getSize() == sizeof(PackIndexHeader) + (size_t)header->slot_count * sizeof(PackIndexSlot) &&
+           header->pack_size == m_pack.getSize();
+}
+
+// ----------------------------------------------------------------------------
+// Later records for a track supersede earlier ones.  A damaged tail (a record that was
+// never completely written) is cut off.
+//
+bool AnalysisPack::rebuildIndex( void )
+{
+    std::map<CString, PackIndexSlot> records;
+    ULONGLONG size = m_pack.getSize();
+    ULONGLONG offset = sizeof(PackFileHeader);
+    ULONGLONG dead_bytes = 0;
+
+    while ( offset + sizeof(PackRecordHeader) <= size ) {
+        const PackRecordHeader* record = reinterpret_cast<const PackRecordHeader*>( m_pack.getRange( offset, sizeof(PackRecordHeader) ) );
+
+        if ( record == NULL || memcmp( record->magic, PACK_RECORD_MAGIC, 4 ) != 0 || offset + recordBytes( record->size ) > size )
+            break;
+
+        UINT record_size = record->size;
+
+        record = reinterpret_cast<const PackRecordHeader*>( m_pack.getRange( offset, recordBytes( record_size ) ) );
+        if ( record == NULL ) {
+            log( "Unable to map track analysis pack %s at %I64u bytes", (LPCSTR)m_pack_filename, offset );
+            return false;
+        }
+
+        LPCSTR link = getTrackAnalysisLink( reinterpret_cast<const BYTE*>( &record[1] ), record->size );
+        if ( link == NULL )
+            break;
+
+        PackIndexSlot& slot = records[ link ];
+
+        if ( slot.key != 0 )
+            dead_bytes += recordBytes( slot.size );
+
+        slot.key = record->key;
+        slot.offset = offset;
+        slot.size = record->size;
+        slot.flags = recordFlags( reinterpret_cast<const BYTE*>( &record[1] ), record->size );
+
+        offset += recordBytes( record->size );
+    }
+
+    if ( offset < size ) {
+        log( "Track analysis pack %s is damaged after %I64u bytes", (LPCSTR)m_pack_filename, offset );
+
+        m_pack.close();
+
+        if ( _chsize_s( _fileno( m_pack_file ), offset ) != 0 || !m_pack.open( m_pack_filename, false, PACK_VIEW_BYTES ) )
+            return false;
+    }
+
+    PackIndexSlotArray slots;
+
+    for ( auto const& it : records )
+        slots.push_back( it.second );
+
+    return writeIndex( slots, offset, dead_bytes ) && replaceIndex();
+}
+
+// ----------------------------------------------------------------------------
+// Writes a table sized for the slots to the temporary index file (replaceIndex puts
+// it in place)
+//
+bool AnalysisPack::writeIndex( const PackIndexSlotArray& slots, ULONGLONG pack_size, ULONGLONG dead_bytes )
+{
+    UINT slot_count = PACK_MIN_SLOTS;
+
+    while ( (ULONGLONG)(slots.size() + 1) * 100 >= (ULONGLONG)slot_count * PACK_MAX_LOAD_PERCENT )
+        slot_count *= 2;
+
+    std::vector<BYTE> contents( sizeof(PackIndexHeader) + (size_t)slot_count * sizeof(PackIndexSlot), 0 );
+
+    PackIndexHeader* header = reinterpret_cast<PackIndexHeader*>( &contents[0] );
+    PackIndexSlot* table = reinterpret_cast<PackIndexSlot*>( &contents[sizeof(PackIndexHeader)] );
+
+    memcpy( header->magic, PACK_INDEX_MAGIC, sizeof(header->magic) );
+    header->version = PACK_INDEX_VERSION;
+    header->slot_count = slot_count;
+    header->used_slots = (UINT)slots.size();
+    header->pack_size = pack_size;
+    header->dead_bytes = dead_bytes;
+
+    for ( const PackIndexSlot& slot : slots ) {
+        UINT index = (UINT)(slot.key % slot_count);
+
+        while ( table[index].key != 0 )
+            index = (index + 1) % slot_count;
+
+        table[index] = slot;
+        header->live_bytes += recordBytes( slot.size );
+    }
+
+    CString temp_filename = m_index_filename + ".tmp";
+
+    FILE* hFile = _fsopen( temp_filename, "wb", _SH_DENYWR );
+    if ( hFile == NULL ) {
+        log( "Unable to write track analysis index %s", (LPCSTR)temp_filename );
+        return false;
+    }
+
+    size_t written = fwrite( &contents[0], 1, contents.size(), hFile );
+
+    if ( fclose( hFile ) != 0 || written != contents.size() ) {
+        log( "Unable to write track analysis index %s", (LPCSTR)temp_filename );
+        DeleteFile( temp_filename );
+        return false;
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Swaps in the index written by writeIndex and maps it (caller holds m_lock)
+//
+bool AnalysisPack::replaceIndex( void )
+{
+    CString temp_filename = m_index_filename + ".tmp";
+
+    m_index.close();
+
+    if ( !MoveFileEx( temp_filename, m_index_filename, MOVEFILE_REPLACE_EXISTING ) ) {
+        log( "Unable to replace track analysis index %s (error %lu)", (LPCSTR)m_index_filename, GetLastError() );
+        DeleteFile( temp_filename );
+        return false;
+    }
+
+    return m_index.open( m_index_filename, true );
+}
+
+// ----------------------------------------------------------------------------
+// The writer holds m_flush_lock so the index cannot change while the larger one is
+// written.  The lock is only held to copy the slots and swap the files.
+//
+bool AnalysisPack::growIndex( void )
+{
+    PackIndexSlotArray slots;
+    ULONGLONG pack_size, dead_bytes;
+
+    {
+        CSingleLock lock( &m_lock, TRUE );
+
+        if ( !isOpen() )
+            return false;
+
+        getSlots( slots );
+
+        pack_size = getIndexHeader()->pack_size;
+        dead_bytes = getIndexHeader()->dead_bytes;
+    }
+
+    if ( !writeIndex( slots, pack_size, dead_bytes ) )
+        return false;
+
+    CSingleLock lock( &m_lock, TRUE );
+
+    return replaceIndex();
+}
+
+// ----------------------------------------------------------------------------
+//
+void AnalysisPack::getSlots( PackIndexSlotArray& slots )
+{
+    const PackIndexSlot* table = getIndexSlots();
+    UINT slot_count = getIndexHeader()->slot_count;
+
+    for ( UINT index=0; index < slot_count; index++ )
+        if ( table[index].key != 0 )
+            slots.push_back( table[index] );
+}
+
+// ----------------------------------------------------------------------------
+// The encoded analysis of a slot's record, valid until the next record is read.  Records
+// appended since the pack was mapped are mapped on first use.
+//
+const BYTE* AnalysisPack::getRecord( const PackIndexSlot& slot )
+{
+    ULONGLONG end = slot.offset + recordBytes( slot.size );
+
+    if ( end > m_pack.getSize() ) {
+        if ( !m_pack.open( m_pack_filename, false, PACK_VIEW_BYTES ) || end > m_pack.getSize() )
+            return NULL;
+    }
+
+    const PackRecordHeader* record = reinterpret_cast<const PackRecordHeader*>( m_pack.getRange( slot.offset, recordBytes( slot.size ) ) );
+
+    if ( record == NULL || memcmp( record->magic, PACK_RECORD_MAGIC, 4 ) != 0 || record->size != slot.size )
+        return NULL;
+
+    return reinterpret_cast<const BYTE*>( &record[1] );
+}
+
+// ----------------------------------------------------------------------------
+// Linear probe from the link's key.  The 64-bit key alone identifies the track, so a 
+// lookup never reads the pack.  With insert, returns the empty slot that ends the probe 
+// when the link is not found.
+//
+PackIndexSlot* AnalysisPack::findSlot( LPCSTR link, bool insert )
+{
+    PackIndexSlot* table = getIndexSlots();
+    UINT slot_count = getIndexHeader()->slot_count;
+    ULONGLONG key = makeKey( link );
+    UINT index = (UINT)(key % slot_count);
+
+    while ( table[index].key != 0 ) {
+        if ( table[index].key == key )
+            return &table[index];
+
+        index = (index + 1) % slot_count;
+    }
+
+    return insert ? &table[index] : NULL;
+}
+
+// ----------------------------------------------------------------------------
+//
+bool AnalysisPack::contains( LPCSTR link )
+{
+    {
+        CSingleLock lock( &m_pending_lock, TRUE );
+
+        if ( m_pending.find( link ) != m_pending.end() )
+            return true;
+    }
+
+    CSingleLock lock( &m_lock, TRUE );
+
+    return isOpen() && findSlot( link, false ) != NULL;
+}
+
+// ----------------------------------------------------------------------------
+//
+bool AnalysisPack::isComplete( LPCSTR link )
+{
+    {
+        CSingleLock lock( &m_pending_lock, TRUE );
+
+        PendingPackWriteMap::iterator it = m_pending.find( link );
+        if ( it != m_pending.end() )
+            return (recordFlags( &it->second.m_contents[0], it->second.m_contents.size() ) & PACK_SLOT_COMPLETE) != 0;
+    }
+
+    CSingleLock lock( &m_lock, TRUE );
+
+    if ( !isOpen() )
+        return false;
+
+    PackIndexSlot* slot = findSlot( link, false );
+
+    return slot != NULL && (slot->flags & PACK_SLOT_COMPLETE) != 0;
+}
+
+// ----------------------------------------------------------------------------
+//
+bool AnalysisPack::read( LPCSTR link, TrackAnalysisData& analysis )
+{
+    {
+        CSingleLock lock( &m_pending_lock, TRUE );
+
+        PendingPackWriteMap::iterator it = m_pending.find( link );
+        if ( it != m_pending.end() )
+            return decodeTrackAnalysis( &it->second.m_contents[0], it->second.m_contents.size(), analysis );
+    }
+
+    std::vector<BYTE> contents;
+
+    {
+        CSingleLock lock( &m_lock, TRUE );
+
+        if ( !isOpen() )
+            return false;
+
+        PackIndexSlot* slot = findSlot( link, false );
+        if ( slot == NULL )
+            return false;
+
+        const BYTE* record = getRecord( *slot );
+        if ( record == NULL ) {
+            log( "Track analysis for %s is missing from %s", link, (LPCSTR)m_pack_filename );
+            return false;
+        }
+
+        contents.assign( record, record + slot->size );
+    }
+
+    // The key matched; a different link would be a hash collision
+    LPCSTR record_link = getTrackAnalysisLink( &contents[0], contents.size() );
+    if ( record_link == NULL || strcmp( record_link, link ) != 0 )
+        return false;
+
+    return decodeTrackAnalysis( &contents[0], contents.size(), analysis );
+}
+
+// ----------------------------------------------------------------------------
+// Goes through the queue so an earlier queued write for the track cannot land after it
+//
+bool AnalysisPack::write( const TrackAnalysisData& analysis )
+{
+    addPendingWrite( analysis );
+
+    return flushWrites();
+}
+
+// ----------------------------------------------------------------------------
+//
+bool AnalysisPack::queueWrite( const TrackAnalysisData& analysis )
+{
+    addPendingWrite( analysis );
+
+    if ( !m_worker.isRunning() )
+        return flushWrites();
+
+    m_worker.wake();
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Replaces analysis queued earlier for the track
+//
+void AnalysisPack::addPendingWrite( const TrackAnalysisData& analysis )
+{
+    std::vector<BYTE> contents;
+    encodeTrackAnalysis( analysis, contents );
+
+    CSingleLock lock( &m_pending_lock, TRUE );
+
+    PendingPackWrite& pending = m_pending[ analysis.m_info->link ];
+    pending.m_contents.swap( contents );
+    pending.m_version = ++m_pending_version;
+}
+
+// ----------------------------------------------------------------------------
+// A queued write stays readable until the index points to its record.  Analysis that
+// cannot be written is dropped (and logged).
+//
+bool AnalysisPack::flushWrites( void )
+{
+    CSingleLock flush_lock( &m_flush_lock, TRUE );
+
+    bool written = true;
+
+    while ( true ) {
+        CString link;
+        std::vector<BYTE> contents;
+        UINT version;
+
+        {
+            CSingleLock lock( &m_pending_lock, TRUE );
+
+            if ( m_pending.empty() )
+                break;
+
+            PendingPackWriteMap::iterator it = m_pending.begin();
+
+            link = it->first;
+            contents = it->second.m_contents;
+            version = it->second.m_version;
+        }
+
+        if ( !writeRecord( link, contents ) )
+            written = false;
+
+        CSingleLock lock( &m_pending_lock, TRUE );
+
+        PendingPackWriteMap::iterator it = m_pending.find( link );
+        if ( it != m_pending.end() && it->second.m_version == version )
+            m_pending.erase( it );
+    }
+
+    return written;
+}
+
+// ----------------------------------------------------------------------------
+// The record is appended before the index points to it, so a failed write leaves the 
+// previous analysis in place.  The caller holds m_flush_lock, which keeps the pack file 
+// and the index to this writer; m_lock is only held to read the pack size and publish 
+// the record, so readers never wait on the write.
+//
+bool AnalysisPack::writeRecord( LPCSTR link, const std::vector<BYTE>& contents )
+{
+    PackRecordHeader record;
+    memset( &record, 0, sizeof(record) );
+    memcpy( record.magic, PACK_RECORD_MAGIC, sizeof(record.magic) );
+    record.size = (UINT)contents.size();
+    record.key = makeKey( link );
+
+    BYTE padding[PACK_ALIGN] = { 0 };
+    size_t pad = recordBytes( record.size ) - sizeof(record) - record.size;
+
+    ULONGLONG offset;
+    bool full;
+
+    {
+        CSingleLock lock( &m_lock, TRUE );
+
+        if ( !isOpen() )
+            return false;
+
+        const PackIndexHeader* header = getIndexHeader();
+
+        offset = header->pack_size;
+        full = (ULONGLONG)(header->used_slots + 1) * 100 >= (ULONGLONG)header->slot_count * PACK_MAX_LOAD_PERCENT;
+    }
+
+    if ( full && !growIndex() )
+        return false;
+
+    if ( _fseeki64( m_pack_file, offset, SEEK_SET ) != 0 ||
+         fwrite( &record, sizeof(record), 1, m_pack_file ) != 1 ||
+         fwrite( &contents[0], 1, contents.size(), m_pack_file ) != contents.size() ||
+         fwrite( padding, 1, pad, m_pack_file ) != pad ||
+         fflush( m_pack_file ) != 0 ) {
+        log( "Unable to write track analysis for %s to %s", link, (LPCSTR)m_pack_filename );
+        _chsize_s( _fileno( m_pack_file ), offset );
+        return false;
+    }
+
+    CSingleLock lock( &m_lock, TRUE );
+
+    if ( !isOpen() )
+        return false;
+
+    PackIndexHeader* header = getIndexHeader();
+    PackIndexSlot* slot = findSlot( link, true );
+
+    if ( slot->key != 0 ) {
+        header->live_bytes -= recordBytes( slot->size );
+        header->dead_bytes += recordBytes( slot->size );
+    }
+    else
+        header->used_slots++;
+
+    slot->key = record.key;
+    slot->offset = offset;
+    slot->size = record.size;
+    slot->flags = recordFlags( &contents[0], contents.size() );
+
+    header->live_bytes += recordBytes( record.size );
+    header->pack_size = offset + recordBytes( record.size );
+
+    if ( header->dead_bytes >= PACK_COMPACT_MIN_BYTES && header->dead_bytes >= header->live_bytes )
+        m_worker.wake();
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Analysis already in the pack was saved after the loose file and wins.  Files that 
+// cannot be read stay where they are.
+//
+UINT AnalysisPack::importFiles( Threadable* worker )
+{
+    CString pattern;
+    pattern.Format( "%s\\*.analyze", (LPCSTR)m_directory );
+
+    WIN32_FIND_DATA find_data;
+    HANDLE hFind = FindFirstFile( pattern, &find_data );
+    if ( hFind == INVALID_HANDLE_VALUE ) {
+        m_loose_files = false;
+        return 0;
+    }
+
+    UINT imported = 0, failed = 0;
+    bool stopped = false;
+
+    do {
+        if ( worker != NULL && !worker->isRunning() ) {
+            stopped = true;
+            break;
+        }
+
+        if ( find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY )
+            continue;
+
+        CString filename;
+        filename.Format( "%s\\%s", (LPCSTR)m_directory, find_data.cFileName );
+
+        TrackAnalysisData analysis;
+
+        if ( readTrackAnalysisFile( filename, analysis ) && (contains( analysis.m_info->link ) || write( analysis )) ) {
+            DeleteFile( filename );
+            m_loose_index.remove( filename );
+            imported++;
+        }
+        else
+            failed++;
+
+        freeTrackAnalysisData( analysis );
+    }
+    while ( FindNextFile( hFind, &find_data ) );
+
+    FindClose( hFind );
+
+    if ( !stopped && failed == 0 )
+        m_loose_files = false;
+
+    log_status( "Imported %u track analysis files into %s (%u failed)", imported, (LPCSTR)m_pack_filename, failed );
+
+    return imported;
+}
+
+// ----------------------------------------------------------------------------
+//
+bool AnalysisPack::hasLooseFile( LPCSTR link )
+{
+    return m_loose_files && m_loose_index.contains( makeTrackAnalysisFileName( m_directory, link ) );
+}
+
+// ----------------------------------------------------------------------------
+//
+bool AnalysisPack::needsCompaction( void )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    if ( !isOpen() )
+        return false;
+
+    const PackIndexHeader* header = getIndexHeader();
+
+    return header->dead_bytes >= PACK_COMPACT_MIN_BYTES && header->dead_bytes >= header->live_bytes;
+}
+
+// ----------------------------------------------------------------------------
+// Records never change once written, so the live records at the start are copied 
+// without any lock.  m_flush_lock then holds off writers while the records saved 
+// meanwhile are copied and the new index written; m_lock is only held to swap the files.
+//
+bool AnalysisPack::compact( void )
+{
+    PackIndexSlotArray snapshot;
+    ULONGLONG snapshot_size;
+
+    {
+        CSingleLock lock( &m_lock, TRUE );
+
+        if ( !isOpen() )
+            return false;
+
+        getSlots( snapshot );
+        snapshot_size = getIndexHeader()->pack_size;
+    }
+
+    MappedFile source;
+
+    if ( !source.open( m_pack_filename, false, PACK_VIEW_BYTES ) || source.getSize() < snapshot_size )
+        return false;
+
+    CString compact_filename = m_pack_filename + ".compact";
+
+    FILE* hFile = _fsopen( compact_filename, "wb", _SH_DENYWR );
+    if ( hFile == NULL ) {
+        log( "Unable to create %s", (LPCSTR)compact_filename );
+        return false;
+    }
+
+    std::map<ULONGLONG, ULONGLONG> moved;                  // Old record offset to new
+    ULONGLONG position = sizeof(PackFileHeader);
+
+    const BYTE* file_header = source.getRange( 0, sizeof(PackFileHeader) );
+
+    bool ok = file_header != NULL && fwrite( file_header, sizeof(PackFileHeader), 1, hFile ) == 1;
+
+    for ( const PackIndexSlot& slot : snapshot ) {
+        size_t bytes = recordBytes( slot.size );
+
+        if ( !ok )
+            break;
+
+        const BYTE* record = source.getRange( slot.offset, bytes );
+
+        ok = record != NULL && fwrite( record, 1, bytes, hFile ) == bytes;
+
+        moved[slot.offset] = position;
+        position += bytes;
+    }
+
+    CSingleLock flush_lock( &m_flush_lock, TRUE );
+
+    PackIndexSlotArray slots;
+    ULONGLONG old_size = 0;
+
+    {
+        CSingleLock lock( &m_lock, TRUE );
+
+        if ( isOpen() ) {
+            getSlots( slots );
+            old_size = getIndexHeader()->pack_size;
+        }
+        else
+            ok = false;
+    }
+
+    // Records saved since the snapshot lie beyond the source's size
+    if ( ok && old_size > source.getSize() )
+        ok = source.open( m_pack_filename, false, PACK_VIEW_BYTES ) && source.getSize() >= old_size;
+
+    ULONGLONG live_bytes = 0;
+
+    for ( PackIndexSlot& slot : slots ) {
+        size_t bytes = recordBytes( slot.size );
+
+        if ( !ok )
+            break;
+
+        live_bytes += bytes;
+
+        std::map<ULONGLONG, ULONGLONG>::iterator it = moved.find( slot.offset );
+        if ( it != moved.end() ) {
+            slot.offset = it->second;
+            continue;
+        }
+
+        const BYTE* record = source.getRange( slot.offset, bytes );
+
+        ok = record != NULL && fwrite( record, 1, bytes, hFile ) == bytes;
+
+        slot.offset = position;
+        position += bytes;
+    }
+
+    source.close();
+
+    if ( fclose( hFile ) != 0 )
+        ok = false;
+
+    if ( ok )
+        ok = writeIndex( slots, position, position - sizeof(PackFileHeader) - live_bytes );
+
+    if ( !ok ) {
+        log( "Unable to compact track analysis pack %s", (LPCSTR)m_pack_filename );
+        DeleteFile( compact_filename );
+        return false;
+    }
+
+    CSingleLock lock( &m_lock, TRUE );
+
+    closeFiles();
+
+    if ( !MoveFileEx( compact_filename, m_pack_filename, MOVEFILE_REPLACE_EXISTING ) ) {
+        log( "Unable to replace %s (error %lu)", (LPCSTR)m_pack_filename, GetLastError() );
+        DeleteFile( compact_filename );
+        DeleteFile( m_index_filename + ".tmp" );
+        openFiles();
+        return false;
+    }
+
+    // An index left behind no longer matches the pack and is rebuilt by openFiles
+    if ( !MoveFileEx( m_index_filename + ".tmp", m_index_filename, MOVEFILE_REPLACE_EXISTING ) )
+        log( "Unable to replace track analysis index %s (error %lu)", (LPCSTR)m_index_filename, GetLastError() );
+
+    bool reopened = openFiles();
+
+    log_status( "Compacted track analysis pack %s from %I64u to %I64u bytes", (LPCSTR)m_pack_filename, old_size, position );
+
+    return reopened;
+}
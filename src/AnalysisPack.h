@@ -0,0 +1,200 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+#pragma once
+
+#include "stdafx.h"
+#include "Threadable.h"
+#include "MappedFile.h"
+#include "CacheFileIndex.h"
+#include "TrackAnalysisFile.h"
+
+#define ANALYSIS_PACK_FILE          "analysis.pack"
+#define ANALYSIS_INDEX_FILE         "analysis.index"
+
+#define PACK_MIN_SLOTS              1024
+#define PACK_MAX_LOAD_PERCENT       70                  // Index is grown beyond this
+#define PACK_COMPACT_MIN_BYTES      (4*1024*1024)       // Superseded bytes before compaction is worth it
+#define PACK_COMPACT_WAKE_MS        1000
+#define PACK_VIEW_BYTES             (64*1024*1024)      // Pack records are mapped this much at a time
+
+#define PACK_SLOT_COMPLETE          0x0001              // The record covers the whole track
+
+// Index slot (key 0 is an empty slot)
+struct PackIndexSlot {
+    ULONGLONG   key;                                    // Hash of the track link
+    ULONGLONG   offset;                                 // Record in the pack
+    UINT        size;                                   // Encoded analysis bytes
+    UINT        flags;                                  // PACK_SLOT_*
+};
+
+struct PackIndexHeader {
+    char        magic[4];
+    UINT        version;
+    UINT        slot_count;
+    UINT        used_slots;
+    ULONGLONG   pack_size;                              // Pack size the index describes
+    ULONGLONG   live_bytes;                             // Records the index points to
+    ULONGLONG   dead_bytes;                             // Superseded records
+};
+
+typedef std::vector<PackIndexSlot> PackIndexSlotArray;
+
+// Encoded analysis waiting for the worker to write it
+struct PendingPackWrite {
+    std::vector<BYTE>   m_contents;
+    UINT                m_version;                      // Tells a rewrite queued during the write
+};
+
+typedef std::map<CString, PendingPackWrite> PendingPackWriteMap;
+
+class AnalysisPack;
+
+// Imports loose analysis files once, then writes queued analysis and compacts the pack
+// whenever enough of it has been superseded
+//
+class AnalysisPackWorker : public Threadable
+{
+    AnalysisPack*               m_pack;
+    CEvent                      m_wake;
+
+    UINT run(void);
+
+public:
+    AnalysisPackWorker( AnalysisPack* pack );
+
+    inline void wake( void ) {
+        m_wake.SetEvent();
+    }
+};
+
+// All saved track analysis in one append-only file.  Each record is the binary analysis
+// file for one track; saving a track again appends a new record and supersedes the old 
+// one.  The index is an open addressing hash table of 64-bit link keys in a file of its 
+// own.  The index is mapped whole and the pack through a PACK_VIEW_BYTES window (it can 
+// outgrow the address space), so contains() is a probe of the index alone and read() adds 
+// a read of mapped memory.
+//
+// An index that does not describe the whole pack (a crash between append and index 
+// update) is rebuilt by scanning the pack.  Compaction copies the live records to a new
+// pack on the worker thread.
+//
+// Writers (and compaction) are serialised by m_flush_lock, which owns the pack file and 
+// the index; m_lock guards the mappings readers use and is never held across file writes.
+//
+// Queued writes are held in memory (and read from there) until the worker writes them.
+// Only the latest analysis queued for a track is written.
+//
+class AnalysisPack
+{
+    CCriticalSection            m_lock;
+    CString                     m_directory;
+    CString                     m_pack_filename;
+    CString                     m_index_filename;
+
+    FILE*                       m_pack_file;            // Appends
+    MappedFile                  m_pack;                 // Records (windowed, reopened when a record lies beyond it)
+    MappedFile                  m_index;
+
+    std::atomic<bool>           m_loose_files;          // Analysis files not yet imported
+    CacheFileIndex              m_loose_index;          // Which tracks they are for
+    AnalysisPackWorker          m_worker;
+
+    CCriticalSection            m_pending_lock;
+    PendingPackWriteMap         m_pending;              // Latest queued analysis of each track
+    UINT                        m_pending_version;
+    CCriticalSection            m_flush_lock;           // One writer at a time keeps each track's records in order (taken before m_lock)
+
+public:
+    AnalysisPack();
+    ~AnalysisPack();
+
+    bool open( LPCSTR directory );
+    void close( void );
+
+    inline bool isOpen( void ) const {
+        return m_pack_file != NULL && m_index.isOpen();
+    }
+
+    // Import, queued writes and compaction run while the worker is started.  Stopping
+    // the worker writes anything still queued.
+    void startWorker( void );
+    void stopWorker( void );
+
+    bool contains( LPCSTR link );
+
+    // The saved analysis covers the whole track (answered from the index)
+    bool isComplete( LPCSTR link );
+    bool read( LPCSTR link, TrackAnalysisData& analysis );
+
+    // Returns once the analysis is written
+    bool write( const TrackAnalysisData& analysis );
+
+    // Returns once the analysis is encoded; the worker writes it (written at once if 
+    // the worker is not started)
+    bool queueWrite( const TrackAnalysisData& analysis );
+
+    bool flushWrites( void );
+
+    // Loose analysis files remain in the directory (from before the pack)
+    inline bool hasLooseFiles( void ) const {
+        return m_loose_files;
+    }
+
+    // The track has a loose analysis file (answered from memory)
+    bool hasLooseFile( LPCSTR link );
+
+    // Moves loose analysis files (binary or JSON) into the pack.  Returns the number imported
+    // (stops early if the worker is stopped).
+    UINT importFiles( Threadable* worker=NULL );
+
+    bool needsCompaction( void );
+    bool compact( void );
+
+private:
+    static ULONGLONG makeKey( LPCSTR link );
+    static size_t recordBytes( UINT size );
+
+    void addPendingWrite( const TrackAnalysisData& analysis );
+    bool writeRecord( LPCSTR link, const std::vector<BYTE>& contents );
+    static UINT recordFlags( const BYTE* contents, size_t size );
+
+    inline PackIndexHeader* getIndexHeader( void ) const {
+        return reinterpret_cast<PackIndexHeader*>( m_index.getWritableData() );
+    }
+
+    inline PackIndexSlot* getIndexSlots( void ) const {
+        return reinterpret_cast<PackIndexSlot*>( &m_index.getWritableData()[sizeof(PackIndexHeader)] );
+    }
+
+    bool openFiles( void );
+    void closeFiles( void );
+    bool checkIndex( void );
+    bool rebuildIndex( void );
+    bool writeIndex( const PackIndexSlotArray& slots, ULONGLONG pack_size, ULONGLONG dead_bytes );
+    bool replaceIndex( void );
+    bool growIndex( void );
+    void getSlots( PackIndexSlotArray& slots );
+
+    const BYTE* getRecord( const PackIndexSlot& slot );
+    PackIndexSlot* findSlot( LPCSTR link, bool insert );
+};
@@ -0,0 +1,151 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#include "stdafx.h"
+#include "AnalysisStream.h"
+
+// ----------------------------------------------------------------------------
+//
+AnalysisStream::AnalysisStream() :
+    m_published( 0 ),
+    m_track_start( 0 )
+{
+    for ( UINT i=0; i < ANALYSIS_STREAM_FRAMES; i++ )
+        m_slots[i].m_sequence.store( 0, std::memory_order_relaxed );
+
+    for ( UINT i=0; i < MAX_ANALYSIS_SUBSCRIBERS; i++ ) {
+        m_subscribers[i].m_active.store( false, std::memory_order_relaxed );
+        m_subscribers[i].m_next = 0;
+        m_subscribers[i].m_dropped_frames.store( 0, std::memory_order_relaxed );
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+void AnalysisStream::publish( const AnalysisFrame& frame )
+{
+    ULONGLONG number = m_published.load( std::memory_order_relaxed );
+    AnalysisStreamSlot& slot = m_slots[ number % ANALYSIS_STREAM_FRAMES ];
+
+    slot.m_sequence.store( 0, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+
+    slot.m_frame = frame;
+
+    slot.m_sequence.store( number + 1, std::memory_order_release );
+    m_published.store( number + 1, std::memory_order_release );
+}
+
+// ----------------------------------------------------------------------------
+//
+void AnalysisStream::startTrack( void )
+{
+    m_track_start.store( m_published.load( std::memory_order_relaxed ), std::memory_order_release );
+}
+
+// ----------------------------------------------------------------------------
+//
+int AnalysisStream::subscribe( void )
+{
+    for ( int id=0; id < MAX_ANALYSIS_SUBSCRIBERS; id++ ) {
+        AnalysisSubscriber& subscriber = m_subscribers[id];
+        bool expected = false;
+
+        if ( !subscriber.m_active.load( std::memory_order_relaxed ) ) {
+            subscriber.m_next = m_published.load( std::memory_order_acquire );
+            subscriber.m_dropped_frames.store( 0, std::memory_order_relaxed );
+
+            if ( subscriber.m_active.compare_exchange_strong( expected, true, std::memory_order_acq_rel ) )
+                return id;
+        }
+    }
+
+    return -1;
+}
+
+// ----------------------------------------------------------------------------
+//
+void AnalysisStream::unsubscribe( int subscriber )
+{
+    if ( subscriber >= 0 && subscriber < MAX_ANALYSIS_SUBSCRIBERS )
+        m_subscribers[subscriber].m_active.store( false, std::memory_order_release );
+}
+
+// ----------------------------------------------------------------------------
+//
+ULONG AnalysisStream::getDroppedFrames( int subscriber ) const
+{
+    if ( subscriber < 0 || subscriber >= MAX_ANALYSIS_SUBSCRIBERS )
+        return 0;
+
+    return m_subscribers[subscriber].m_dropped_frames.load( std::memory_order_relaxed );
+}
+
+// ----------------------------------------------------------------------------
+//
+UINT AnalysisStream::read( int subscriber_id, AnalysisFrame* frames, UINT max_frames, DWORD position_ms )
+{
+    if ( subscriber_id < 0 || subscriber_id >= MAX_ANALYSIS_SUBSCRIBERS )
+        return 0;
+
+    AnalysisSubscriber& subscriber = m_subscribers[subscriber_id];
+    if ( !subscriber.m_active.load( std::memory_order_acquire ) )
+        return 0;
+
+    ULONGLONG track_start = m_track_start.load( std::memory_order_acquire );
+    if ( subscriber.m_next < track_start )
+        subscriber.m_next = track_start;
+
+    UINT count = 0;
+
+    while ( count < max_frames ) {
+        ULONGLONG published = m_published.load( std::memory_order_acquire );
+
+        if ( subscriber.m_next >= published )
+            break;
+
+        if ( published - subscriber.m_next > ANALYSIS_STREAM_FRAMES ) {
+            ULONGLONG oldest = published - ANALYSIS_STREAM_FRAMES;
+            subscriber.m_dropped_frames.fetch_add( (ULONG)(oldest - subscriber.m_next), std::memory_order_relaxed );
+            subscriber.m_next = oldest;
+        }
+
+        const AnalysisStreamSlot& slot = m_slots[ subscriber.m_next % ANALYSIS_STREAM_FRAMES ];
+
+        // Copy, then confirm the producer did not start over the slot while we did
+        ULONGLONG sequence = slot.m_sequence.load( std::memory_order_acquire );
+        AnalysisFrame frame = slot.m_frame;
+        std::atomic_thread_fence( std::memory_order_acquire );
+
+        if ( sequence != subscriber.m_next + 1 || slot.m_sequence.load( std::memory_order_relaxed ) != sequence )
+            continue;                               // Overwritten - the lapped check above moves us on
+
+        if ( frame.time_ms > position_ms )
+            break;                                  // Not heard yet
+
+        frames[count++] = frame;
+        subscriber.m_next++;
+    }
+
+    return count;
+}
@@ -0,0 +1,92 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#pragma once
+
+#include "stdafx.h"
+#include "MusicPlayerApi.h"
+#include "AudioFrameBuffer.h"
+#include "AudioSink.h"
+
+#define ANALYSIS_STREAM_FRAMES      1024            // About 20s of frames (see TrackAnalyzer.h)
+#define MAX_ANALYSIS_SUBSCRIBERS    8
+
+// One published frame.  The sequence is written last so a reader can tell a complete
+// frame from one the producer is overwriting.
+struct AnalysisStreamSlot {
+    std::atomic<ULONGLONG>  m_sequence;             // Frame number + 1 (0 while being written)
+    AnalysisFrame           m_frame;
+};
+
+// Read cursor for one subscriber, padded to its own cache line
+struct AnalysisSubscriber {
+    std::atomic<bool>       m_active;
+    ULONGLONG               m_next;                 // Next frame number to read (subscriber only)
+    std::atomic<ULONG>      m_dropped_frames;       // Frames overwritten before they were read
+    BYTE                    m_pad[AUDIO_CACHE_LINE_SIZE];
+};
+
+// Single producer (the AnalysisWorker running the track analyzer) / multiple subscriber
+// broadcast ring of live analysis frames.  Neither side takes a lock: the producer never
+// waits, and a subscriber that falls more than ANALYSIS_STREAM_FRAMES behind loses the 
+// oldest frames.
+//
+// Frames are analyzed as audio is delivered, which is ahead of what is heard by up to the
+// delivered audio ring plus the device buffer.  A read returns only frames at or before the
+// caller's render position and leaves later frames queued, so subscribers see each frame
+// as it plays.  The ring must hold that backlog or frames are overwritten before they play.
+//
+class AnalysisStream
+{
+    AnalysisStreamSlot      m_slots[ANALYSIS_STREAM_FRAMES];
+
+    BYTE                    m_pad0[AUDIO_CACHE_LINE_SIZE];
+    std::atomic<ULONGLONG>  m_published;            // Frames published (producer only)
+    std::atomic<ULONGLONG>  m_track_start;          // First frame of the current track
+    BYTE                    m_pad1[AUDIO_CACHE_LINE_SIZE];
+    AnalysisSubscriber      m_subscribers[MAX_ANALYSIS_SUBSCRIBERS];
+
+    AnalysisStream(AnalysisStream& other) {}
+    AnalysisStream& operator=(AnalysisStream& rhs) { return *this; }
+
+public:
+    AnalysisStream();
+
+    // Producer
+    void publish( const AnalysisFrame& frame );
+
+    // Subscribers skip anything left from the previous track.  Call while nothing is 
+    // publishing.
+    void startTrack( void );
+
+    // Returns a subscriber id or -1 if all are in use.  New subscribers start at the next 
+    // frame published.
+    int subscribe( void );
+    void unsubscribe( int subscriber );
+
+    // Copies up to max_frames frames with time_ms <= position_ms.  Only the subscriber's
+    // own thread may read.
+    UINT read( int subscriber, AnalysisFrame* frames, UINT max_frames, DWORD position_ms );
+
+    ULONG getDroppedFrames( int subscriber ) const;
+};
@@ -0,0 +1,320 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#include "stdafx.h"
+#include "AnalysisWorker.h"
+#include "TrackTimer.h"
+
+// ----------------------------------------------------------------------------
+//
+AnalysisWorker::AnalysisWorker( SpotifyEngine* engine, TrackTimer* timer ) :
+    m_engine( engine ),
+    m_timer( timer ),
+    m_stream( NULL ),
+    m_policy( ANALYSIS_BLOCK ),
+    m_reader( -1 ),
+    m_reader_dropped( 0 ),
+    m_analyzer( NULL ),
+    m_publish_beats( false ),
+    m_load_beats( false ),
+    m_finishing( NULL ),
+    m_finishing_frames( 0 ),
+    m_dropped_frames( 0 ),
+    m_degraded_frames( 0 ),
+    Threadable( "AnalysisWorker" )
+{
+}
+
+// ----------------------------------------------------------------------------
+//
+AnalysisWorker::~AnalysisWorker()
+{
+    detach();
+
+    for ( TrackAnalyzer* analyzer : m_finished )
+        delete analyzer;
+}
+
+// ----------------------------------------------------------------------------
+//
+void AnalysisWorker::attach( AudioOutputStream* stream, AnalysisBackpressure policy )
+{
+    detach();
+
+    m_reader = stream->addRingReader( policy == ANALYSIS_BLOCK ? READER_BLOCKING : READER_DROP_LAGGING );
+    STUDIO_ASSERT( m_reader != -1, "Track analysis has no ring buffer reader available" );
+
+    m_stream = stream;
+    m_policy = policy;
+    m_reader_dropped = 0;
+    m_dropped_frames = m_degraded_frames = 0;
+
+    bool started = startThread();
+
+    STUDIO_ASSERT( started, "Track analysis cannot start thread" );
+}
+
+// ----------------------------------------------------------------------------
+//
+void AnalysisWorker::detach( void )
+{
+    if ( m_stream == NULL )
+        return;
+
+    stopThread();
+
+    discardBacklog();
+
+    if ( getDroppedFrames() > 0 || getDegradedFrames() > 0 )
+        log_status( "Track analysis dropped %lu and degraded %lu lagging frames", getDroppedFrames(), getDegradedFrames() );
+
+    m_stream->removeRingReader( m_reader );
+    m_stream = NULL;
+    m_reader = -1;
+}
+
+// ----------------------------------------------------------------------------
+//
+void AnalysisWorker::setAnalyzer( TrackAnalyzer* analyzer, bool saved_beats )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    m_analyzer = analyzer;
+    m_publish_beats = analyzer != NULL && !saved_beats;
+    m_load_beats = analyzer != NULL && saved_beats;
+
+    if ( m_load_beats )
+        notify();
+}
+
+// ----------------------------------------------------------------------------
+// Loading may read the analysis pack, so it is done without m_lock.  Live beats found 
+// meanwhile are held by the analyzer until they are published.
+//
+void AnalysisWorker::loadSavedBeats( void )
+{
+    CString link;
+
+    {
+        CSingleLock lock( &m_lock, TRUE );
+
+        if ( !m_load_beats )
+            return;
+
+        link = m_analyzer->getLink();
+        m_load_beats = false;
+    }
+
+    BeatArray beats;
+
+    if ( m_engine->getSavedBeats( link, beats ) ) {
+        m_timer->setBeats( link, beats );
+        return;
+    }
+
+    CSingleLock lock( &m_lock, TRUE );
+
+    if ( m_analyzer != NULL && link == m_analyzer->getLink() )
+        m_publish_beats = true;
+}
+
+// ----------------------------------------------------------------------------
+//
+// Everything in the ring past our cursor (and anything skipped over) is the ended track's
+// until the next track starts delivering
+//
+void AnalysisWorker::finishTrack( void )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    if ( m_analyzer == NULL )
+        return;
+
+    // Only one track finishes at a time; it has had the time the following track played
+    if ( m_finishing != NULL )
+        completeFinishing();
+
+    ULONG skipped = ( m_stream != NULL ) ? takeReaderDrops() : 0;
+    if ( skipped > 0 )
+        m_analyzer->addData( skipped, NULL );
+
+    m_finishing = m_analyzer;
+    m_finishing->setLiveStream( NULL );                 // The live stream moves on to the next track
+    m_finishing_frames = ( m_stream != NULL ) ? m_stream->getRingBacklog( m_reader ) : 0;
+    m_analyzer = NULL;
+    m_publish_beats = m_load_beats = false;
+
+    if ( m_finishing_frames == 0 )
+        completeFinishing();
+    else
+        notify();
+}
+
+// ----------------------------------------------------------------------------
+//
+void AnalysisWorker::discardBacklog( void )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    if ( m_finishing != NULL )
+        completeFinishing();
+}
+
+// ----------------------------------------------------------------------------
+//
+TrackAnalyzer* AnalysisWorker::takeFinished( void )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    if ( m_finished.empty() )
+        return NULL;
+
+    TrackAnalyzer* analyzer = m_finished.front();
+    m_finished.pop_front();
+
+    return analyzer;
+}
+
+// ----------------------------------------------------------------------------
+// Called with m_lock held
+//
+void AnalysisWorker::completeFinishing( void )
+{
+    m_finishing->finishData();
+    m_finished.push_back( m_finishing );
+
+    m_finishing = NULL;
+    m_finishing_frames = 0;
+}
+
+// ----------------------------------------------------------------------------
+// Skipped frames were the ended track's first.  Called with m_lock held.
+//
+void AnalysisWorker::addSkipped( ULONG skipped )
+{
+    if ( m_finishing != NULL && skipped > 0 ) {
+        ULONG frames = min( skipped, m_finishing_frames );
+
+        m_finishing->addData( frames, NULL );
+        m_finishing_frames -= frames;
+        skipped -= frames;
+    }
+
+    if ( skipped > 0 && m_analyzer != NULL )
+        m_analyzer->addData( skipped, NULL );
+}
+
+// ----------------------------------------------------------------------------
+//
+UINT AnalysisWorker::run(void)
+{
+    while ( isRunning() ) {
+        ::WaitForSingleObject( m_wake, ANALYSIS_WAKE_MS );
+
+        try {
+            loadSavedBeats();
+
+            while ( isRunning() && analyzeChunk() )
+                ;
+        }
+        catch ( std::exception& ex ) {
+            log( ex );
+        }
+    }
+
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+// Frames the ring skipped us past since the last call
+//
+ULONG AnalysisWorker::takeReaderDrops( void )
+{
+    ULONG dropped = m_stream->getRingDroppedFrames( m_reader );
+    ULONG skipped = dropped - m_reader_dropped;
+
+    m_reader_dropped = dropped;
+    m_dropped_frames.fetch_add( skipped, std::memory_order_relaxed );
+
+    return skipped;
+}
+
+// ----------------------------------------------------------------------------
+// Analyzes the frames in place in the ring.  Returns false once caught up.
+//
+bool AnalysisWorker::analyzeChunk( void )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    addSkipped( takeReaderDrops() );
+
+    if ( m_finishing != NULL && m_finishing_frames == 0 )
+        completeFinishing();
+
+    // An ended track's frames come first
+    TrackAnalyzer* analyzer = ( m_finishing != NULL ) ? m_finishing : m_analyzer;
+    UINT chunk = ( m_finishing != NULL ) ? min( (ULONG)ANALYSIS_CHUNK_FRAMES, m_finishing_frames ) : ANALYSIS_CHUNK_FRAMES;
+
+    AudioFrameSpans spans;
+    UINT frames = m_stream->peekRing( m_reader, chunk, spans );
+    if ( frames == 0 ) {
+        if ( m_finishing != NULL )                      // The ring was emptied under it
+            completeFinishing();
+        return false;
+    }
+
+    if ( analyzer != NULL ) {
+        if ( m_policy == ANALYSIS_DEGRADE ) {
+            bool degraded = m_stream->getRingBacklog( m_reader ) > ANALYSIS_DEGRADE_FRAMES;
+
+            analyzer->setDegraded( degraded );
+            if ( degraded )
+                m_degraded_frames.fetch_add( frames, std::memory_order_relaxed );
+        }
+
+        analyzer->addData( spans );
+
+        if ( analyzer == m_finishing )
+            m_finishing_frames -= frames;
+        else if ( m_publish_beats ) {
+            m_new_beats.clear();
+            m_analyzer->takeNewBeats( m_new_beats );
+
+            if ( m_new_beats.size() > 0 )
+                m_timer->addBeats( m_analyzer->getLink(), m_new_beats );
+        }
+    }
+
+    // A lagging skip while we worked covers the frames just analyzed and possibly more
+    if ( !m_stream->consumeRing( m_reader, frames ) ) {
+        ULONG skipped = takeReaderDrops();
+
+        if ( skipped > frames )
+            addSkipped( skipped - frames );
+    }
+
+    if ( m_finishing != NULL && m_finishing_frames == 0 )
+        completeFinishing();
+
+    return true;
+}
@@ -0,0 +1,122 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#pragma once
+
+#include "stdafx.h"
+#include "Threadable.h"
+#include "AudioOutputStream.h"
+#include "TrackAnalyzer.h"
+
+#define ANALYSIS_CHUNK_FRAMES       4410            // Most frames analyzed per pass (100ms)
+#define ANALYSIS_DEGRADE_FRAMES     (44100*2)       // Backlog at which ANALYSIS_DEGRADE reduces resolution
+#define ANALYSIS_WAKE_MS            50
+
+class TrackTimer;
+class SpotifyEngine;
+
+typedef std::list<TrackAnalyzer*> TrackAnalyzerList;
+
+// Analyzes delivered audio on its own thread through a read cursor on the output
+// stream's ring, so music delivery only copies frames into the ring and returns.
+//
+// The backpressure policy picks the cursor type: ANALYSIS_BLOCK holds delivery back
+// (the ring fills to the slowest blocking reader) while ANALYSIS_DROP and ANALYSIS_DEGRADE
+// are skipped ahead when they lag.  Skipped audio is analyzed as silence so the track
+// timeline stays intact.
+//
+// When a track ends its analyzer is handed back to the worker, which works through the
+// track's frames still in the ring before the next track's and then finishes it.
+//
+// A track with complete saved analysis has its saved beats loaded for the timer here
+// rather than on the engine thread as it starts.
+//
+class AnalysisWorker : public Threadable
+{
+    SpotifyEngine*              m_engine;               // Loads saved beats
+    TrackTimer*                 m_timer;                // Receives live or saved beats
+    AudioOutputStream*          m_stream;               // Primary stream (NULL when detached)
+    AnalysisBackpressure        m_policy;
+    int                         m_reader;               // Our cursor in the stream's ring
+    ULONG                       m_reader_dropped;       // Ring drops already analyzed as silence
+
+    CCriticalSection            m_lock;                 // Held while the analyzer is in use
+    TrackAnalyzer*              m_analyzer;             // Current track's analyzer (not owned)
+    bool                        m_publish_beats;        // Pass live beats to the timer
+    bool                        m_load_beats;           // Pass the analyzer's saved beats to the timer
+    BeatArray                   m_new_beats;
+    TrackAnalyzer*              m_finishing;            // Ended track's analyzer (owned)
+    ULONG                       m_finishing_frames;     // Its frames still to analyze (they are next in the ring)
+    TrackAnalyzerList           m_finished;             // Finished analyzers for takeFinished() (owned)
+
+    CEvent                      m_wake;
+
+    std::atomic<ULONG>          m_dropped_frames;
+    std::atomic<ULONG>          m_degraded_frames;
+
+    UINT run(void);
+
+public:
+    AnalysisWorker( SpotifyEngine* engine, TrackTimer* timer );
+    ~AnalysisWorker();
+
+    void attach( AudioOutputStream* stream, AnalysisBackpressure policy );
+    void detach( void );
+
+    // Frames delivered from now on belong to this analyzer (NULL stops analysis).  Returns
+    // once the worker has let go of any previous analyzer.  With saved_beats the timer gets
+    // the track's saved beats (or live ones if none were saved).
+    void setAnalyzer( TrackAnalyzer* analyzer, bool saved_beats );
+
+    // Takes ownership of the current analyzer and finishes its data once the frames already
+    // delivered for it are analyzed, without waiting.  Frames delivered from now on are not
+    // analyzed until setAnalyzer().
+    void finishTrack( void );
+
+    // Delivered frames are about to be discarded - an ended track's analyzer finishes with
+    // what it has analyzed
+    void discardBacklog( void );
+
+    // A finished analyzer (now owned by the caller) or NULL
+    TrackAnalyzer* takeFinished( void );
+
+    // Delivery has added frames
+    inline void notify( void ) {
+        m_wake.SetEvent();
+    }
+
+    inline ULONG getDroppedFrames( void ) const {
+        return m_dropped_frames.load( std::memory_order_relaxed );
+    }
+
+    inline ULONG getDegradedFrames( void ) const {
+        return m_degraded_frames.load( std::memory_order_relaxed );
+    }
+
+private:
+    bool analyzeChunk( void );
+    void loadSavedBeats( void );
+    ULONG takeReaderDrops( void );
+    void addSkipped( ULONG skipped );
+    void completeFinishing( void );
+};
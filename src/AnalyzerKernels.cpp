@@ -0,0 +1,510 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#include "stdafx.h"
+#include "AnalyzerKernels.h"
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <immintrin.h>
+
+// ----------------------------------------------------------------------------
+//
+void makeHannWindow( float* window, UINT frames, UINT channels )
+{
+    static const double TWO_PI = M_PI * 2.0;
+
+    for ( UINT frame=0; frame < frames; frame++ ) {
+        float weight = ( frames > 1 ) ? (float)(0.5 * (1.0 - cos( TWO_PI * frame / (frames - 1.0) ))) : 1.0f;
+
+        for ( UINT channel=0; channel < channels; channel++ )
+            *window++ = weight;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// WINDOWED PEAK KERNELS
+// ----------------------------------------------------------------------------
+
+static float windowedPeakScalar( const int16_t* samples, const float* window, size_t count, ULONGLONG& squares )
+{
+    float peak = 0.0f;
+
+    for ( size_t i=0; i < count; i++ ) {
+        float value = fabsf( (float)samples[i] ) * window[i];
+        if ( value > peak )
+            peak = value;
+
+        squares += (ULONGLONG)((int)samples[i] * (int)samples[i]);
+    }
+
+    return peak;
+}
+
+static inline float horizontalMax( __m128 v )
+{
+    v = _mm_max_ps( v, _mm_shuffle_ps( v, v, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+    v = _mm_max_ps( v, _mm_shuffle_ps( v, v, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+    return _mm_cvtss_f32( v );
+}
+
+// Squares are summed in pairs by madd and widened as unsigned (see the sample level kernels)
+static float windowedPeakSSE2( const int16_t* samples, const float* window, size_t count, ULONGLONG& squares )
+{
+    const __m128 magnitude = _mm_castsi128_ps( _mm_set1_epi32( 0x7FFFFFFF ) );
+    const __m128i zero = _mm_setzero_si128();
+    __m128 peak0 = _mm_setzero_ps();
+    __m128 peak1 = _mm_setzero_ps();
+    __m128i sums = zero;
+    size_t i=0;
+
+    for ( ; i+8 <= count; i += 8 ) {
+        __m128i v = _mm_loadu_si128( (const __m128i*)&samples[i] );
+        __m128 lo = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpacklo_epi16( v, v ), 16 ) );     // Sign extend
+        __m128 hi = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpackhi_epi16( v, v ), 16 ) );
+        __m128i pairs = _mm_madd_epi16( v, v );
+
+        peak0 = _mm_max_ps( peak0, _mm_mul_ps( _mm_and_ps( lo, magnitude ), _mm_loadu_ps( &window[i] ) ) );
+        peak1 = _mm_max_ps( peak1, _mm_mul_ps( _mm_and_ps( hi, magnitude ), _mm_loadu_ps( &window[i+4] ) ) );
+        sums = _mm_add_epi64( sums, _mm_add_epi64( _mm_unpacklo_epi32( pairs, zero ), _mm_unpackhi_epi32( pairs, zero ) ) );
+    }
+
+    ULONGLONG lanes[2];
+    _mm_storeu_si128( (__m128i*)lanes, sums );
+    squares += lanes[0] + lanes[1];
+
+    return max( horizontalMax( _mm_max_ps( peak0, peak1 ) ), windowedPeakScalar( &samples[i], &window[i], count-i, squares ) );
+}
+
+static float windowedPeakAVX2( const int16_t* samples, const float* window, size_t count, ULONGLONG& squares )
+{
+    const __m256 magnitude = _mm256_castsi256_ps( _mm256_set1_epi32( 0x7FFFFFFF ) );
+    const __m256i zero = _mm256_setzero_si256();
+    __m256 peak0 = _mm256_setzero_ps();
+    __m256 peak1 = _mm256_setzero_ps();
+    __m256i sums = zero;
+    size_t i=0;
+
+    for ( ; i+16 <= count; i += 16 ) {
+        __m256i v = _mm256_loadu_si256( (const __m256i*)&samples[i] );
+        __m256 lo = _mm256_cvtepi32_ps( _mm256_cvtepi16_epi32( _mm256_castsi256_si128( v ) ) );
+        __m256 hi = _mm256_cvtepi32_ps( _mm256_cvtepi16_epi32( _mm256_extracti128_si256( v, 1 ) ) );
+        __m256i pairs = _mm256_madd_epi16( v, v );
+
+        peak0 = _mm256_max_ps( peak0, _mm256_mul_ps( _mm256_and_ps( lo, magnitude ), _mm256_loadu_ps( &window[i] ) ) );
+        peak1 = _mm256_max_ps( peak1, _mm256_mul_ps( _mm256_and_ps( hi, magnitude ), _mm256_loadu_ps( &window[i+8] ) ) );
+        sums = _mm256_add_epi64( sums, _mm256_add_epi64( _mm256_unpacklo_epi32( pairs, zero ), _mm256_unpackhi_epi32( pairs, zero ) ) );
+    }
+
+    __m256 peak = _mm256_max_ps( peak0, peak1 );
+    float result = horizontalMax( _mm_max_ps( _mm256_castps256_ps128( peak ), _mm256_extractf128_ps( peak, 1 ) ) );
+
+    ULONGLONG lanes[4];
+    _mm256_storeu_si256( (__m256i*)lanes, sums );
+    squares += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+    _mm256_zeroupper();
+
+    return max( result, windowedPeakSSE2( &samples[i], &window[i], count-i, squares ) );
+}
+
+// ----------------------------------------------------------------------------
+//
+float windowedPeak( const int16_t* samples, const float* window, size_t count, ULONGLONG& squares, SimdLevel simd )
+{
+    switch ( simd ) {
+        case SIMD_AVX2:     return windowedPeakAVX2( samples, window, count, squares );
+        case SIMD_SSE2:     return windowedPeakSSE2( samples, window, count, squares );
+        default:            return windowedPeakScalar( samples, window, count, squares );
+    }
+}
+
+// ----------------------------------------------------------------------------
+// SAMPLE CONVERSION KERNELS
+//
+// Samples are clamped then truncated so every level gives the same result as the scalar
+// kernel
+// ----------------------------------------------------------------------------
+
+static void floatToSamplesScalar( const float* input, int16_t* output, size_t count )
+{
+    for ( size_t i=0; i < count; i++ ) {
+        float sample = input[i] * 32767.0f;
+        output[i] = (int16_t)( sample >= 32767.0f ? 32767 : sample <= -32768.0f ? -32768 : (int)sample );
+    }
+}
+
+static void floatToSamplesSSE2( const float* input, int16_t* output, size_t count )
+{
+    const __m128 scale = _mm_set1_ps( 32767.0f );
+    const __m128 low = _mm_set1_ps( -32768.0f );
+    const __m128 high = _mm_set1_ps( 32767.0f );
+    size_t i=0;
+
+    for ( ; i+8 <= count; i += 8 ) {
+        __m128 a = _mm_min_ps( _mm_max_ps( _mm_mul_ps( _mm_loadu_ps( &input[i] ), scale ), low ), high );
+        __m128 b = _mm_min_ps( _mm_max_ps( _mm_mul_ps( _mm_loadu_ps( &input[i+4] ), scale ), low ), high );
+        __m128i lo = _mm_cvttps_epi32( a );
+        __m128i hi = _mm_cvttps_epi32( b );
+
+        _mm_storeu_si128( (__m128i*)&output[i], _mm_packs_epi32( lo, hi ) );
+    }
+
+    floatToSamplesScalar( &input[i], &output[i], count-i );
+}
+
+static void floatToSamplesAVX2( const float* input, int16_t* output, size_t count )
+{
+    const __m256 scale = _mm256_set1_ps( 32767.0f );
+    const __m256 low = _mm256_set1_ps( -32768.0f );
+    const __m256 high = _mm256_set1_ps( 32767.0f );
+    size_t i=0;
+
+    for ( ; i+16 <= count; i += 16 ) {
+        __m256 a = _mm256_min_ps( _mm256_max_ps( _mm256_mul_ps( _mm256_loadu_ps( &input[i] ), scale ), low ), high );
+        __m256 b = _mm256_min_ps( _mm256_max_ps( _mm256_mul_ps( _mm256_loadu_ps( &input[i+8] ), scale ), low ), high );
+        __m256i lo = _mm256_cvttps_epi32( a );
+        __m256i hi = _mm256_cvttps_epi32( b );
+
+        // packs works within 128-bit lanes; the permute puts the four quarters back in order
+        __m256i packed = _mm256_permute4x64_epi64( _mm256_packs_epi32( lo, hi ), _MM_SHUFFLE( 3, 1, 2, 0 ) );
+
+        _mm256_storeu_si256( (__m256i*)&output[i], packed );
+    }
+
+    _mm256_zeroupper();
+
+    floatToSamplesSSE2( &input[i], &output[i], count-i );
+}
+
+// ----------------------------------------------------------------------------
+//
+void floatToSamples( const float* input, int16_t* output, size_t count, SimdLevel simd )
+{
+    switch ( simd ) {
+        case SIMD_AVX2:     floatToSamplesAVX2( input, output, count );     break;
+        case SIMD_SSE2:     floatToSamplesSSE2( input, output, count );     break;
+        default:            floatToSamplesScalar( input, output, count );   break;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// MONO MIX KERNELS
+//
+// madd against ones sums each adjacent left/right pair into one 32-bit lane
+// ----------------------------------------------------------------------------
+
+static void stereoToMonoScalar( const int16_t* stereo, float* mono, size_t frames )
+{
+    for ( size_t i=0; i < frames; i++ )
+        mono[i] = ((int)stereo[i*2] + (int)stereo[i*2+1]) * 0.5f;
+}
+
+static void stereoToMonoSSE2( const int16_t* stereo, float* mono, size_t frames )
+{
+    const __m128i ones = _mm_set1_epi16( 1 );
+    const __m128 half = _mm_set1_ps( 0.5f );
+    size_t i=0;
+
+    for ( ; i+4 <= frames; i += 4 ) {
+        __m128i sums = _mm_madd_epi16( _mm_loadu_si128( (const __m128i*)&stereo[i*2] ), ones );
+        _mm_storeu_ps( &mono[i], _mm_mul_ps( _mm_cvtepi32_ps( sums ), half ) );
+    }
+
+    stereoToMonoScalar( &stereo[i*2], &mono[i], frames-i );
+}
+
+static void stereoToMonoAVX2( const int16_t* stereo, float* mono, size_t frames )
+{
+    const __m256i ones = _mm256_set1_epi16( 1 );
+    const __m256 half = _mm256_set1_ps( 0.5f );
+    size_t i=0;
+
+    for ( ; i+8 <= frames; i += 8 ) {
+        __m256i sums = _mm256_madd_epi16( _mm256_loadu_si256( (const __m256i*)&stereo[i*2] ), ones );
+        _mm256_storeu_ps( &mono[i], _mm256_mul_ps( _mm256_cvtepi32_ps( sums ), half ) );
+    }
+
+    _mm256_zeroupper();
+
+    stereoToMonoSSE2( &stereo[i*2], &mono[i], frames-i );
+}
+
+// ----------------------------------------------------------------------------
+//
+void stereoToMono( const int16_t* stereo, float* mono, size_t frames, SimdLevel simd )
+{
+    switch ( simd ) {
+        case SIMD_AVX2:     stereoToMonoAVX2( stereo, mono, frames );     break;
+        case SIMD_SSE2:     stereoToMonoSSE2( stereo, mono, frames );     break;
+        default:            stereoToMonoScalar( stereo, mono, frames );   break;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// SAMPLE LEVEL KERNELS
+//
+// madd squares and sums sample pairs; a pair can reach 2^31 so the 32-bit lanes are 
+// widened as unsigned before they are accumulated
+// ----------------------------------------------------------------------------
+
+static void accumulateLevelsScalar( const int16_t* samples, size_t count, SampleLevels& levels )
+{
+    for ( size_t i=0; i < count; i++ ) {
+        int sample = samples[i];
+
+        if ( sample < levels.min_sample )
+            levels.min_sample = (int16_t)sample;
+        if ( sample > levels.max_sample )
+            levels.max_sample = (int16_t)sample;
+
+        levels.squares += (ULONGLONG)(sample * sample);
+    }
+
+    levels.count += count;
+}
+
+static void accumulateLevelsSSE2( const int16_t* samples, size_t count, SampleLevels& levels )
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i minimum = _mm_set1_epi16( levels.min_sample );
+    __m128i maximum = _mm_set1_epi16( levels.max_sample );
+    __m128i squares = zero;
+    size_t i=0;
+
+    for ( ; i+8 <= count; i += 8 ) {
+        __m128i v = _mm_loadu_si128( (const __m128i*)&samples[i] );
+        __m128i pairs = _mm_madd_epi16( v, v );
+
+        minimum = _mm_min_epi16( minimum, v );
+        maximum = _mm_max_epi16( maximum, v );
+        squares = _mm_add_epi64( squares, _mm_add_epi64( _mm_unpacklo_epi32( pairs, zero ), _mm_unpackhi_epi32( pairs, zero ) ) );
+    }
+
+    int16_t lanes[8];
+    ULONGLONG sums[2];
+
+    _mm_storeu_si128( (__m128i*)lanes, minimum );
+    for ( int lane=0; lane < 8; lane++ )
+        levels.min_sample = min( levels.min_sample, lanes[lane] );
+
+    _mm_storeu_si128( (__m128i*)lanes, maximum );
+    for ( int lane=0; lane < 8; lane++ )
+        levels.max_sample = max( levels.max_sample, lanes[lane] );
+
+    _mm_storeu_si128( (__m128i*)sums, squares );
+    levels.squares += sums[0] + sums[1];
+    levels.count += i;
+
+    accumulateLevelsScalar( &samples[i], count-i, levels );
+}
+
+static void accumulateLevelsAVX2( const int16_t* samples, size_t count, SampleLevels& levels )
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i minimum = _mm256_set1_epi16( levels.min_sample );
+    __m256i maximum = _mm256_set1_epi16( levels.max_sample );
+    __m256i squares = zero;
+    size_t i=0;
+
+    for ( ; i+16 <= count; i += 16 ) {
+        __m256i v = _mm256_loadu_si256( (const __m256i*)&samples[i] );
+        __m256i pairs = _mm256_madd_epi16( v, v );
+
+        minimum = _mm256_min_epi16( minimum, v );
+        maximum = _mm256_max_epi16( maximum, v );
+        squares = _mm256_add_epi64( squares, _mm256_add_epi64( _mm256_unpacklo_epi32( pairs, zero ), _mm256_unpackhi_epi32( pairs, zero ) ) );
+    }
+
+    int16_t lanes[16];
+    ULONGLONG sums[4];
+
+    _mm256_storeu_si256( (__m256i*)lanes, minimum );
+    for ( int lane=0; lane < 16; lane++ )
+        levels.min_sample = min( levels.min_sample, lanes[lane] );
+
+    _mm256_storeu_si256( (__m256i*)lanes, maximum );
+    for ( int lane=0; lane < 16; lane++ )
+        levels.max_sample = max( levels.max_sample, lanes[lane] );
+
+    _mm256_storeu_si256( (__m256i*)sums, squares );
+    levels.squares += sums[0] + sums[1] + sums[2] + sums[3];
+    levels.count += i;
+
+    _mm256_zeroupper();
+
+    accumulateLevelsSSE2( &samples[i], count-i, levels );
+}
+
+// ----------------------------------------------------------------------------
+//
+void accumulateLevels( const int16_t* samples, size_t count, SampleLevels& levels, SimdLevel simd )
+{
+    switch ( simd ) {
+        case SIMD_AVX2:     accumulateLevelsAVX2( samples, count, levels );     break;
+        case SIMD_SSE2:     accumulateLevelsSSE2( samples, count, levels );     break;
+        default:            accumulateLevelsScalar( samples, count, levels );   break;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// K-WEIGHTING KERNELS
+//
+// The filter is recursive so frames are processed in order; the two channels share 
+// one SSE2 register of doubles (AVX2 has no more channels to fill)
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+// Coefficients for any sample rate from the analog prototypes of the BS.1770 filters
+//
+void KWeightFilter::design( UINT sample_rate )
+{
+    // High shelf (+4dB above about 1.7kHz)
+    double f0 = 1681.974450955533;
+    double gain_db = 3.999843853973347;
+    double q = 0.7071752369554196;
+
+    double k = tan( M_PI * f0 / sample_rate );
+    double vh = pow( 10.0, gain_db / 20.0 );
+    double vb = pow( vh, 0.4996667741545416 );
+    double a0 = 1.0 + k / q + k * k;
+
+    b0[0] = (vh + vb * k / q + k * k) / a0;
+    b1[0] = 2.0 * (k * k - vh) / a0;
+    b2[0] = (vh - vb * k / q + k * k) / a0;
+    a1[0] = 2.0 * (k * k - 1.0) / a0;
+    a2[0] = (1.0 - k / q + k * k) / a0;
+
+    // RLB high pass (about 38Hz)
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+
+    k = tan( M_PI * f0 / sample_rate );
+    a0 = 1.0 + k / q + k * k;
+
+    b0[1] = 1.0;
+    b1[1] = -2.0;
+    b2[1] = 1.0;
+    a1[1] = 2.0 * (k * k - 1.0) / a0;
+    a2[1] = (1.0 - k / q + k * k) / a0;
+
+    reset();
+}
+
+// ----------------------------------------------------------------------------
+//
+void KWeightFilter::reset( void )
+{
+    memset( z1, 0, sizeof(z1) );
+    memset( z2, 0, sizeof(z2) );
+}
+
+static double kWeightedSquaresScalar( const int16_t* stereo, size_t frames, KWeightFilter& f )
+{
+    double squares = 0.0;
+
+    for ( size_t i=0; i < frames; i++ ) {
+        for ( int channel=0; channel < 2; channel++ ) {
+            double y = stereo[i*2+channel];
+
+            for ( int stage=0; stage < 2; stage++ ) {
+                double x = y;
+
+                y = f.b0[stage] * x + f.z1[stage][channel];
+                f.z1[stage][channel] = f.b1[stage] * x - f.a1[stage] * y + f.z2[stage][channel];
+                f.z2[stage][channel] = f.b2[stage] * x - f.a2[stage] * y;
+            }
+
+            squares += y * y;
+        }
+    }
+
+    return squares;
+}
+
+static double kWeightedSquaresSSE2( const int16_t* stereo, size_t frames, KWeightFilter& f )
+{
+    const __m128d b00 = _mm_set1_pd( f.b0[0] ), b10 = _mm_set1_pd( f.b1[0] ), b20 = _mm_set1_pd( f.b2[0] );
+    const __m128d a10 = _mm_set1_pd( f.a1[0] ), a20 = _mm_set1_pd( f.a2[0] );
+    const __m128d b01 = _mm_set1_pd( f.b0[1] ), b11 = _mm_set1_pd( f.b1[1] ), b21 = _mm_set1_pd( f.b2[1] );
+    const __m128d a11 = _mm_set1_pd( f.a1[1] ), a21 = _mm_set1_pd( f.a2[1] );
+
+    __m128d z10 = _mm_loadu_pd( f.z1[0] ), z20 = _mm_loadu_pd( f.z2[0] );
+    __m128d z11 = _mm_loadu_pd( f.z1[1] ), z21 = _mm_loadu_pd( f.z2[1] );
+    __m128d squares = _mm_setzero_pd();
+
+    for ( size_t i=0; i < frames; i++ ) {
+        int frame;
+        memcpy( &frame, &stereo[i*2], sizeof(frame) );
+
+        __m128i pair = _mm_cvtsi32_si128( frame );
+        __m128d x = _mm_cvtepi32_pd( _mm_srai_epi32( _mm_unpacklo_epi16( pair, pair ), 16 ) );
+
+        __m128d y = _mm_add_pd( _mm_mul_pd( b00, x ), z10 );
+        z10 = _mm_add_pd( _mm_sub_pd( _mm_mul_pd( b10, x ), _mm_mul_pd( a10, y ) ), z20 );
+        z20 = _mm_sub_pd( _mm_mul_pd( b20, x ), _mm_mul_pd( a20, y ) );
+
+        x = y;
+        y = _mm_add_pd( _mm_mul_pd( b01, x ), z11 );
+        z11 = _mm_add_pd( _mm_sub_pd( _mm_mul_pd( b11, x ), _mm_mul_pd( a11, y ) ), z21 );
+        z21 = _mm_sub_pd( _mm_mul_pd( b21, x ), _mm_mul_pd( a21, y ) );
+
+        squares = _mm_add_pd( squares, _mm_mul_pd( y, y ) );
+    }
+
+    _mm_storeu_pd( f.z1[0], z10 );
+    _mm_storeu_pd( f.z2[0], z20 );
+    _mm_storeu_pd( f.z1[1], z11 );
+    _mm_storeu_pd( f.z2[1], z21 );
+
+    double sums[2];
+    _mm_storeu_pd( sums, squares );
+
+    return sums[0] + sums[1];
+}
+
+// ----------------------------------------------------------------------------
+// State that has decayed to nothing is cleared between calls so silence never runs
+// into denormals
+//
+double kWeightedSquares( const int16_t* stereo, size_t frames, KWeightFilter& filter, SimdLevel simd )
+{
+    double squares;
+
+    switch ( simd ) {
+        case SIMD_AVX2:
+        case SIMD_SSE2:     squares = kWeightedSquaresSSE2( stereo, frames, filter );     break;
+        default:            squares = kWeightedSquaresScalar( stereo, frames, filter );   break;
+    }
+
+    for ( int stage=0; stage < 2; stage++ ) {
+        for ( int channel=0; channel < 2; channel++ ) {
+            if ( fabs( filter.z1[stage][channel] ) < 1.0e-20 )
+                filter.z1[stage][channel] = 0.0;
+            if ( fabs( filter.z2[stage][channel] ) < 1.0e-20 )
+                filter.z2[stage][channel] = 0.0;
+        }
+    }
+
+    return squares;
+}
@@ -0,0 +1,78 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#pragma once
+
+#include "stdafx.h"
+#include "SimdSupport.h"
+
+// Track analysis kernels.  Blocks are interleaved stereo int16 and window tables are 
+// interleaved to match (one weight per sample), so the kernels never need to know the
+// channel layout.
+
+// Fills window with a Hann window over frames frames, repeated for each channel
+extern void makeHannWindow( float* window, UINT frames, UINT channels );
+
+// Largest |sample * window| over count samples.  The squared (unwindowed) samples are 
+// added to squares in the same pass.
+extern float windowedPeak( const int16_t* samples, const float* window, size_t count, ULONGLONG& squares, SimdLevel simd=getSimdLevel() );
+
+// Float samples (full scale 1.0) to int16 block samples, saturating
+extern void floatToSamples( const float* input, int16_t* output, size_t count, SimdLevel simd=getSimdLevel() );
+
+// Mono mix (L+R)/2 of interleaved stereo frames
+extern void stereoToMono( const int16_t* stereo, float* mono, size_t frames, SimdLevel simd=getSimdLevel() );
+
+// Running sample range and energy
+struct SampleLevels {
+    int16_t     min_sample;
+    int16_t     max_sample;
+    ULONGLONG   squares;                    // Sum of squared samples
+    size_t      count;
+
+    inline void reset() {
+        min_sample = 32767;
+        max_sample = -32768;
+        squares = 0;
+        count = 0;
+    }
+};
+
+// Accumulates count samples into levels
+extern void accumulateLevels( const int16_t* samples, size_t count, SampleLevels& levels, SimdLevel simd=getSimdLevel() );
+
+// K-weighting (ITU-R BS.1770 high shelf then RLB high pass) as two biquads in transposed
+// direct form II, with the state of both stereo channels side by side
+struct KWeightFilter {
+    double      b0[2], b1[2], b2[2];        // Per stage
+    double      a1[2], a2[2];
+    double      z1[2][2];                   // [stage][channel]
+    double      z2[2][2];
+
+    void design( UINT sample_rate );
+    void reset( void );
+};
+
+// Filters interleaved stereo frames and returns the sum of the squared outputs of both 
+// channels (in sample units)
+extern double kWeightedSquares( const int16_t* stereo, size_t frames, KWeightFilter& filter, SimdLevel simd=getSimdLevel() );
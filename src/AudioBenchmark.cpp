@@ -0,0 +1,274 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#include "stdafx.h"
+#include "AudioBenchmark.h"
+#include "AudioFormatConverter.h"
+#include "TrackAnalyzer.h"
+#include "RealFft.h"
+#include "AnalyzerKernels.h"
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+#define BENCHMARK_RATE              44100
+#define BENCHMARK_SECONDS           10
+#define BENCHMARK_PASSES            5
+#define BENCHMARK_DEVICE_FRAMES     480             // 10ms device period at 48kHz
+#define BENCHMARK_DELIVERY_FRAMES   2048            // Typical libspotify delivery
+
+class BenchmarkTimer
+{
+    LARGE_INTEGER   m_frequency;
+    LARGE_INTEGER   m_start;
+
+public:
+    BenchmarkTimer() {
+        QueryPerformanceFrequency( &m_frequency );
+        QueryPerformanceCounter( &m_start );
+    }
+
+    double elapsedMS() const {
+        LARGE_INTEGER now;
+        QueryPerformanceCounter( &now );
+        return (double)(now.QuadPart - m_start.QuadPart) * 1000.0 / m_frequency.QuadPart;
+    }
+};
+
+// ----------------------------------------------------------------------------
+//
+static WAVEFORMATEX makeFormat( WORD format_tag, WORD channels, DWORD sample_rate, WORD bits )
+{
+    WAVEFORMATEX format;
+
+    format.wFormatTag = format_tag;
+    format.nChannels = channels;
+    format.nSamplesPerSec = sample_rate;
+    format.wBitsPerSample = bits;
+    format.nBlockAlign = channels * bits / 8;
+    format.nAvgBytesPerSec = sample_rate * format.nBlockAlign;
+    format.cbSize = 0;
+
+    return format;
+}
+
+// ----------------------------------------------------------------------------
+//
+static void logResult( LPCSTR name, double elapsed_ms, UINT frames )
+{
+    double audio_ms = (double)frames * 1000.0 / BENCHMARK_RATE;
+
+    log_status( "Benchmark %-40s %8.2f ms  %8.1f Mframes/s  %8.0fx realtime  %8.1f us/s", 
+        name, elapsed_ms, frames / elapsed_ms / 1000.0, audio_ms / elapsed_ms, elapsed_ms * 1000000.0 / audio_ms );
+}
+
+// ----------------------------------------------------------------------------
+// Current path: the render thread copies source frames into the device buffer and the 
+// shared mode mixer converts them (out of process, so not measured here)
+//
+static void benchmarkCopy( const std::vector<int16_t>& source, UINT frames )
+{
+    std::vector<BYTE> device( BENCHMARK_DEVICE_FRAMES * 2 * sizeof(int16_t) );
+
+    BenchmarkTimer timer;
+
+    for ( UINT pass=0; pass < BENCHMARK_PASSES; pass++ ) {
+        for ( UINT frame=0; frame < frames; frame += BENCHMARK_DEVICE_FRAMES ) {
+            UINT count = min( BENCHMARK_DEVICE_FRAMES, frames - frame );
+            memcpy( &device[0], &source[frame * 2], count * 2 * sizeof(int16_t) );
+        }
+    }
+
+    logResult( "memcpy int16 (mixer converts)", timer.elapsedMS() / BENCHMARK_PASSES, frames );
+}
+
+// ----------------------------------------------------------------------------
+//
+static void benchmarkConverter( LPCSTR name, const std::vector<int16_t>& source, UINT frames, 
+                                const WAVEFORMATEX& output_format, ResamplerQuality quality, SimdLevel simd )
+{
+    WAVEFORMATEX input_format = makeFormat( WAVE_FORMAT_PCM, 2, BENCHMARK_RATE, 16 );
+    AudioFormatConverter converter( &input_format, &output_format, quality, simd );
+    std::vector<BYTE> device( BENCHMARK_DEVICE_FRAMES * output_format.nBlockAlign );
+
+    BenchmarkTimer timer;
+
+    for ( UINT pass=0; pass < BENCHMARK_PASSES; pass++ ) {
+        converter.reset();
+
+        for ( UINT frame=0; frame < frames; ) {
+            UINT consumed;
+            UINT needed = min( converter.getInputFramesNeeded( BENCHMARK_DEVICE_FRAMES ), frames - frame );
+
+            converter.convert( (const BYTE*)&source[frame * 2], needed, &device[0], BENCHMARK_DEVICE_FRAMES, &consumed );
+            if ( consumed == 0 )
+                break;
+
+            frame += consumed;
+        }
+    }
+
+    CString label;
+    label.Format( "%s %s", name, getSimdLevelName( simd ) );
+    if ( converter.isResampling() )
+        label.AppendFormat( " %s", PolyphaseResampler::getQualityName( converter.getEffectiveQuality() ) );
+
+    logResult( label, timer.elapsedMS() / BENCHMARK_PASSES, frames );
+}
+
+// ----------------------------------------------------------------------------
+// Reference for the analyzer - the original per-frame deinterleave, per-sample cos() 
+// window and separate peak pass over 500ms blocks
+//
+static void benchmarkAnalyzerReference( const std::vector<int16_t>& source, UINT frames )
+{
+    UINT block_frames = BENCHMARK_RATE / 2;
+    std::vector<int16_t> left( block_frames ), right( block_frames );
+    std::vector<uint16_t> amplitudes;
+
+    BenchmarkTimer timer;
+
+    for ( UINT pass=0; pass < BENCHMARK_PASSES; pass++ ) {
+        const int16_t* data = &source[0];
+        UINT index = 0;
+
+        for ( UINT frame=0; frame < frames; frame++ ) {
+            left[index] = *data++;
+            right[index] = *data++;
+
+            if ( ++index == block_frames ) {
+                int16_t* channels[] = { &left[0], &right[0] };
+                int16_t amplitude = 0;
+
+                for ( UINT channel=0; channel < 2; channel++ )
+                    for ( UINT bin=0; bin < block_frames; bin++ )
+                        channels[channel][bin] = (int16_t)( (float)channels[channel][bin] * 0.5f * (1.0F - (float) cos(M_PI * 2.0 * bin / (block_frames - 1.0F))) );
+
+                for ( UINT i=0; i < block_frames; i++ ) {
+                    if ( abs(left[i]) > amplitude )
+                        amplitude = abs(left[i]);
+                    if ( abs(right[i]) > amplitude )
+                        amplitude = abs(right[i]);
+                }
+
+                amplitudes.push_back( amplitude );
+                index = 0;
+            }
+        }
+    }
+
+    logResult( "analyze reference (per-frame, cos window)", timer.elapsedMS() / BENCHMARK_PASSES, frames );
+}
+
+// ----------------------------------------------------------------------------
+// Delivery sized chunks, as the analyzer sees them from music_delivery
+//
+static void benchmarkAnalyzer( const std::vector<int16_t>& source, UINT frames, SimdLevel simd )
+{
+    WAVEFORMATEX format = makeFormat( WAVE_FORMAT_PCM, 2, BENCHMARK_RATE, 16 );
+    DWORD length_ms = (DWORD)((ULONGLONG)frames * 1000 / BENCHMARK_RATE);
+    double elapsed_ms = 0.0;
+
+    for ( UINT pass=0; pass < BENCHMARK_PASSES; pass++ ) {
+        TrackAnalyzer* analyzer = TrackAnalyzer::create( &format, length_ms, "benchmark", 0, simd );
+
+        BenchmarkTimer timer;
+
+        for ( UINT frame=0; frame < frames; frame += BENCHMARK_DELIVERY_FRAMES )
+            analyzer->addData( min( BENCHMARK_DELIVERY_FRAMES, frames - frame ), (BYTE*)&source[frame * 2] );
+
+        analyzer->finishData();
+
+        elapsed_ms += timer.elapsedMS();
+
+        free( analyzer->captureAnalyzerData() );
+
+        delete analyzer;
+    }
+
+    CString label;
+    label.Format( "analyze %s", getSimdLevelName( simd ) );
+
+    logResult( label, elapsed_ms / BENCHMARK_PASSES, frames );
+}
+
+// ----------------------------------------------------------------------------
+// Band analysis transforms alone - one per BAND_SAMPLE_MS hop
+//
+static void benchmarkFft( const std::vector<int16_t>& source, UINT frames, SimdLevel simd )
+{
+    RealFft fft( 1024, simd );
+    UINT hop = BENCHMARK_RATE * BAND_SAMPLE_MS / 1000;
+    std::vector<float> mono( frames ), window( fft.getSize() ), power( fft.getBins() );
+
+    stereoToMono( &source[0], &mono[0], frames, simd );
+    makeHannWindow( &window[0], fft.getSize(), 1 );
+
+    BenchmarkTimer timer;
+
+    for ( UINT pass=0; pass < BENCHMARK_PASSES; pass++ )
+        for ( UINT frame=0; frame + fft.getSize() <= frames; frame += hop )
+            fft.powerSpectrum( &mono[frame], &window[0], &power[0] );
+
+    CString label;
+    label.Format( "band fft 1024 every %ums %s", BAND_SAMPLE_MS, getSimdLevelName( simd ) );
+
+    logResult( label, timer.elapsedMS() / BENCHMARK_PASSES, frames );
+}
+
+// ----------------------------------------------------------------------------
+//
+void runAudioBenchmarks( void )
+{
+    UINT frames = BENCHMARK_RATE * BENCHMARK_SECONDS;
+    std::vector<int16_t> source( frames * 2 );
+
+    for ( UINT frame=0; frame < frames; frame++ ) {
+        source[frame*2] = (int16_t)(16000.0 * sin( frame * 2.0 * 3.14159265 * 440.0 / BENCHMARK_RATE ));
+        source[frame*2+1] = (int16_t)(rand() - RAND_MAX/2);
+    }
+
+    log_status( "Audio benchmarks: %u seconds of 16-bit stereo @ %uHz, CPU supports %s", 
+        BENCHMARK_SECONDS, BENCHMARK_RATE, getSimdLevelName( getSimdLevel() ) );
+
+    benchmarkCopy( source, frames );
+
+    WAVEFORMATEX float_44k = makeFormat( WAVE_FORMAT_IEEE_FLOAT, 2, 44100, 32 );
+    WAVEFORMATEX float_48k = makeFormat( WAVE_FORMAT_IEEE_FLOAT, 2, 48000, 32 );
+    WAVEFORMATEX int16_48k = makeFormat( WAVE_FORMAT_PCM, 2, 48000, 16 );
+
+    for ( int level=SIMD_SCALAR; level <= getSimdLevel(); level++ ) {
+        benchmarkConverter( "convert float32 44.1kHz", source, frames, float_44k, RESAMPLE_LINEAR, (SimdLevel)level );
+        benchmarkConverter( "convert int16 48kHz", source, frames, int16_48k, RESAMPLE_LINEAR, (SimdLevel)level );
+
+        for ( int quality=RESAMPLE_LINEAR; quality <= RESAMPLE_HIGH; quality++ )
+            benchmarkConverter( "convert float32 48kHz", source, frames, float_48k, (ResamplerQuality)quality, (SimdLevel)level );
+    }
+
+    benchmarkAnalyzerReference( source, frames );
+
+    for ( int level=SIMD_SCALAR; level <= getSimdLevel(); level++ ) {
+        benchmarkFft( source, frames, (SimdLevel)level );
+        benchmarkAnalyzer( source, frames, (SimdLevel)level );
+    }
+}
@@ -0,0 +1,414 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#include "stdafx.h"
+#include "AudioFormatConverter.h"
+
+#include <mmreg.h>
+#include <ksmedia.h>
+#include <immintrin.h>
+
+static const float INT16_TO_FLOAT = 1.0f / 32768.0f;
+static const float FLOAT_TO_INT16 = 32767.0f;
+
+#define MAP_SILENCE     -1                      // Output channel has no source
+#define MAP_DOWNMIX     -2                      // Output channel is the average of the first two
+
+// ----------------------------------------------------------------------------
+// SAMPLE CONVERSION KERNELS
+// ----------------------------------------------------------------------------
+
+static void int16ToFloatScalar( const int16_t* input, float* output, size_t samples )
+{
+    for ( size_t i=0; i < samples; i++ )
+        output[i] = input[i] * INT16_TO_FLOAT;
+}
+
+static void int16ToFloatSSE2( const int16_t* input, float* output, size_t samples )
+{
+    const __m128 scale = _mm_set1_ps( INT16_TO_FLOAT );
+    size_t i=0;
+
+    for ( ; i+8 <= samples; i += 8 ) {
+        __m128i v = _mm_loadu_si128( (const __m128i*)&input[i] );
+        __m128i lo = _mm_srai_epi32( _mm_unpacklo_epi16( v, v ), 16 );     // Sign extend
+        __m128i hi = _mm_srai_epi32( _mm_unpackhi_epi16( v, v ), 16 );
+
+        _mm_storeu_ps( &output[i], _mm_mul_ps( _mm_cvtepi32_ps( lo ), scale ) );
+        _mm_storeu_ps( &output[i+4], _mm_mul_ps( _mm_cvtepi32_ps( hi ), scale ) );
+    }
+
+    int16ToFloatScalar( &input[i], &output[i], samples-i );
+}
+
+static void int16ToFloatAVX2( const int16_t* input, float* output, size_t samples )
+{
+    const __m256 scale = _mm256_set1_ps( INT16_TO_FLOAT );
+    size_t i=0;
+
+    for ( ; i+16 <= samples; i += 16 ) {
+        __m256i lo = _mm256_cvtepi16_epi32( _mm_loadu_si128( (const __m128i*)&input[i] ) );
+        __m256i hi = _mm256_cvtepi16_epi32( _mm_loadu_si128( (const __m128i*)&input[i+8] ) );
+
+        _mm256_storeu_ps( &output[i], _mm256_mul_ps( _mm256_cvtepi32_ps( lo ), scale ) );
+        _mm256_storeu_ps( &output[i+8], _mm256_mul_ps( _mm256_cvtepi32_ps( hi ), scale ) );
+    }
+
+    _mm256_zeroupper();
+
+    int16ToFloatSSE2( &input[i], &output[i], samples-i );
+}
+
+static void floatToInt16Scalar( const float* input, int16_t* output, size_t samples )
+{
+    for ( size_t i=0; i < samples; i++ ) {
+        float sample = input[i] * FLOAT_TO_INT16;
+        output[i] = (int16_t)( sample >= 32767.0f ? 32767 : sample <= -32768.0f ? -32768 : (int)sample );
+    }
+}
+
+// Truncates and clamps exactly as the scalar path (which also converts the tail)
+static void floatToInt16SSE2( const float* input, int16_t* output, size_t samples )
+{
+    const __m128 scale = _mm_set1_ps( FLOAT_TO_INT16 );
+    const __m128 high = _mm_set1_ps( 32767.0f );
+    const __m128 low = _mm_set1_ps( -32768.0f );
+    size_t i=0;
+
+    for ( ; i+8 <= samples; i += 8 ) {
+        __m128 a = _mm_max_ps( _mm_min_ps( _mm_mul_ps( _mm_loadu_ps( &input[i] ), scale ), high ), low );
+        __m128 b = _mm_max_ps( _mm_min_ps( _mm_mul_ps( _mm_loadu_ps( &input[i+4] ), scale ), high ), low );
+
+        _mm_storeu_si128( (__m128i*)&output[i], _mm_packs_epi32( _mm_cvttps_epi32( a ), _mm_cvttps_epi32( b ) ) );
+    }
+
+    floatToInt16Scalar( &input[i], &output[i], samples-i );
+}
+
+// ----------------------------------------------------------------------------
+// LINEAR RESAMPLING KERNELS
+// 
+// Input frame 0 is the history frame.  position is the fractional input frame of the
+// next output frame and is advanced by step for each frame produced.
+// ----------------------------------------------------------------------------
+
+static UINT resampleLinearScalar( const float* input, UINT input_frames, UINT channels, 
+                                  double& position, double step, float* output, UINT output_frames )
+{
+    double limit = input_frames - 1.0;
+    UINT produced = 0;
+
+    while ( produced < output_frames && position < limit ) {
+        UINT index = (UINT)position;
+        float fraction = (float)(position - index);
+        const float* a = &input[index*channels];
+        const float* b = &a[channels];
+
+        for ( UINT channel=0; channel < channels; channel++ )
+            output[channel] = a[channel] + (b[channel] - a[channel]) * fraction;
+
+        output = &output[channels];
+        position += step;
+        produced++;
+    }
+
+    return produced;
+}
+
+static UINT resampleLinearStereoSSE2( const float* input, UINT input_frames, 
+                                      double& position, double step, float* output, UINT output_frames )
+{
+    double limit = input_frames - 1.0;
+    UINT produced = 0;
+
+    while ( produced < output_frames && position < limit ) {
+        UINT index = (UINT)position;
+        __m128 fraction = _mm_set1_ps( (float)(position - index) );
+        __m128 a = _mm_loadu_ps( &input[index*2] );                 // La Ra Lb Rb
+        __m128 b = _mm_movehl_ps( a, a );                           // Lb Rb Lb Rb
+
+        _mm_storel_pi( (__m64*)output, _mm_add_ps( a, _mm_mul_ps( _mm_sub_ps( b, a ), fraction ) ) );
+
+        output = &output[2];
+        position += step;
+        produced++;
+    }
+
+    return produced;
+}
+
+// ----------------------------------------------------------------------------
+// CONVERTER
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+//
+AudioFormatConverter::AudioFormatConverter( const WAVEFORMATEX* input, const WAVEFORMATEX* output, 
+                                            ResamplerQuality quality, SimdLevel simd ) :
+    m_in_channels( input->nChannels ),
+    m_out_channels( output->nChannels ),
+    m_in_rate( input->nSamplesPerSec ),
+    m_out_rate( output->nSamplesPerSec ),
+    m_in_type( getSampleType( input ) ),
+    m_out_type( getSampleType( output ) ),
+    m_simd( simd ),
+    m_quality( RESAMPLE_LINEAR ),
+    m_resampler( NULL )
+{
+    STUDIO_ASSERT( canConvert( input, output ), "Unsupported audio format conversion" );
+
+    m_step = (double)m_in_rate / (double)m_out_rate;
+
+    for ( UINT channel=0; channel < m_out_channels; channel++ ) {
+        if ( channel < m_in_channels )
+            m_channel_map[channel] = channel;
+        else if ( m_in_channels == 1 && channel == 1 )          // Mono feeds both front channels
+            m_channel_map[channel] = 0;
+        else
+            m_channel_map[channel] = MAP_SILENCE;
+    }
+
+    if ( m_out_channels == 1 && m_in_channels >= 2 )
+        m_channel_map[0] = MAP_DOWNMIX;
+
+    setResamplerQuality( quality );
+}
+
+// ----------------------------------------------------------------------------
+//
+AudioFormatConverter::~AudioFormatConverter()
+{
+    if ( m_resampler )
+        delete m_resampler;
+}
+
+// ----------------------------------------------------------------------------
+// Replacing the filter drops its history (a few ms at most)
+//
+void AudioFormatConverter::setResamplerQuality( ResamplerQuality quality )
+{
+    if ( m_resampler ) {
+        delete m_resampler;
+        m_resampler = NULL;
+    }
+
+    m_quality = quality;
+
+    if ( isResampling() && quality != RESAMPLE_LINEAR && PolyphaseResampler::canResample( m_in_rate, m_out_rate ) )
+        m_resampler = new PolyphaseResampler( m_in_channels, m_in_rate, m_out_rate, quality, m_simd );
+
+    reset();
+}
+
+// ----------------------------------------------------------------------------
+//
+AudioSampleType AudioFormatConverter::getSampleType( const WAVEFORMATEX* format )
+{
+    WORD format_tag = format->wFormatTag;
+
+    if ( format_tag == WAVE_FORMAT_EXTENSIBLE && format->cbSize >= sizeof(WAVEFORMATEXTENSIBLE)-sizeof(WAVEFORMATEX) ) {
+        const WAVEFORMATEXTENSIBLE* extensible = reinterpret_cast<const WAVEFORMATEXTENSIBLE*>( format );
+
+        if ( IsEqualGUID( extensible->SubFormat, KSDATAFORMAT_SUBTYPE_IEEE_FLOAT ) )
+            format_tag = WAVE_FORMAT_IEEE_FLOAT;
+        else if ( IsEqualGUID( extensible->SubFormat, KSDATAFORMAT_SUBTYPE_PCM ) )
+            format_tag = WAVE_FORMAT_PCM;
+    }
+
+    if ( format_tag == WAVE_FORMAT_PCM && format->wBitsPerSample == 16 )
+        return SAMPLE_INT16;
+
+    if ( format_tag == WAVE_FORMAT_IEEE_FLOAT && format->wBitsPerSample == 32 )
+        return SAMPLE_FLOAT32;
+
+    return SAMPLE_UNSUPPORTED;
+}
+
+// ----------------------------------------------------------------------------
+//
+bool AudioFormatConverter::canConvert( const WAVEFORMATEX* input, const WAVEFORMATEX* output )
+{
+    return getSampleType( input ) != SAMPLE_UNSUPPORTED && getSampleType( output ) != SAMPLE_UNSUPPORTED &&
+           input->nChannels > 0 && input->nChannels <= MAX_CONVERTER_CHANNELS &&
+           output->nChannels > 0 && output->nChannels <= MAX_CONVERTER_CHANNELS &&
+           input->nSamplesPerSec > 0 && output->nSamplesPerSec > 0;
+}
+
+// ----------------------------------------------------------------------------
+//
+void AudioFormatConverter::reset( void )
+{
+    if ( m_input.size() < m_in_channels )
+        m_input.resize( m_in_channels );
+
+    std::fill( m_input.begin(), m_input.begin() + m_in_channels, 0.0f );
+
+    m_position = 1.0;                           // First output lands exactly on the first input frame
+
+    if ( m_resampler )
+        m_resampler->reset();
+}
+
+// ----------------------------------------------------------------------------
+//
+UINT AudioFormatConverter::getInputFramesNeeded( UINT output_frames ) const
+{
+    if ( !isResampling() || output_frames == 0 )
+        return output_frames;
+
+    // The filter may already hold enough input; ask for at least one frame so callers 
+    // still convert
+    if ( m_resampler )
+        return max( m_resampler->getInputFramesNeeded( output_frames ), 1U );
+
+    // The last output frame interpolates between input frames floor(p) and floor(p)+1
+    double last_position = m_position + (output_frames - 1) * m_step;
+
+    return (UINT)last_position + 1;
+}
+
+// ----------------------------------------------------------------------------
+//
+UINT AudioFormatConverter::convert( const BYTE* input, UINT input_frames, BYTE* output, UINT output_frames, UINT* input_consumed )
+{
+    if ( !isResampling() ) {
+        UINT frames = min( input_frames, output_frames );
+
+        if ( m_input.size() < frames * m_in_channels )
+            m_input.resize( frames * m_in_channels );
+
+        toFloat( input, &m_input[0], frames * m_in_channels );
+        remap( &m_input[0], frames, output );
+
+        *input_consumed = frames;
+        return frames;
+    }
+
+    if ( m_resampler ) {
+        UINT frames = min( input_frames, m_resampler->getInputFramesNeeded( output_frames ) );
+
+        if ( m_input.size() < frames * m_in_channels )
+            m_input.resize( frames * m_in_channels );
+        if ( m_resampled.size() < output_frames * m_in_channels )
+            m_resampled.resize( output_frames * m_in_channels );
+
+        toFloat( input, m_input.data(), frames * m_in_channels );
+
+        UINT produced = m_resampler->process( m_input.data(), frames, m_resampled.data(), output_frames, input_consumed );
+
+        remap( m_resampled.data(), produced, output );
+
+        return produced;
+    }
+
+    // History frame stays at the front of m_input between calls
+    if ( m_input.size() < (input_frames + 1) * m_in_channels )
+        m_input.resize( (input_frames + 1) * m_in_channels );
+    if ( m_resampled.size() < output_frames * m_in_channels )
+        m_resampled.resize( output_frames * m_in_channels );
+
+    toFloat( input, &m_input[m_in_channels], input_frames * m_in_channels );
+
+    UINT produced = resample( &m_input[0], input_frames + 1, &m_resampled[0], output_frames );
+
+    // Input frames fully behind the next output position are done; the last becomes history
+    UINT consumed = min( (UINT)m_position, input_frames );
+    if ( consumed > 0 ) {
+        memcpy( &m_input[0], &m_input[consumed * m_in_channels], m_in_channels * sizeof(float) );
+        m_position -= consumed;
+    }
+
+    remap( &m_resampled[0], produced, output );
+
+    *input_consumed = consumed;
+    return produced;
+}
+
+// ----------------------------------------------------------------------------
+//
+void AudioFormatConverter::toFloat( const BYTE* input, float* output, size_t samples )
+{
+    if ( m_in_type == SAMPLE_FLOAT32 ) {
+        memcpy( output, input, samples * sizeof(float) );
+        return;
+    }
+
+    const int16_t* samples16 = reinterpret_cast<const int16_t*>( input );
+
+    switch ( m_simd ) {
+        case SIMD_AVX2:     int16ToFloatAVX2( samples16, output, samples );     break;
+        case SIMD_SSE2:     int16ToFloatSSE2( samples16, output, samples );     break;
+        default:            int16ToFloatScalar( samples16, output, samples );   break;
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+UINT AudioFormatConverter::resample( const float* input, UINT input_frames, float* output, UINT output_frames )
+{
+    if ( m_in_channels == 2 && m_simd != SIMD_SCALAR )
+        return resampleLinearStereoSSE2( input, input_frames, m_position, m_step, output, output_frames );
+
+    return resampleLinearScalar( input, input_frames, m_in_channels, m_position, m_step, output, output_frames );
+}
+
+// ----------------------------------------------------------------------------
+//
+void AudioFormatConverter::remap( const float* input, UINT frames, BYTE* output )
+{
+    bool identity = m_in_channels == m_out_channels;
+    for ( UINT channel=0; identity && channel < m_out_channels; channel++ )
+        identity = m_channel_map[channel] == (int)channel;
+
+    const float* source = input;
+
+    if ( !identity ) {
+        // Remap into whichever work buffer is not the input
+        std::vector<float>& scratch = ( input == m_resampled.data() ) ? m_input : m_resampled;
+        if ( scratch.size() < frames * m_out_channels + m_in_channels )
+            scratch.resize( frames * m_out_channels + m_in_channels );
+
+        float* mapped = &scratch[m_in_channels];               // Never touch the history frame
+
+        for ( UINT frame=0; frame < frames; frame++ ) {
+            const float* in = &input[frame * m_in_channels];
+            float* out = &mapped[frame * m_out_channels];
+
+            for ( UINT channel=0; channel < m_out_channels; channel++ ) {
+                int map = m_channel_map[channel];
+                out[channel] = ( map >= 0 ) ? in[map] : ( map == MAP_DOWNMIX ) ? (in[0] + in[1]) * 0.5f : 0.0f;
+            }
+        }
+
+        source = mapped;
+    }
+
+    size_t samples = frames * m_out_channels;
+
+    if ( m_out_type == SAMPLE_FLOAT32 )
+        memcpy( output, source, samples * sizeof(float) );
+    else if ( m_simd != SIMD_SCALAR )
+        floatToInt16SSE2( source, reinterpret_cast<int16_t*>( output ), samples );
+    else
+        floatToInt16Scalar( source, reinterpret_cast<int16_t*>( output ), samples );
+}
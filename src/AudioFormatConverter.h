@@ -0,0 +1,107 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#pragma once
+
+#include "stdafx.h"
+#include "SimdSupport.h"
+#include "PolyphaseResampler.h"
+
+#define MAX_CONVERTER_CHANNELS  8
+
+typedef enum {
+    SAMPLE_UNSUPPORTED = 0,
+    SAMPLE_INT16 = 1,                           // 16-bit signed PCM
+    SAMPLE_FLOAT32 = 2                          // 32-bit IEEE float
+} AudioSampleType;
+
+// Converts interleaved frames from the source format (libspotify) to the render device's
+// native mix format: sample type conversion, sample rate conversion and channel remapping.
+// Not thread safe - owned by the render thread.
+
+class AudioFormatConverter
+{
+    UINT                m_in_channels;
+    UINT                m_out_channels;
+    UINT                m_in_rate;
+    UINT                m_out_rate;
+    AudioSampleType     m_in_type;
+    AudioSampleType     m_out_type;
+    SimdLevel           m_simd;
+
+    int                 m_channel_map[MAX_CONVERTER_CHANNELS];   // Source channel for each output channel
+
+    ResamplerQuality    m_quality;
+    PolyphaseResampler* m_resampler;            // NULL for linear interpolation
+
+    double              m_step;                 // Input frames per output frame
+    double              m_position;             // Next output frame position (0 = history frame)
+    std::vector<float>  m_input;                // History frame followed by input as float
+    std::vector<float>  m_resampled;            // Resampled frames (input channel layout)
+
+public:
+    AudioFormatConverter( const WAVEFORMATEX* input, const WAVEFORMATEX* output, 
+                          ResamplerQuality quality=RESAMPLE_MEDIUM, SimdLevel simd=::getSimdLevel() );
+    ~AudioFormatConverter();
+
+    static AudioSampleType getSampleType( const WAVEFORMATEX* format );
+    static bool canConvert( const WAVEFORMATEX* input, const WAVEFORMATEX* output );
+
+    inline bool isResampling() const {
+        return m_in_rate != m_out_rate;
+    }
+
+    inline SimdLevel getSimdLevel() const {
+        return m_simd;
+    }
+
+    inline ResamplerQuality getResamplerQuality() const {
+        return m_quality;
+    }
+
+    // Quality actually in use (linear when polyphase cannot handle the rates)
+    inline ResamplerQuality getEffectiveQuality() const {
+        return m_resampler != NULL ? m_quality : RESAMPLE_LINEAR;
+    }
+
+    // Microseconds per second of audio spent in the polyphase filter (0 if not used)
+    inline double getResamplerCost() const {
+        return m_resampler != NULL ? m_resampler->getCostPerSecond() : 0.0;
+    }
+
+    void setResamplerQuality( ResamplerQuality quality );
+
+    // Input frames required to produce output_frames
+    UINT getInputFramesNeeded( UINT output_frames ) const;
+
+    // Returns frames written to output; input_consumed receives input frames used up
+    UINT convert( const BYTE* input, UINT input_frames, BYTE* output, UINT output_frames, UINT* input_consumed );
+
+    // Forget resampler history (stream discontinuity)
+    void reset( void );
+
+private:
+    void toFloat( const BYTE* input, float* output, size_t samples );
+    UINT resample( const float* input, UINT input_frames, float* output, UINT output_frames );
+    void remap( const float* input, UINT frames, BYTE* output );
+};
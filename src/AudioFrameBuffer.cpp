@@ -1,78 +1,374 @@
-/* 
-Copyright (C) 2011,2012 Robert DeSantis
- 
-This file is part of DMX Studio.
- 
-DMX Studio is free software; you can redistribute it and/or modify
-it under the terms of the GNU General Public License as published by
-the Free Software Foundation; either version 3 of the License, or (at your
-option) any later version.
- 
-DMX Studio is distributed in the hope that it will be useful, but
-WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
-or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
-License for more details.
- 
-You should have received a copy of the GNU General Public License
-along with DMX Studio; see the file _COPYING.txt.  If not, write to
-the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
-MA 02111-1307, USA.
-*/
-
-#include "stdafx.h"
-#include "AudioFrameBuffer.h"
-
-// ----------------------------------------------------------------------------
-//
-UINT AudioFrameBuffer::read( UINT32 frames, LPBYTE pData )
-{
-    if ( frames > m_frame_count )
-        frames = m_frame_count;
-
-    for ( UINT32 frames_left=frames; true; ) {
-        if ( m_read_ptr + frames_left < m_frame_capacity ) {
-            memcpy( pData, &m_buffer[m_read_ptr*m_frame_size], frames_left*m_frame_size );
-            m_read_ptr += frames_left;
-            m_frame_count -= frames_left;
-            break;
-        }
-        else {
-            UINT partial_frames = m_frame_capacity-m_read_ptr;
-            UINT size = partial_frames*m_frame_size;
-            memcpy( pData, &m_buffer[m_read_ptr*m_frame_size], size );
-            pData = &pData[ size ];
-            m_read_ptr = 0;
-            m_frame_count -= partial_frames;
-            frames_left -= partial_frames;
-        }
-    }
-
-    return frames;
-}
-
-// ----------------------------------------------------------------------------
-//
-bool AudioFrameBuffer::write( UINT32 frames, LPBYTE pData )
-{
-    if ( m_frame_count + frames > m_frame_capacity )
-        return false;
-
-    for ( UINT32 frames_left=frames; true; ) {
-        if ( m_write_ptr + frames_left < m_frame_capacity ) {
-            memcpy( &m_buffer[m_write_ptr*m_frame_size], pData, frames_left*m_frame_size );
-            m_write_ptr += frames_left;
-            m_frame_count += frames_left;
-            break;
-        }
-        else {
-            UINT partial_frames = m_frame_capacity-m_write_ptr;
-            memcpy( &m_buffer[m_write_ptr*m_frame_size], pData, partial_frames*m_frame_size );
-            frames_left -= partial_frames;
-            m_frame_count += partial_frames;
-            m_write_ptr = 0;
-            pData = &pData[ partial_frames*m_frame_size ];
-        }
-    }
-
-    return true;
-}
\ No newline at end of file
+/* 
+Copyright (C) 2011,2012 Robert DeSantis
+ 
+This file is part of DMX Studio.
+ 
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+ 
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+ 
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+#include "stdafx.h"
+#include "AudioFrameBuffer.h"
+
+// ----------------------------------------------------------------------------
+//
+AudioFrameBuffer::AudioFrameBuffer( UINT frames, UINT channels, UINT sample_size, AudioBufferMode mode ) :
+    m_frame_capacity( frames ),
+    m_frame_size( channels * sample_size ),
+    m_buffer( NULL ),
+    m_mode( mode ),
+    m_mapping( NULL ),
+    m_low_water( 0 ),
+    m_high_water( frames ),
+    m_low_water_event( NULL ),
+    m_high_water_event( NULL ),
+    m_above_high( false ),
+    m_write_ptr( 0 )
+{
+    for ( int reader=0; reader < MAX_FRAME_READERS; reader++ ) {
+        m_readers[reader].m_read_ptr = 0;
+        m_readers[reader].m_peek_ptr = 0;
+        m_readers[reader].m_active = ( reader == 0 );
+        m_readers[reader].m_policy = READER_BLOCKING;
+        m_readers[reader].m_dropped_frames = 0;
+    }
+
+    if ( m_mode == BUFFER_MIRRORED && !allocateMirrored() )
+        m_mode = BUFFER_HEAP;
+
+    if ( m_mode == BUFFER_HEAP )
+        m_buffer = (BYTE *)malloc( m_frame_capacity * m_frame_size );
+}
+
+// ----------------------------------------------------------------------------
+//
+AudioFrameBuffer::~AudioFrameBuffer()
+{
+    if ( m_mode == BUFFER_MIRRORED ) {
+        UnmapViewOfFile( &m_buffer[m_frame_capacity * m_frame_size] );
+        UnmapViewOfFile( m_buffer );
+        CloseHandle( m_mapping );
+    }
+    else
+        free( m_buffer );
+}
+
+// ----------------------------------------------------------------------------
+// Map one page file section twice at adjacent addresses.  There is no way to 
+// atomically claim the address range, so reserve a region to find a hole, release
+// it and map into it - retrying if another thread takes the hole first.
+//
+bool AudioFrameBuffer::allocateMirrored( void )
+{
+    SYSTEM_INFO system_info;
+    GetSystemInfo( &system_info );
+
+    DWORD granularity = system_info.dwAllocationGranularity;
+    DWORD size = ((m_frame_capacity * m_frame_size + granularity - 1) / granularity) * granularity;
+
+    if ( size % m_frame_size != 0 )                        // Frames must tile the mapping exactly
+        return false;
+
+    HANDLE mapping = CreateFileMapping( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, size, NULL );
+    if ( mapping == NULL )
+        return false;
+
+    for ( int attempt=0; attempt < 10; attempt++ ) {
+        LPBYTE base = (LPBYTE)VirtualAlloc( NULL, size*2, MEM_RESERVE, PAGE_NOACCESS );
+        if ( base == NULL )
+            break;
+
+        VirtualFree( base, 0, MEM_RELEASE );
+
+        LPBYTE view = (LPBYTE)MapViewOfFileEx( mapping, FILE_MAP_ALL_ACCESS, 0, 0, size, base );
+        if ( view == NULL )
+            continue;
+
+        LPBYTE mirror = (LPBYTE)MapViewOfFileEx( mapping, FILE_MAP_ALL_ACCESS, 0, 0, size, &base[size] );
+        if ( mirror == NULL ) {
+            UnmapViewOfFile( view );
+            continue;
+        }
+
+        m_mapping = mapping;
+        m_buffer = view;
+        m_frame_capacity = size / m_frame_size;
+
+        return true;
+    }
+
+    CloseHandle( mapping );
+
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+//
+void AudioFrameBuffer::setWatermarks( UINT low_frames, UINT high_frames, HANDLE low_water_event, HANDLE high_water_event )
+{
+    m_high_water = min( high_frames, m_frame_capacity );
+    m_low_water = min( low_frames, m_high_water );
+    m_low_water_event = low_water_event;
+    m_high_water_event = high_water_event;
+    m_above_high = false;
+}
+
+// ----------------------------------------------------------------------------
+//
+int AudioFrameBuffer::addReader( AudioReaderPolicy policy )
+{
+    for ( int reader=1; reader < MAX_FRAME_READERS; reader++ ) {
+        AudioFrameReader& slot = m_readers[reader];
+
+        if ( slot.m_active.load( std::memory_order_relaxed ) )
+            continue;
+
+        slot.m_policy = policy;
+        slot.m_dropped_frames = 0;
+        slot.m_read_ptr.store( m_write_ptr.load( std::memory_order_acquire ), std::memory_order_relaxed );
+        slot.m_peek_ptr = slot.m_read_ptr.load( std::memory_order_relaxed );
+
+        bool inactive = false;
+        if ( slot.m_active.compare_exchange_strong( inactive, true, std::memory_order_release ) )
+            return reader;
+    }
+
+    return -1;
+}
+
+// ----------------------------------------------------------------------------
+//
+void AudioFrameBuffer::removeReader( int reader )
+{
+    if ( reader > 0 && reader < MAX_FRAME_READERS )         // The primary reader always exists
+        m_readers[reader].m_active.store( false, std::memory_order_release );
+}
+
+// ----------------------------------------------------------------------------
+//
+UINT AudioFrameBuffer::size( void ) const
+{
+    UINT write_ptr = m_write_ptr.load( std::memory_order_acquire );
+    UINT fill = 0;
+
+    for ( int reader=0; reader < MAX_FRAME_READERS; reader++ ) {
+        const AudioFrameReader& slot = m_readers[reader];
+
+        if ( slot.m_active.load( std::memory_order_acquire ) && slot.m_policy == READER_BLOCKING )
+            fill = max( fill, distance( slot.m_read_ptr.load( std::memory_order_acquire ), write_ptr ) );
+    }
+
+    return fill;
+}
+
+// ----------------------------------------------------------------------------
+//
+void AudioFrameBuffer::reset( void )
+{
+    UINT write_ptr = m_write_ptr.load( std::memory_order_acquire );
+
+    for ( int reader=0; reader < MAX_FRAME_READERS; reader++ )
+        m_readers[reader].m_read_ptr.store( write_ptr, std::memory_order_release );
+}
+
+// ----------------------------------------------------------------------------
+// Consumer side
+//
+UINT AudioFrameBuffer::read( UINT32 frames, LPBYTE pData, int reader )
+{
+    AudioFrameSpans spans;
+
+    frames = peekRead( frames, spans, reader );
+
+    for ( UINT i=0; i < spans.m_count; i++ ) {
+        UINT size = spans.m_span[i].m_frames*m_frame_size;
+        memcpy( pData, spans.m_span[i].m_data, size );
+        pData = &pData[ size ];
+    }
+
+    // If reset() or a lagging skip moved the read pointer while we were copying then these frames were discarded
+    if ( !consumeRead( frames, reader ) )
+        return 0;
+
+    return frames;
+}
+
+// ----------------------------------------------------------------------------
+// Consumer side
+//
+UINT AudioFrameBuffer::peekRead( UINT32 frames, AudioFrameSpans& spans, int reader )
+{
+    UINT read_ptr = m_readers[reader].m_read_ptr.load( std::memory_order_acquire );
+    m_readers[reader].m_peek_ptr = read_ptr;
+
+    UINT frame_count = distance( read_ptr, m_write_ptr.load( std::memory_order_acquire ) );
+
+    if ( frames > frame_count )
+        frames = frame_count;
+
+    makeSpans( read_ptr, frames, spans );
+
+    return frames;
+}
+
+// ----------------------------------------------------------------------------
+// Consumer side - returns false if reset() or a lagging skip discarded the peeked frames
+//
+bool AudioFrameBuffer::consumeRead( UINT32 frames, int reader )
+{
+    AudioFrameReader& slot = m_readers[reader];
+
+    UINT read_ptr = slot.m_peek_ptr;                // Fails below if the pointer moved since the peek
+    UINT frame_count = distance( read_ptr, m_write_ptr.load( std::memory_order_acquire ) );
+
+    if ( frames > frame_count )
+        return false;
+
+    if ( !slot.m_read_ptr.compare_exchange_strong( read_ptr, advance( read_ptr, frames ), std::memory_order_release ) )
+        return false;
+
+    // Producer is waiting for room - let it know once we are down to the low water mark.  
+    // With several blocking readers it is the slowest one that matters.
+    if ( m_above_high.load( std::memory_order_relaxed ) && slot.m_policy == READER_BLOCKING && size() <= m_low_water ) {
+        if ( m_above_high.exchange( false ) && m_low_water_event != NULL )
+            SetEvent( m_low_water_event );
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Producer side
+//
+UINT AudioFrameBuffer::write( UINT32 frames, LPBYTE pData )
+{
+    AudioFrameSpans spans;
+
+    frames = acquireWrite( frames, spans );
+
+    for ( UINT i=0; i < spans.m_count; i++ ) {
+        UINT size = spans.m_span[i].m_frames*m_frame_size;
+        memcpy( spans.m_span[i].m_data, pData, size );
+        pData = &pData[ size ];
+    }
+
+    commitWrite( frames );
+
+    return frames;
+}
+
+// ----------------------------------------------------------------------------
+// Producer side
+//
+UINT AudioFrameBuffer::acquireWrite( UINT32 frames, AudioFrameSpans& spans )
+{
+    UINT write_ptr = m_write_ptr.load( std::memory_order_relaxed );
+    UINT frame_space = writableFrames( write_ptr, frames );
+
+    if ( frames > frame_space ) {
+        frames = frame_space;
+        reachedHighWater();
+    }
+
+    makeSpans( write_ptr, frames, spans );
+
+    return frames;
+}
+
+// ----------------------------------------------------------------------------
+// Producer side - space left by the slowest reader.  A drop lagging reader that is in
+// the way is skipped ahead to half a buffer behind (so skips are rare and large rather 
+// than on every write); the reader detects it when its consumeRead() fails.
+//
+UINT AudioFrameBuffer::writableFrames( UINT write_ptr, UINT frames )
+{
+    UINT frame_space = m_frame_capacity;
+
+    for ( int reader=0; reader < MAX_FRAME_READERS; reader++ ) {
+        AudioFrameReader& slot = m_readers[reader];
+
+        if ( !slot.m_active.load( std::memory_order_acquire ) )
+            continue;
+
+        UINT read_ptr = slot.m_read_ptr.load( std::memory_order_acquire );
+        UINT used = distance( read_ptr, write_ptr );
+
+        if ( slot.m_policy == READER_DROP_LAGGING && m_frame_capacity - used < frames ) {
+            UINT target = min( m_frame_capacity / 2, m_frame_capacity - min( frames, m_frame_capacity ) );
+
+            if ( used > target ) {
+                UINT skip = used - target;
+
+                if ( slot.m_read_ptr.compare_exchange_strong( read_ptr, advance( read_ptr, skip ), std::memory_order_acq_rel ) ) {
+                    slot.m_dropped_frames.fetch_add( skip, std::memory_order_relaxed );
+                    used = target;
+                }
+                else
+                    used = distance( read_ptr, write_ptr );         // Reader moved - use where it is now
+            }
+        }
+
+        frame_space = min( frame_space, m_frame_capacity - used );
+    }
+
+    return frame_space;
+}
+
+// ----------------------------------------------------------------------------
+// Producer side - frames must not exceed the last acquireWrite()
+//
+void AudioFrameBuffer::commitWrite( UINT32 frames )
+{
+    UINT write_ptr = m_write_ptr.load( std::memory_order_relaxed );
+
+    m_write_ptr.store( advance( write_ptr, frames ), std::memory_order_release );
+
+    if ( size() >= m_high_water )
+        reachedHighWater();
+}
+
+// ----------------------------------------------------------------------------
+// Producer side
+//
+void AudioFrameBuffer::reachedHighWater( void )
+{
+    if ( !m_above_high.load( std::memory_order_relaxed ) && !m_above_high.exchange( true ) ) {
+        if ( m_high_water_event != NULL )
+            SetEvent( m_high_water_event );
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+void AudioFrameBuffer::makeSpans( UINT ptr, UINT frames, AudioFrameSpans& spans )
+{
+    UINT start = offset( ptr );
+    UINT partial_frames = ( m_mode == BUFFER_MIRRORED ) ? frames : min( frames, m_frame_capacity-start );
+
+    spans.m_frames = frames;
+    spans.m_count = 0;
+
+    if ( partial_frames > 0 ) {
+        spans.m_span[spans.m_count].m_data = &m_buffer[start*m_frame_size];
+        spans.m_span[spans.m_count].m_frames = partial_frames;
+        spans.m_count++;
+    }
+
+    if ( partial_frames < frames ) {
+        spans.m_span[spans.m_count].m_data = m_buffer;
+        spans.m_span[spans.m_count].m_frames = frames-partial_frames;
+        spans.m_count++;
+    }
+}
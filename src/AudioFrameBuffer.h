@@ -1,77 +1,192 @@
-/* 
-Copyright (C) 2011,2012 Robert DeSantis
-hopluvr at gmail dot com
-
-This file is part of DMX Studio.
- 
-DMX Studio is free software; you can redistribute it and/or modify
-it under the terms of the GNU General Public License as published by
-the Free Software Foundation; either version 3 of the License, or (at your
-option) any later version.
- 
-DMX Studio is distributed in the hope that it will be useful, but
-WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
-or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
-License for more details.
- 
-You should have received a copy of the GNU General Public License
-along with DMX Studio; see the file _COPYING.txt.  If not, write to
-the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
-MA 02111-1307, USA.
-*/
-
-#pragma once
-
-#include "stdafx.h"
-
-class AudioFrameBuffer
-{
-    UINT    m_frame_capacity;                       // Numer of frame that can be stored
-    UINT    m_frame_size;                           // Size of a frame in bytes
-
-    UINT    m_write_ptr;                            // New frames go here
-    UINT    m_read_ptr;                             // Next frame to read is here
-    UINT    m_frame_count;                          // Number of frames available to read
-
-    BYTE*   m_buffer;                               // Frame data
-
-public:
-    AudioFrameBuffer( UINT frames=44100*10, UINT channels=2, UINT sample_size=sizeof(int16_t) ) :
-        m_frame_capacity( frames ),
-        m_frame_size( channels * sample_size ),
-        m_write_ptr( 0 ),
-        m_read_ptr( 0 ),
-        m_frame_count( 0 )
-    {
-        m_buffer = (BYTE *)malloc( m_frame_capacity * m_frame_size );
-    }
-
-    ~AudioFrameBuffer()
-    {
-        free( m_buffer );
-    }
-
-    inline UINT availableSpace() const {
-        return m_frame_capacity-m_frame_count;
-    }
-
-    inline UINT size( void ) const {
-        return m_frame_count;
-    }
-
-    inline void reset( void ) {
-        m_write_ptr = m_read_ptr = m_frame_count = 0;
-    }
-
-    UINT read( UINT32 frames, LPBYTE pData );
-    bool write( UINT32 frames, LPBYTE pData );
-
-    LPBYTE getFramePointer( UINT frame ) {
-        return &m_buffer[ frame * m_frame_size ];
-    }
-
-    inline UINT getFrameSize() const {
-        return m_frame_size;
-    }
-};
-
+/* 
+Copyright (C) 2011,2012 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+ 
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+ 
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+ 
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+#pragma once
+
+#include "stdafx.h"
+
+#define AUDIO_CACHE_LINE_SIZE   64
+#define MAX_FRAME_READERS       4                   // Reader 0 is the primary consumer
+#define AUDIO_RING_FRAMES       (44100*10)          // Delivered audio buffered ahead of the device (10s at 44.1kHz)
+
+struct AudioFrameSpan {
+    LPBYTE      m_data;                             // First frame of the span
+    UINT        m_frames;                           // Contiguous frames at m_data
+};
+
+// A region of the ring is at most two contiguous spans (split when it wraps)
+struct AudioFrameSpans {
+    AudioFrameSpan  m_span[2];
+    UINT            m_count;                        // Number of valid spans
+    UINT            m_frames;                       // Total frames in all spans
+
+    AudioFrameSpans() :
+        m_count( 0 ),
+        m_frames( 0 )
+    {}
+};
+
+typedef enum {
+    BUFFER_HEAP = 0,                                // Plain heap allocation (reads and writes may wrap)
+    BUFFER_MIRRORED = 1                             // Same pages mapped twice back to back (never wraps)
+} AudioBufferMode;
+
+typedef enum {
+    READER_BLOCKING = 0,                            // Producer waits for this reader
+    READER_DROP_LAGGING = 1                         // Producer skips this reader ahead rather than wait
+} AudioReaderPolicy;
+
+// Read cursor for one consumer, padded to its own cache line
+struct AudioFrameReader {
+    std::atomic<UINT>   m_read_ptr;                 // Next frame to read is here
+    UINT                m_peek_ptr;                 // Read pointer at the last peekRead() (consumer only)
+    std::atomic<bool>   m_active;
+    AudioReaderPolicy   m_policy;
+    std::atomic<ULONG>  m_dropped_frames;           // Frames skipped because this reader lagged
+    BYTE                m_pad[AUDIO_CACHE_LINE_SIZE];
+};
+
+// Single producer (music delivery) / multiple consumer (render) frame ring.  The producer 
+// only advances the write pointer and each consumer only advances its own read pointer, so 
+// neither side takes a lock.  Pointers run from 0 to 2*capacity-1 so that a full buffer
+// can be told apart from an empty one.
+//
+// Every reader sees every frame.  Free space is set by the slowest READER_BLOCKING reader; 
+// a READER_DROP_LAGGING reader that would block the producer is skipped ahead instead 
+// (its in-flight consumeRead() then fails as it does after reset()).
+//
+// In BUFFER_MIRRORED mode the frame memory is followed by a second mapping of itself, so 
+// any region of the ring is a single contiguous span.
+//
+// Optional watermarks give the producer backpressure: the high water event is set when 
+// the fill level reaches the high mark (or a write comes up short) and the low water 
+// event is set once the consumer has drained it back down to the low mark.
+
+class AudioFrameBuffer
+{
+    UINT    m_frame_capacity;                       // Numer of frame that can be stored
+    UINT    m_frame_size;                           // Size of a frame in bytes
+    BYTE*   m_buffer;                               // Frame data
+
+    AudioBufferMode     m_mode;                     // Backing store in use
+    HANDLE              m_mapping;                  // Page file section (mirrored mode only)
+
+    UINT                m_low_water;                // Signal m_low_water_event at or below this fill level
+    UINT                m_high_water;               // Signal m_high_water_event at or above this fill level
+    HANDLE              m_low_water_event;
+    HANDLE              m_high_water_event;
+    std::atomic<bool>   m_above_high;               // High water reached and not yet drained to low water
+
+    BYTE                m_pad0[AUDIO_CACHE_LINE_SIZE];
+    std::atomic<UINT>   m_write_ptr;                // New frames go here (producer only)
+    BYTE                m_pad1[AUDIO_CACHE_LINE_SIZE];
+    AudioFrameReader    m_readers[MAX_FRAME_READERS];
+
+    AudioFrameBuffer(AudioFrameBuffer& other) {}
+    AudioFrameBuffer& operator=(AudioFrameBuffer& rhs) { return *this; }
+
+public:
+    // A mirrored buffer may round the capacity up to the allocation granularity; if the 
+    // mapping cannot be created the buffer falls back to BUFFER_HEAP.
+    AudioFrameBuffer( UINT frames=AUDIO_RING_FRAMES, UINT channels=2, UINT sample_size=sizeof(int16_t), AudioBufferMode mode=BUFFER_HEAP );
+    ~AudioFrameBuffer();
+
+    inline AudioBufferMode getMode() const {
+        return m_mode;
+    }
+
+    inline UINT getCapacity() const {
+        return m_frame_capacity;
+    }
+
+    // Events may be NULL.  Call before the producer and consumer start.
+    void setWatermarks( UINT low_frames, UINT high_frames, HANDLE low_water_event, HANDLE high_water_event=NULL );
+
+    inline bool isAboveHighWater() const {
+        return m_above_high.load( std::memory_order_relaxed );
+    }
+
+    inline UINT availableSpace() const {
+        return m_frame_capacity-size();
+    }
+
+    // Fill level as seen by the producer (slowest blocking reader)
+    UINT size( void ) const;
+
+    // Frames waiting for one reader
+    inline UINT size( int reader ) const {
+        return distance( m_readers[reader].m_read_ptr.load( std::memory_order_acquire ), 
+                         m_write_ptr.load( std::memory_order_acquire ) );
+    }
+
+    // Discards all readable frames for every reader.  Safe to call from any thread; a 
+    // concurrent read in progress will be dropped.
+    void reset( void );
+
+    // Adds a reader starting at the current write position.  Returns -1 if all reader
+    // slots are in use.
+    int addReader( AudioReaderPolicy policy=READER_BLOCKING );
+    void removeReader( int reader );
+
+    inline ULONG getDroppedFrames( int reader ) const {
+        return m_readers[reader].m_dropped_frames.load( std::memory_order_relaxed );
+    }
+
+    UINT read( UINT32 frames, LPBYTE pData, int reader=0 );
+    UINT write( UINT32 frames, LPBYTE pData );      // Writes what fits; returns frames written
+
+    // Zero-copy producer API - fill the acquired spans in place then commit
+    UINT acquireWrite( UINT32 frames, AudioFrameSpans& spans );
+    void commitWrite( UINT32 frames );
+
+    // Zero-copy consumer API - use the peeked spans in place then consume (frames count from
+    // the last peekRead() on the same reader)
+    UINT peekRead( UINT32 frames, AudioFrameSpans& spans, int reader=0 );
+    bool consumeRead( UINT32 frames, int reader=0 );
+
+    LPBYTE getFramePointer( UINT frame ) {
+        return &m_buffer[ frame * m_frame_size ];
+    }
+
+    inline UINT getFrameSize() const {
+        return m_frame_size;
+    }
+
+private:
+    inline UINT distance( UINT from, UINT to ) const {
+        return ( to >= from ) ? to - from : to + 2*m_frame_capacity - from;
+    }
+
+    inline UINT advance( UINT ptr, UINT frames ) const {
+        ptr += frames;
+        return ( ptr >= 2*m_frame_capacity ) ? ptr - 2*m_frame_capacity : ptr;
+    }
+
+    inline UINT offset( UINT ptr ) const {
+        return ( ptr >= m_frame_capacity ) ? ptr - m_frame_capacity : ptr;
+    }
+
+    void makeSpans( UINT ptr, UINT frames, AudioFrameSpans& spans );
+    UINT writableFrames( UINT write_ptr, UINT frames );
+    void reachedHighWater( void );
+    bool allocateMirrored( void );
+};
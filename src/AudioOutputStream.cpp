@@ -1,415 +1,671 @@
-/* 
-Copyright (C) 2011,2012 Robert DeSantis
-hopluvr at gmail dot com
-
-This file is part of DMX Studio.
- 
-DMX Studio is free software; you can redistribute it and/or modify
-it under the terms of the GNU General Public License as published by
-the Free Software Foundation; either version 3 of the License, or (at your
-option) any later version.
- 
-DMX Studio is distributed in the hope that it will be useful, but
-WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
-or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
-License for more details.
- 
-You should have received a copy of the GNU General Public License
-along with DMX Studio; see the file _COPYING.txt.  If not, write to
-the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
-MA 02111-1307, USA.
-*/
-
-#include "stdafx.h"
-#include "AudioOutputStream.h"
-#include "Functiondiscoverykeys_devpkey.h"
-
-const CLSID CLSID_MMDeviceEnumerator = __uuidof(MMDeviceEnumerator);
-const IID IID_IMMDeviceEnumerator = __uuidof(IMMDeviceEnumerator);
-const IID IID_IAudioClient = __uuidof(IAudioClient);
-const IID IID_IAudioRenderClient = __uuidof(IAudioRenderClient);
-
-AudioRenderDeviceArray AudioOutputStream::audioRenderDevices;
-
-#define AUDIO_OUTPUT_ASSERT( hr, ... ) \
-    if ( !SUCCEEDED(hr) ) { \
-        CString message( "Audio output stream " ); \
-        message.AppendFormat( __VA_ARGS__ ); \
-        message.AppendFormat( " (0x%lx)", hr ); \
-        throw StudioException( __FILE__, __LINE__, (LPCSTR)message ); \
-    }
-
-// ----------------------------------------------------------------------------
-//
-AudioOutputStream* AudioOutputStream::createAudioStream( LPCSTR render_device )
-{
-    AudioOutputStream* audio_stream;
-
-    LPCWSTR endpoint_id = NULL;
-    bool isDefault = ( render_device == NULL || strlen(render_device) == 0 || StrCmpI( render_device, "default" ) == 0 );
-
-    for ( AudioRenderDeviceArray::iterator it=audioRenderDevices.begin();
-            it != audioRenderDevices.end(); it++ ) {
-
-        if ( (isDefault && (*it).m_isDefault) ||
-                (!isDefault && _stricmp( render_device, (*it).m_friendly_name ) == 0) ) {
-            endpoint_id = (LPCWSTR)((*it).m_id);
-            break;
-        }
-    }
-
-    STUDIO_ASSERT( endpoint_id != NULL, "Cannot start unknown audio render device [%s]", render_device );
-
-    audio_stream = new AudioOutputStream( endpoint_id );
-
-    return audio_stream;
-}
-
-// ----------------------------------------------------------------------------
-//
-void AudioOutputStream::releaseAudioStream( AudioOutputStream* audio_stream )
-{
-    if ( audio_stream ) {
-        audio_stream->closeAudioStream();
-        delete audio_stream;
-    }
-}
-
-// ----------------------------------------------------------------------------
-//
-AudioOutputStream::AudioOutputStream( LPCWSTR endpoint_id ) :
-    m_endpoint_id( endpoint_id ),
-    m_pEnumerator( NULL ),
-    m_pDevice( NULL ),
-    m_pAudioClient( NULL ),
-    m_pRenderClient( NULL ),
-    m_pwfx( NULL ),
-    Threadable( "AudioOutputStream" )
-{
-    memset( &m_format, 0, sizeof(WAVEFORMAT) );
-}
-
-// ----------------------------------------------------------------------------
-//
-AudioOutputStream::~AudioOutputStream(void)
-{
-    closeAudioStream();
-}
-
-//-----------------------------------------------------------
-//
-HRESULT AudioOutputStream::openAudioStream( WAVEFORMATEX* format )
-{
-    HRESULT hr;
-    REFERENCE_TIME hnsRequestedDuration = REFTIMES_PER_SEC;
-    LPCSTR audio_render_device = getEndpointDeviceName( m_endpoint_id );
-    
-    memcpy( &m_format, format, sizeof(WAVEFORMATEX) );
-
-    hr = CoCreateInstance(
-           CLSID_MMDeviceEnumerator, NULL,
-           CLSCTX_ALL, IID_IMMDeviceEnumerator,
-           (void**)&m_pEnumerator);
-    AUDIO_OUTPUT_ASSERT( hr, "Cannot create COM device enumerator instance" );
-
-    hr = m_pEnumerator->GetDevice( m_endpoint_id, &m_pDevice );
-    AUDIO_OUTPUT_ASSERT( hr, "GetDevice %S failed", m_endpoint_id );
-
-    hr = m_pDevice->Activate(
-                    IID_IAudioClient, CLSCTX_ALL,
-                    NULL, (void**)&m_pAudioClient);
-    AUDIO_OUTPUT_ASSERT( hr, "Activate failed" );
-
-    hr = m_pAudioClient->GetMixFormat(&m_pwfx);                 // This is what the render device can do
-    AUDIO_OUTPUT_ASSERT( hr, "GetMixFormat failed" );
-
-    log_status( "Audio output stream %s internal format [%d %d-bit channel(s) @ %dHz, format %X]", 
-        audio_render_device, m_pwfx->nChannels,  m_pwfx->wBitsPerSample, m_pwfx->nSamplesPerSec, m_pwfx->wFormatTag );
-
-    hr = m_pAudioClient->Initialize(
-                         AUDCLNT_SHAREMODE_SHARED,
-                         0x80000000,    // AUDCLNT_STREAMFLAGS_AUTOCONVERTPCM | AUDCLNT_STREAMFLAGS_SRC_DEFAULT_QUALITY,
-                         hnsRequestedDuration,
-                         0,
-                         &m_format,
-                         NULL);
-
-    if ( AUDCLNT_E_UNSUPPORTED_FORMAT == hr ) {
-        AUDIO_OUTPUT_ASSERT( hr, "%s does not support [%d %d-bit channel(s) @ %dHz, format %X]", 
-                                 audio_render_device, m_format.nChannels, m_format.wBitsPerSample, 
-                                 m_format.nSamplesPerSec, m_format.wFormatTag );
-    }
-    AUDIO_OUTPUT_ASSERT( hr, "Initialize failed" );
-
-    // Get the size of the allocated buffer.
-    hr = m_pAudioClient->GetBufferSize( &m_bufferFrameCount );
-    AUDIO_OUTPUT_ASSERT( hr, "GetBufferSize failed" );
-
-    hr = m_pAudioClient->GetService(
-                         IID_IAudioRenderClient,
-                         (void**)&m_pRenderClient);
-
-    AUDIO_OUTPUT_ASSERT( hr, "GetService failed" );
-
-    bool started = startThread();
-
-    STUDIO_ASSERT( started, "Audio output stream cannot start thread" );
-
-    return 0;
-}
-
-// ----------------------------------------------------------------------------
-//
-HRESULT AudioOutputStream::closeAudioStream()
-{
-    stopThread();
-
-    if ( m_pwfx ) {
-        CoTaskMemFree(m_pwfx);
-        m_pwfx = NULL;
-    }
-
-    SAFE_RELEASE(m_pEnumerator)
-    SAFE_RELEASE(m_pDevice)
-    SAFE_RELEASE(m_pAudioClient)
-    SAFE_RELEASE(m_pRenderClient)
-
-    return 0;
-}
-
-// ----------------------------------------------------------------------------
-//
-LPCSTR AudioOutputStream::getEndpointDeviceName( LPCWSTR endpoint_id )
-{
-    for ( AudioRenderDeviceArray::iterator it=audioRenderDevices.begin();
-            it != audioRenderDevices.end(); it++ ) {
-        if ( wcscmp( endpoint_id, (*it).m_id ) == 0 )
-            return (*it).m_friendly_name;
-    }
-
-    return "UNKNOWN";
-}
-
-// ----------------------------------------------------------------------------
-//
-UINT AudioOutputStream::run(void) 
-{
-    LPCSTR audio_render_device = getEndpointDeviceName( m_endpoint_id );
-
-    log_status( "Audio stream started [%s, %d %d-bit channel(s) @ %dHz, format %X]", 
-        audio_render_device, m_format.nChannels, m_format.wBitsPerSample, m_format.nSamplesPerSec, m_format.wFormatTag );
-
-    try {
-        while ( isRunning() ) {
-            if ( m_ring_buffer.size() > 0 || ::WaitForSingleObject( m_play_event, 100 ) == WAIT_OBJECT_0 ) {
-                playAudioStream( );
-                m_play_event.ResetEvent();
-            }
-        }
-    }
-    catch ( std::exception& ex ) {
-        log( ex );
-        return -1;
-    }
-
-    log_status( "Audio stream stopped" );
-
-    return 0;
-}
-
-// ----------------------------------------------------------------------------
-//
-HRESULT AudioOutputStream::playAudioStream( )
-{
-    HRESULT hr;
-    REFERENCE_TIME hnsActualDuration;
-
-    // Calculate the actual duration of the allocated buffer.
-    hnsActualDuration = (REFERENCE_TIME)((double)REFTIMES_PER_SEC *
-                                            m_bufferFrameCount / m_pwfx->nSamplesPerSec );
-
-    hr = m_pAudioClient->Start(); 
-    AUDIO_OUTPUT_ASSERT( hr, "Start failed" );
-
-    m_playing = true;
-    m_paused = false;
-
-    // Each loop fills about half of the shared buffer.
-    while ( isRunning() && m_playing )
-    {
-        UINT32 framesCopied;
-
-        if ( !m_paused ) {
-            UINT32 numFramesPadding;
-            BYTE *pData;
-
-            // See how much buffer space is available.
-            hr = m_pAudioClient->GetCurrentPadding( &numFramesPadding );
-            AUDIO_OUTPUT_ASSERT( hr, "GetCurrentPadding failed" );
-
-            UINT32 numFramesAvailable = m_bufferFrameCount - numFramesPadding;
-
-            // Grab all the available space in the shared buffer.
-            hr = m_pRenderClient->GetBuffer( numFramesAvailable, &pData );
-            AUDIO_OUTPUT_ASSERT( hr, "GetBuffer failed" );
-
-            framesCopied = fillBuffer( numFramesAvailable, pData );
-
-            hr = m_pRenderClient->ReleaseBuffer( framesCopied, 0 );
-            AUDIO_OUTPUT_ASSERT( hr, "ReleaseBuffer failed" );
-        }
-        else
-            framesCopied = 1;       // To stop the exit
-
-        // Sleep for half the buffer duration.
-        ::WaitForSingleObject( m_play_wait, (DWORD)(hnsActualDuration/REFTIMES_PER_MILLISEC/2) );
-
-        if ( framesCopied == 0 )        // We are done
-            break;
-    }
-    
-    if ( !m_paused ) {
-        hr = m_pAudioClient->Stop();
-        AUDIO_OUTPUT_ASSERT( hr, "Stop failed" );
-    }
-
-    hr = m_pAudioClient->Reset();  // Reset stream's clock & buffers
-    AUDIO_OUTPUT_ASSERT( hr, "Reset failed" );
-
-    m_paused = m_playing = false;
-
-    return hr;
-}
-
-// ----------------------------------------------------------------------------
-//
-void AudioOutputStream::cancel() 
-{
-    CSingleLock lock( &m_buffer_mutex, TRUE );
-
-    m_playing = false;
-    m_ring_buffer.reset();
-    m_play_wait.SetEvent();
-}
-
-// ----------------------------------------------------------------------------
-//
-UINT32 AudioOutputStream::fillBuffer( UINT32 numFramesAvailable, LPBYTE pData )
-{
-    CSingleLock lock( &m_buffer_mutex, TRUE );
-
-    UINT32 framesCopied = m_ring_buffer.read( numFramesAvailable, pData );
-
-    // printf( "framesCopied=%d\n", framesCopied );
-
-    return framesCopied;
-}
-
-// ----------------------------------------------------------------------------
-//
-bool AudioOutputStream::addSamples( UINT32 frames, UINT32 channels, UINT32 sample_rate, LPBYTE pData )
-{
-    CSingleLock lock( &m_buffer_mutex, TRUE );
-    
-    // TODO VERIFY SAMPLE FORMAT
-
-    bool success = m_ring_buffer.write( frames, pData );
-
-    if ( success ) 
-        m_play_event.SetEvent();
-
-    return success;
-}
-
-// ----------------------------------------------------------------------------
-// Collect audio render devices
-//
-void AudioOutputStream::collectAudioRenderDevices( )
-{
-    HRESULT hr;
-    IMMDeviceEnumerator *pEnumerator = NULL;
-    IMMDeviceCollection *pDevices = NULL;
-    IMMDevice *pDevice = NULL;
-    IPropertyStore *pProperties = NULL;
-    LPWSTR pstrId = NULL;
-    LPWSTR pstrDefaultId = NULL;
-    UINT cDevices = 0;
-
-    audioRenderDevices.clear();
-
-    try {
-        hr = CoCreateInstance(
-               CLSID_MMDeviceEnumerator, NULL,
-               CLSCTX_ALL, IID_IMMDeviceEnumerator,
-               (void**)&pEnumerator);
-        AUDIO_OUTPUT_ASSERT( hr, "Cannot create COM device enumerator instance" );
-
-        hr = pEnumerator->EnumAudioEndpoints( eRender, DEVICE_STATE_ACTIVE, &pDevices );
-        AUDIO_OUTPUT_ASSERT( hr, "Cannot enumerate audio devices" );
-
-        // Get the default audio endpoint (if we don't get one its not an error)
-        hr = pEnumerator->GetDefaultAudioEndpoint( eRender, eConsole, &pDevice );
-        if ( SUCCEEDED(hr) ) {
-            pDevice->GetId( &pstrDefaultId );
-            SAFE_RELEASE( pDevice );
-        }
-
-        // Get count of audio capture devices
-        hr = pDevices->GetCount( &cDevices );
-        AUDIO_OUTPUT_ASSERT( hr, "Cannot get audio device count" );
-
-        log_status( "Found %d audio capture devices", cDevices );
-
-        // Suck up the render device names and default
-        for ( UINT i=0; i < cDevices; i++ ) {
-            hr = pDevices->Item( i, &pDevice );
-            AUDIO_OUTPUT_ASSERT( hr, "Cannot get IMMDevice" );
-
-            hr = pDevice->GetId( &pstrId );
-            AUDIO_OUTPUT_ASSERT( hr, "Cannot get IMMDevice Id" );
-
-            hr = pDevice->OpenPropertyStore( STGM_READ, &pProperties );
-            AUDIO_OUTPUT_ASSERT( hr, "Cannot open IMMDevice property store" );
-
-            PROPVARIANT varName;
-            // Initialize container for property value.
-            PropVariantInit(&varName);
-
-            // Get the endpoint's friendly-name property.
-            hr = pProperties->GetValue( PKEY_Device_DeviceDesc , &varName);
-            AUDIO_OUTPUT_ASSERT( hr, "Cannot open IMMDevice name property" );
-
-            bool isDefault = pstrDefaultId != NULL && wcscmp( pstrId, pstrDefaultId ) == 0;
-            CW2A friendly_name( varName.pwszVal );
-
-            audioRenderDevices.push_back( AudioRenderDevice( pstrId, friendly_name.m_psz, isDefault) ); 
-
-            log_status( "Registering audio render device '%s'%s", 
-                        friendly_name.m_psz, isDefault ? " [Default]" : "" );
-
-            CoTaskMemFree( pstrId );
-            pstrId = NULL;
-
-            PropVariantClear(&varName);
-
-            SAFE_RELEASE( pProperties );
-            SAFE_RELEASE( pDevice );
-        }
-
-        SAFE_RELEASE( pDevices );
-        SAFE_RELEASE( pEnumerator );
-
-        CoTaskMemFree( pstrDefaultId );
-    }
-    catch ( ... ) {
-        CoTaskMemFree( pstrDefaultId );
-        CoTaskMemFree( pstrId );
-
-        SAFE_RELEASE( pProperties );
-        SAFE_RELEASE( pDevice );
-        SAFE_RELEASE( pDevices );
-        SAFE_RELEASE( pEnumerator );
-
-        throw;
-    }
-}
+/* 
+Copyright (C) 2011,2012 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+ 
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+ 
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+ 
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+#include "stdafx.h"
+#include "AudioOutputStream.h"
+#include "WasapiAudioSink.h"
+#include "NullAudioSink.h"
+#include "FileAudioSink.h"
+#include "SimulatedAudioSink.h"
+#include "Functiondiscoverykeys_devpkey.h"
+
+const CLSID CLSID_MMDeviceEnumerator = __uuidof(MMDeviceEnumerator);
+const IID IID_IMMDeviceEnumerator = __uuidof(IMMDeviceEnumerator);
+
+AudioRenderDeviceArray AudioOutputStream::audioRenderDevices;
+
+// ----------------------------------------------------------------------------
+// render_device selects the sink:
+//
+//      NULL, "", "default"     Default WASAPI render device
+//      <friendly name>         Named WASAPI render device
+//      null                    Discard frames as fast as they arrive
+//      file:<path>             Record to a WAV file (.raw or .pcm for headerless PCM)
+//      simulated[:<multiple>]  48kHz float device clocked at a multiple of real time
+//
+// If source is supplied the new stream is a tap rendering the source stream's audio.
+//
+AudioOutputStream* AudioOutputStream::createAudioStream( LPCSTR render_device, AudioOutputStream* source )
+{
+    AudioSink* sink = createAudioSink( render_device );
+
+    if ( source != NULL )
+        return new AudioOutputStream( sink, source );
+
+    return new AudioOutputStream( sink );
+}
+
+// ----------------------------------------------------------------------------
+//
+AudioSink* AudioOutputStream::createAudioSink( LPCSTR render_device )
+{
+    if ( render_device != NULL ) {
+        if ( _stricmp( render_device, "null" ) == 0 )
+            return new NullAudioSink();
+
+        if ( _strnicmp( render_device, "file:", 5 ) == 0 ) {
+            LPCSTR filename = &render_device[5];
+            LPCSTR extension = PathFindExtension( filename );
+            bool raw = _stricmp( extension, ".raw" ) == 0 || _stricmp( extension, ".pcm" ) == 0;
+
+            return new FileAudioSink( filename, raw );
+        }
+
+        if ( _strnicmp( render_device, "simulated", 9 ) == 0 ) {
+            double multiple = ( render_device[9] == ':' ) ? atof( &render_device[10] ) : 1.0;
+            STUDIO_ASSERT( multiple > 0.0, "Invalid simulated audio device clock multiple [%s]", render_device );
+
+            WAVEFORMATEX mix_format;
+            mix_format.wFormatTag = WAVE_FORMAT_IEEE_FLOAT;
+            mix_format.nChannels = 2;
+            mix_format.nSamplesPerSec = 48000;
+            mix_format.wBitsPerSample = 32;
+            mix_format.nBlockAlign = (mix_format.wBitsPerSample * mix_format.nChannels) / 8;
+            mix_format.nAvgBytesPerSec = mix_format.nSamplesPerSec * mix_format.nBlockAlign;
+            mix_format.cbSize = 0;
+
+            return new SimulatedAudioSink( &mix_format, multiple );
+        }
+    }
+
+    LPCWSTR endpoint_id = NULL;
+    LPCSTR friendly_name = NULL;
+    bool isDefault = ( render_device == NULL || strlen(render_device) == 0 || StrCmpI( render_device, "default" ) == 0 );
+
+    for ( AudioRenderDeviceArray::iterator it=audioRenderDevices.begin();
+            it != audioRenderDevices.end(); it++ ) {
+
+        if ( (isDefault && (*it).m_isDefault) ||
+                (!isDefault && _stricmp( render_device, (*it).m_friendly_name ) == 0) ) {
+            endpoint_id = (LPCWSTR)((*it).m_id);
+            friendly_name = (LPCSTR)((*it).m_friendly_name);
+            break;
+        }
+    }
+
+    STUDIO_ASSERT( endpoint_id != NULL, "Cannot start unknown audio render device [%s]", render_device );
+
+    return new WasapiAudioSink( endpoint_id, friendly_name );
+}
+
+// ----------------------------------------------------------------------------
+//
+void AudioOutputStream::releaseAudioStream( AudioOutputStream* audio_stream )
+{
+    if ( audio_stream ) {
+        audio_stream->closeAudioStream();
+        delete audio_stream;
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+AudioOutputStream::AudioOutputStream( AudioSink* sink ) :
+    m_sink( sink ),
+    m_source( NULL ),
+    m_reader_policy( READER_BLOCKING ),
+    m_reader( 0 ),
+    m_render_format( NULL ),
+    m_render_period_ms( DEFAULT_RENDER_PERIOD_MS ),
+    m_converter( NULL ),
+    m_converter_reset( false ),
+    m_resampler_quality( RESAMPLE_MEDIUM ),
+    m_format_warning( false ),
+    m_ring_buffer( new AudioFrameBuffer( AUDIO_RING_FRAMES, 2, sizeof(int16_t), BUFFER_MIRRORED ) ),
+    m_end_of_stream( false ),
+    m_device_padding( 0 ),
+    m_playing( false ),
+    m_paused( false ),
+    Threadable( "AudioOutputStream" )
+{
+    memset( &m_format, 0, sizeof(WAVEFORMAT) );
+
+    for ( UINT i=0; i < MAX_AUDIO_TAPS; i++ )
+        m_taps[i] = NULL;
+
+    // Delivery waits above 90% full and resumes once render has drained to half
+    UINT capacity = m_ring_buffer->getCapacity();
+    m_ring_buffer->setWatermarks( capacity / 2, capacity - capacity / 10, m_space_event );
+}
+
+// ----------------------------------------------------------------------------
+// Tap - renders the source stream's ring through its own read cursor.  A blocking tap 
+// holds back delivery to its own pace; a drop lagging tap skips audio instead.
+//
+AudioOutputStream::AudioOutputStream( AudioSink* sink, AudioOutputStream* source, AudioReaderPolicy policy ) :
+    m_sink( sink ),
+    m_source( source ),
+    m_reader_policy( policy ),
+    m_reader( -1 ),
+    m_render_format( NULL ),
+    m_render_period_ms( DEFAULT_RENDER_PERIOD_MS ),
+    m_converter( NULL ),
+    m_converter_reset( false ),
+    m_resampler_quality( RESAMPLE_MEDIUM ),
+    m_format_warning( false ),
+    m_ring_buffer( source->m_ring_buffer ),
+    m_end_of_stream( false ),
+    m_device_padding( 0 ),
+    m_playing( false ),
+    m_paused( false ),
+    Threadable( "AudioOutputStreamTap" )
+{
+    STUDIO_ASSERT( !source->isTap(), "Audio output stream cannot tap another tap" );
+
+    memset( &m_format, 0, sizeof(WAVEFORMAT) );
+
+    for ( UINT i=0; i < MAX_AUDIO_TAPS; i++ )
+        m_taps[i] = NULL;
+}
+
+// ----------------------------------------------------------------------------
+//
+AudioOutputStream::~AudioOutputStream(void)
+{
+    closeAudioStream();
+
+    if ( !isTap() )
+        delete m_ring_buffer;
+
+    delete m_sink;
+}
+
+// ----------------------------------------------------------------------------
+//
+void AudioOutputStream::attachTap( AudioOutputStream* tap )
+{
+    for ( UINT i=0; i < MAX_AUDIO_TAPS; i++ ) {
+        AudioOutputStream* empty = NULL;
+        if ( m_taps[i].compare_exchange_strong( empty, tap ) )
+            return;
+    }
+
+    STUDIO_ASSERT( false, "Audio output stream has too many taps" );
+}
+
+// ----------------------------------------------------------------------------
+//
+void AudioOutputStream::detachTap( AudioOutputStream* tap )
+{
+    for ( UINT i=0; i < MAX_AUDIO_TAPS; i++ ) {
+        AudioOutputStream* attached = tap;
+        if ( m_taps[i].compare_exchange_strong( attached, NULL ) )
+            return;
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+static bool isSameFormat( const WAVEFORMATEX* a, const WAVEFORMATEX* b )
+{
+    return AudioFormatConverter::getSampleType( a ) == AudioFormatConverter::getSampleType( b ) &&
+           AudioFormatConverter::getSampleType( a ) != SAMPLE_UNSUPPORTED &&
+           a->nChannels == b->nChannels &&
+           a->nSamplesPerSec == b->nSamplesPerSec;
+}
+
+//-----------------------------------------------------------
+//
+HRESULT AudioOutputStream::openAudioStream( WAVEFORMATEX* format )
+{
+    LPCSTR audio_render_device = m_sink->getName();
+    
+    memcpy( &m_format, format, sizeof(WAVEFORMATEX) );
+
+    if ( isTap() ) {
+        STUDIO_ASSERT( format->nBlockAlign == m_ring_buffer->getFrameSize(), 
+            "Audio output stream tap %s format does not match its source", audio_render_device );
+
+        m_reader = m_ring_buffer->addReader( m_reader_policy );
+
+        STUDIO_ASSERT( m_reader != -1, "Audio output stream %s no ring buffer reader available", audio_render_device );
+    }
+
+    m_sink->open();
+
+    const WAVEFORMATEX* mix_format = m_sink->getMixFormat();        // This is what the render device can do
+
+    if ( mix_format != NULL )
+        log_status( "Audio output stream %s internal format [%d %d-bit channel(s) @ %dHz, format %X]", 
+            audio_render_device, mix_format->nChannels,  mix_format->wBitsPerSample, mix_format->nSamplesPerSec, mix_format->wFormatTag );
+
+    // Feed the device its native mix format if we can convert to it ourselves, otherwise
+    // fall back to having the shared mode mixer convert.  Sinks without a mix format take 
+    // the source format as is.
+    bool auto_convert = true;
+    m_render_format = &m_format;
+
+    if ( mix_format == NULL || isSameFormat( &m_format, mix_format ) )
+        auto_convert = false;
+    else if ( AudioFormatConverter::canConvert( &m_format, mix_format ) ) {
+        m_converter = new AudioFormatConverter( &m_format, mix_format, (ResamplerQuality)m_resampler_quality.load() );
+        m_render_format = mix_format;
+        auto_convert = false;
+
+        log_status( "Audio output stream %s converting to mix format (%s, %s resampling)", audio_render_device,
+            getSimdLevelName( m_converter->getSimdLevel() ), 
+            m_converter->isResampling() ? PolyphaseResampler::getQualityName( m_converter->getEffectiveQuality() ) : "no" );
+    }
+
+    m_sink->initialize( m_render_format, auto_convert, m_render_period_ms > 0, m_render_period_ms );
+
+    if ( m_sink->isEventDriven() )
+        log_status( "Audio output stream %s event driven, %ums period, %u frame buffer", 
+            audio_render_device, m_render_period_ms, m_sink->getBufferFrames() );
+    else
+        log_status( "Audio output stream %s timer driven, %u frame buffer", audio_render_device, m_sink->getBufferFrames() );
+
+    bool started = startThread();
+
+    STUDIO_ASSERT( started, "Audio output stream cannot start thread" );
+
+    if ( isTap() ) {
+        m_source->attachTap( this );
+
+        log_status( "Audio output stream %s tapping %s (%s)", audio_render_device, m_source->getSink()->getName(),
+            m_reader_policy == READER_DROP_LAGGING ? "drops when lagging" : "blocking" );
+    }
+
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+//
+HRESULT AudioOutputStream::closeAudioStream()
+{
+    // The render thread reads through m_reader until it has stopped
+    interrupt();
+    stopThread();
+
+    if ( isTap() ) {
+        m_source->detachTap( this );
+
+        if ( m_reader != -1 ) {
+            m_ring_buffer->removeReader( m_reader );
+            m_reader = -1;
+        }
+    }
+
+    if ( m_converter ) {
+        delete m_converter;
+        m_converter = NULL;
+    }
+
+    m_sink->close();
+    m_render_format = NULL;
+
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+//
+UINT AudioOutputStream::run(void) 
+{
+    LPCSTR audio_render_device = m_sink->getName();
+
+    log_status( "Audio stream started [%s, %d %d-bit channel(s) @ %dHz, format %X]", 
+        audio_render_device, m_format.nChannels, m_format.wBitsPerSample, m_format.nSamplesPerSec, m_format.wFormatTag );
+
+    log_status( "Audio stream ring buffer %u frames (%s)", m_ring_buffer->getCapacity(),
+        m_ring_buffer->getMode() == BUFFER_MIRRORED ? "mirrored" : "heap" );
+
+    try {
+        while ( isRunning() ) {
+            if ( getCachedSamples() > 0 || ::WaitForSingleObject( m_play_event, 100 ) == WAIT_OBJECT_0 ) {
+                playAudioStream( );
+                m_play_event.ResetEvent();
+            }
+        }
+    }
+    catch ( std::exception& ex ) {
+        log( ex );
+        return -1;
+    }
+
+    log_status( "Audio stream stopped" );
+
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+// Timer mode fills about half of the (one second) shared buffer each pass.  Event mode 
+// tops the buffer up each time the device signals a period has been consumed.
+//
+HRESULT AudioOutputStream::playAudioStream( )
+{
+    DWORD wait_ms;
+
+    if ( m_sink->isEventDriven() )
+        wait_ms = m_render_period_ms * 4;               // Only reached if the device stalls (or paused)
+    else
+        wait_ms = (DWORD)((ULONGLONG)m_sink->getBufferFrames() * 1000 / m_render_format->nSamplesPerSec / 2);
+
+    m_sink->start();
+
+    m_playing = true;
+    m_paused = false;
+
+    bool primed = false;                                // First fill of a pass starts from an empty device
+
+    while ( isRunning() && m_playing )
+    {
+        bool done = false;
+
+        if ( !m_paused ) {
+            // See how much buffer space is available.
+            UINT32 numFramesPadding = m_sink->getPadding();
+
+            // Device frames are at the mix rate once we convert
+            m_device_padding.store( (UINT32)((ULONGLONG)numFramesPadding * m_format.nSamplesPerSec / m_render_format->nSamplesPerSec), 
+                                    std::memory_order_relaxed );
+
+            UINT32 numFramesAvailable = m_sink->getBufferFrames() - numFramesPadding;
+
+            if ( numFramesAvailable > 0 ) {
+                UINT32 ringFrames = getCachedSamples();
+
+                // Grab all the available space in the shared buffer.
+                LPBYTE pData = m_sink->getBuffer( numFramesAvailable );
+
+                UINT32 framesCopied = fillBuffer( numFramesAvailable, pData );
+
+                m_sink->releaseBuffer( framesCopied );
+
+                m_stats.filled( numFramesAvailable, framesCopied, ringFrames, numFramesPadding, primed, isEndOfStream() );
+                m_stats.rendered( getCachedSamples() );
+                primed = true;
+
+                // The stream has ended and played out.  A ring that is only momentarily empty
+                // (delivery running late) keeps the device running.
+                done = ( isEndOfStream() && framesCopied == 0 && getCachedSamples() == 0 && numFramesPadding == 0 );
+            }
+        }
+
+        m_sink->waitForBuffer( m_play_wait, wait_ms );
+
+        if ( done )                                     // We are done
+            break;
+    }
+    
+    if ( !m_paused )
+        m_sink->stop();
+
+    m_sink->reset();                                    // Reset stream's clock & buffers
+
+    m_device_padding = 0;
+
+    m_paused = m_playing = false;
+
+    if ( m_converter && m_converter->getResamplerCost() > 0.0 )
+        log_status( "Audio stream %s resampler cost %.1fus per second of audio", 
+            PolyphaseResampler::getQualityName( m_converter->getEffectiveQuality() ), m_converter->getResamplerCost() );
+
+    if ( isTap() && getDroppedFrames() > 0 )
+        log_status( "Audio stream tap %s has dropped %lu lagging frames", m_sink->getName(), getDroppedFrames() );
+
+    m_stats.log( m_sink->getName(), m_format.nSamplesPerSec );
+
+    return S_OK;
+}
+
+// ----------------------------------------------------------------------------
+// Discards everything buffered for the primary and all of its taps
+//
+void AudioOutputStream::cancel() 
+{
+    if ( isTap() ) {
+        m_source->cancel();
+        return;
+    }
+
+    interrupt();
+
+    m_ring_buffer->reset();
+
+    for ( UINT i=0; i < MAX_AUDIO_TAPS; i++ ) {
+        AudioOutputStream* tap = m_taps[i].load();
+        if ( tap )
+            tap->interrupt();
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+void AudioOutputStream::interrupt() 
+{
+    m_playing = false;
+    m_converter_reset = true;
+    m_stats.resync();
+    m_play_wait.SetEvent();
+}
+
+// ----------------------------------------------------------------------------
+//
+UINT32 AudioOutputStream::fillBuffer( UINT32 numFramesAvailable, LPBYTE pData )
+{
+    AudioFrameSpans spans;
+
+    if ( m_converter == NULL ) {
+        UINT32 framesCopied = m_ring_buffer->peekRead( numFramesAvailable, spans, m_reader );
+
+        for ( UINT i=0; i < spans.m_count; i++ ) {
+            UINT size = spans.m_span[i].m_frames * m_ring_buffer->getFrameSize();
+            memcpy( pData, spans.m_span[i].m_data, size );
+            pData = &pData[ size ];
+        }
+
+        if ( !m_ring_buffer->consumeRead( framesCopied, m_reader ) )   // Cancelled or skipped while copying
+            return 0;
+
+        // printf( "framesCopied=%d\n", framesCopied );
+
+        return framesCopied;
+    }
+
+    if ( m_converter_reset.exchange( false ) )
+        m_converter->reset();
+
+    ResamplerQuality quality = (ResamplerQuality)m_resampler_quality.load( std::memory_order_relaxed );
+    if ( quality != m_converter->getResamplerQuality() ) {
+        m_converter->setResamplerQuality( quality );
+        log_status( "Audio stream resampler quality %s", PolyphaseResampler::getQualityName( m_converter->getEffectiveQuality() ) );
+    }
+
+    // Ring frames are in the source format, device buffer frames are in the mix format
+    UINT32 framesAvailable = m_ring_buffer->peekRead( m_converter->getInputFramesNeeded( numFramesAvailable ), spans, m_reader );
+    UINT32 framesCopied = 0;
+    UINT32 framesConsumed = 0;
+
+    for ( UINT i=0; i < spans.m_count && framesCopied < numFramesAvailable; i++ ) {
+        UINT consumed;
+
+        framesCopied += m_converter->convert( spans.m_span[i].m_data, spans.m_span[i].m_frames, 
+                                              &pData[ framesCopied * m_render_format->nBlockAlign ], 
+                                              numFramesAvailable - framesCopied, &consumed );
+        framesConsumed += consumed;
+
+        if ( consumed < spans.m_span[i].m_frames )
+            break;
+    }
+
+    // A frame held back as interpolation look-ahead at the end of the stream would never
+    // play; drop it so the stream can drain.  Otherwise it is waiting for more input.
+    if ( framesCopied == 0 && framesAvailable > 0 && isEndOfStream() ) {
+        framesConsumed = framesAvailable;
+        m_converter->reset();
+    }
+
+    if ( !m_ring_buffer->consumeRead( framesConsumed, m_reader ) ) {     // Cancelled or skipped while converting
+        m_converter->reset();
+        return 0;
+    }
+
+    return framesCopied;
+}
+
+// ----------------------------------------------------------------------------
+// Frames are copied straight into the ring and as many as fit are accepted.  If written
+// is supplied it receives the ring spans holding the new frames; they remain valid until 
+// the next addSamples().
+//
+UINT32 AudioOutputStream::addSamples( UINT32 frames, UINT32 channels, UINT32 sample_rate, LPBYTE pData, AudioFrameSpans* written )
+{
+    STUDIO_ASSERT( !isTap(), "Audio output stream taps cannot be fed directly" );
+
+    if ( channels != m_format.nChannels || sample_rate != m_format.nSamplesPerSec ) {
+        if ( !m_format_warning ) {
+            log_status( "Audio output stream rejecting samples [%u channel(s) @ %uHz], stream is [%u channel(s) @ %uHz]",
+                channels, sample_rate, m_format.nChannels, m_format.nSamplesPerSec );
+            m_format_warning = true;
+        }
+        return frames;                          // Discard - a consumed delivery keeps libspotify moving
+    }
+
+    AudioFrameSpans spans;
+    UINT32 offered = frames;
+
+    frames = m_ring_buffer->acquireWrite( frames, spans );
+    if ( frames == 0 ) {
+        m_stats.delivered( 0, offered );
+        return 0;
+    }
+
+    for ( UINT i=0; i < spans.m_count; i++ ) {
+        UINT size = spans.m_span[i].m_frames * m_ring_buffer->getFrameSize();
+        memcpy( spans.m_span[i].m_data, pData, size );
+        pData = &pData[ size ];
+    }
+
+    m_ring_buffer->commitWrite( frames );
+
+    m_end_of_stream = false;
+
+    m_stats.delivered( frames, offered );           // After the commit so render never sees uncommitted frames as played
+
+    if ( written )
+        *written = spans;
+
+    // Only wake render threads when they are idle - avoids a kernel call on every delivery
+    if ( !m_playing ) 
+        m_play_event.SetEvent();
+
+    for ( UINT i=0; i < MAX_AUDIO_TAPS; i++ ) {
+        AudioOutputStream* tap = m_taps[i].load( std::memory_order_acquire );
+        if ( tap && !tap->m_playing )
+            tap->m_play_event.SetEvent();
+    }
+
+    return frames;
+}
+
+// ----------------------------------------------------------------------------
+// Collect audio render devices
+//
+void AudioOutputStream::collectAudioRenderDevices( )
+{
+    HRESULT hr;
+    IMMDeviceEnumerator *pEnumerator = NULL;
+    IMMDeviceCollection *pDevices = NULL;
+    IMMDevice *pDevice = NULL;
+    IPropertyStore *pProperties = NULL;
+    LPWSTR pstrId = NULL;
+    LPWSTR pstrDefaultId = NULL;
+    UINT cDevices = 0;
+
+    audioRenderDevices.clear();
+
+    try {
+        hr = CoCreateInstance(
+               CLSID_MMDeviceEnumerator, NULL,
+               CLSCTX_ALL, IID_IMMDeviceEnumerator,
+               (void**)&pEnumerator);
+        AUDIO_OUTPUT_ASSERT( hr, "Cannot create COM device enumerator instance" );
+
+        hr = pEnumerator->EnumAudioEndpoints( eRender, DEVICE_STATE_ACTIVE, &pDevices );
+        AUDIO_OUTPUT_ASSERT( hr, "Cannot enumerate audio devices" );
+
+        // Get the default audio endpoint (if we don't get one its not an error)
+        hr = pEnumerator->GetDefaultAudioEndpoint( eRender, eConsole, &pDevice );
+        if ( SUCCEEDED(hr) ) {
+            pDevice->GetId( &pstrDefaultId );
+            SAFE_RELEASE( pDevice );
+        }
+
+        // Get count of audio capture devices
+        hr = pDevices->GetCount( &cDevices );
+        AUDIO_OUTPUT_ASSERT( hr, "Cannot get audio device count" );
+
+        log_status( "Found %d audio capture devices", cDevices );
+
+        // Suck up the render device names and default
+        for ( UINT i=0; i < cDevices; i++ ) {
+            hr = pDevices->Item( i, &pDevice );
+            AUDIO_OUTPUT_ASSERT( hr, "Cannot get IMMDevice" );
+
+            hr = pDevice->GetId( &pstrId );
+            AUDIO_OUTPUT_ASSERT( hr, "Cannot get IMMDevice Id" );
+
+            hr = pDevice->OpenPropertyStore( STGM_READ, &pProperties );
+            AUDIO_OUTPUT_ASSERT( hr, "Cannot open IMMDevice property store" );
+
+            PROPVARIANT varName;
+            // Initialize container for property value.
+            PropVariantInit(&varName);
+
+            // Get the endpoint's friendly-name property.
+            hr = pProperties->GetValue( PKEY_Device_DeviceDesc , &varName);
+            AUDIO_OUTPUT_ASSERT( hr, "Cannot open IMMDevice name property" );
+
+            bool isDefault = pstrDefaultId != NULL && wcscmp( pstrId, pstrDefaultId ) == 0;
+            CW2A friendly_name( varName.pwszVal );
+
+            audioRenderDevices.push_back( AudioRenderDevice( pstrId, friendly_name.m_psz, isDefault) ); 
+
+            log_status( "Registering audio render device '%s'%s", 
+                        friendly_name.m_psz, isDefault ? " [Default]" : "" );
+
+            CoTaskMemFree( pstrId );
+            pstrId = NULL;
+
+            PropVariantClear(&varName);
+
+            SAFE_RELEASE( pProperties );
+            SAFE_RELEASE( pDevice );
+        }
+
+        SAFE_RELEASE( pDevices );
+        SAFE_RELEASE( pEnumerator );
+
+        CoTaskMemFree( pstrDefaultId );
+    }
+    catch ( ... ) {
+        CoTaskMemFree( pstrDefaultId );
+        CoTaskMemFree( pstrId );
+
+        SAFE_RELEASE( pProperties );
+        SAFE_RELEASE( pDevice );
+        SAFE_RELEASE( pDevices );
+        SAFE_RELEASE( pEnumerator );
+
+        throw;
+    }
+}
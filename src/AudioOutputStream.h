@@ -1,131 +1,225 @@
-/* 
-Copyright (C) 2011,2012 Robert DeSantis
-hopluvr at gmail dot com
-
-This file is part of DMX Studio.
- 
-DMX Studio is free software; you can redistribute it and/or modify
-it under the terms of the GNU General Public License as published by
-the Free Software Foundation; either version 3 of the License, or (at your
-option) any later version.
- 
-DMX Studio is distributed in the hope that it will be useful, but
-WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
-or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
-License for more details.
- 
-You should have received a copy of the GNU General Public License
-along with DMX Studio; see the file _COPYING.txt.  If not, write to
-the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
-MA 02111-1307, USA.
-*/
-
-#pragma once
-
-#include "stdafx.h"
-#include "Threadable.h"
-#include "AudioFrameBuffer.h"
-#include "Audiosessiontypes.h"
-
-#define SAFE_RELEASE(punk)  \
-              if ((punk) != NULL)  \
-                { (punk)->Release(); (punk) = NULL; }
-
-// REFERENCE_TIME time units per second and per millisecond
-#define REFTIMES_PER_SEC  10000000
-#define REFTIMES_PER_MILLISEC  10000
-
-typedef enum {
-    LEFT_CHANNEL = 0,
-    RIGHT_CHANNEL = 1
-} AudioChannel;
-
-struct AudioRenderDevice {
-    CStringW	m_id;
-    CString		m_friendly_name;
-    bool		m_isDefault;
-
-    AudioRenderDevice( LPWSTR id, LPSTR friendly_name, bool isDefault ) :
-        m_id( id ),
-        m_friendly_name( friendly_name ),
-        m_isDefault( isDefault )
-    {}
-};
-
-typedef std::vector<AudioRenderDevice> AudioRenderDeviceArray;
-
-class AudioOutputStream : public Threadable
-{
-    CStringW					m_endpoint_id;				// Device endpoint ID
-    WAVEFORMATEX          		m_format;
-
-    UINT32						m_bufferFrameCount;
-    IMMDeviceEnumerator *		m_pEnumerator;
-    IMMDevice *					m_pDevice;
-    IAudioClient *				m_pAudioClient;
-    IAudioRenderClient *		m_pRenderClient;
-    WAVEFORMATEX *				m_pwfx;
-
-    CMutex						m_buffer_mutex;
-    CEvent                      m_play_event;
-    CEvent                      m_play_wait;
-    AudioFrameBuffer            m_ring_buffer;
-    bool                        m_playing;
-    bool                        m_paused;
-
-    UINT run(void);
-
-public:
-    AudioOutputStream( LPCWSTR endpoint_id=NULL );
-    virtual ~AudioOutputStream(void);
-
-    bool addSamples( UINT32 frames, UINT32 channels, UINT32 sample_rate, LPBYTE pData );
-
-    WAVEFORMATEX getFormat( ) const {
-        return m_format;
-    }
-
-    unsigned getSamplesPerSecond() const {
-        return m_format.nSamplesPerSec;
-    }
-
-    UINT getCachedSamples(void) const {
-        return m_ring_buffer.size();
-    }
-
-    void setPaused( bool paused ) {
-        if ( m_paused != paused ) {
-            m_paused = paused;
-            if ( m_paused )
-                m_pAudioClient->Stop();
-            else
-                m_pAudioClient->Start();
-        }
-    }
-
-    bool isPlaying() const {
-        return m_playing;
-    }
-
-    bool isPaused() const {
-        return m_paused;
-    }
-
-    void cancel(void);
-
-    virtual HRESULT openAudioStream( WAVEFORMATEX* format );
-    virtual HRESULT closeAudioStream();
-
-    static void collectAudioRenderDevices();
-    static AudioRenderDeviceArray audioRenderDevices;
-
-    static AudioOutputStream* createAudioStream( LPCSTR render_device=NULL );
-    static void releaseAudioStream( AudioOutputStream* audio_stream );
-
-private:
-    HRESULT playAudioStream();
-    UINT32 fillBuffer( UINT32 numFramesAvailable, LPBYTE pData );
-
-    LPCSTR getEndpointDeviceName( LPCWSTR endpoint_id );
-};
-
+/* 
+Copyright (C) 2011,2012 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+ 
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+ 
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+ 
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+#pragma once
+
+#include "stdafx.h"
+#include "Threadable.h"
+#include "AudioFrameBuffer.h"
+#include "AudioFormatConverter.h"
+#include "AudioSink.h"
+#include "AudioStats.h"
+#include "Audiosessiontypes.h"
+
+// Event driven render period limits (0 selects the timer driven one second buffer)
+#define MIN_RENDER_PERIOD_MS        5
+#define MAX_RENDER_PERIOD_MS        20
+#define DEFAULT_RENDER_PERIOD_MS    10
+
+typedef enum {
+    LEFT_CHANNEL = 0,
+    RIGHT_CHANNEL = 1
+} AudioChannel;
+
+struct AudioRenderDevice {
+    CStringW	m_id;
+    CString		m_friendly_name;
+    bool		m_isDefault;
+
+    AudioRenderDevice( LPWSTR id, LPSTR friendly_name, bool isDefault ) :
+        m_id( id ),
+        m_friendly_name( friendly_name ),
+        m_isDefault( isDefault )
+    {}
+};
+
+typedef std::vector<AudioRenderDevice> AudioRenderDeviceArray;
+
+#define MAX_AUDIO_TAPS              (MAX_FRAME_READERS-1)
+
+// A stream either owns its ring (the primary, fed by addSamples) or is a tap that renders
+// a second copy of the primary's ring through its own read cursor.
+//
+class AudioOutputStream : public Threadable
+{
+    AudioSink *                 m_sink;                     // Render device (owned)
+    AudioOutputStream *         m_source;                   // Primary stream when this is a tap
+    AudioReaderPolicy           m_reader_policy;
+    int                         m_reader;                   // Our read cursor in the ring
+    std::atomic<AudioOutputStream*> m_taps[MAX_AUDIO_TAPS]; // Taps reading our ring
+    WAVEFORMATEX          		m_format;
+    const WAVEFORMATEX *        m_render_format;            // Format written to the sink
+    UINT                        m_render_period_ms;         // Event driven period (0 for timer mode)
+    AudioFormatConverter *      m_converter;                // NULL when the mixer converts for us
+    std::atomic<bool>           m_converter_reset;          // Discard resampler history on next fill
+    std::atomic<int>            m_resampler_quality;        // Requested ResamplerQuality (applied by render thread)
+    bool                        m_format_warning;
+
+    CEvent                      m_play_event;
+    CEvent                      m_play_wait;
+    CEvent                      m_space_event;              // Ring has drained to its low water mark
+    AudioFrameBuffer *          m_ring_buffer;              // Owned by the primary stream
+    std::atomic<bool>           m_end_of_stream;            // No more frames follow the ring's (primary only)
+    std::atomic<UINT32>         m_device_padding;           // Frames queued in the device at the last fill (source rate)
+    AudioStats                  m_stats;
+    bool                        m_playing;
+    bool                        m_paused;
+
+    UINT run(void);
+
+public:
+    AudioOutputStream( AudioSink* sink );
+    AudioOutputStream( AudioSink* sink, AudioOutputStream* source, AudioReaderPolicy policy=READER_DROP_LAGGING );
+    virtual ~AudioOutputStream(void);
+
+    UINT32 addSamples( UINT32 frames, UINT32 channels, UINT32 sample_rate, LPBYTE pData, AudioFrameSpans* written=NULL );
+
+    bool waitForSpace( DWORD wait_ms ) {
+        return ::WaitForSingleObject( m_space_event, wait_ms ) == WAIT_OBJECT_0;
+    }
+
+    WAVEFORMATEX getFormat( ) const {
+        return m_format;
+    }
+
+    unsigned getSamplesPerSecond() const {
+        return m_format.nSamplesPerSec;
+    }
+
+    UINT getCachedSamples(void) const {
+        return m_ring_buffer->size( m_reader );
+    }
+
+    // Frames buffered but not yet played (ring plus device), in the source format
+    UINT getBufferedSamples(void) const {
+        return m_ring_buffer->size( m_reader ) + m_device_padding.load( std::memory_order_relaxed );
+    }
+
+    // Position of the frame now playing in the delivered frame count (primary only).  Frames
+    // discarded by cancel() are skipped over, so it only ever moves forward.
+    ULONGLONG getPlayedFrames(void) const {
+        ULONGLONG delivered = m_stats.getFramesDelivered();
+        UINT buffered = getBufferedSamples();
+        return ( delivered > buffered ) ? delivered - buffered : 0;
+    }
+
+    // Frames this tap missed because it fell too far behind the primary
+    ULONG getDroppedFrames(void) const {
+        return m_ring_buffer->getDroppedFrames( m_reader );
+    }
+
+    AudioStats& getStats() {
+        return m_stats;
+    }
+
+    // Extra read cursors on the ring for consumers that are not taps (primary stream only)
+    int addRingReader( AudioReaderPolicy policy ) {
+        return m_ring_buffer->addReader( policy );
+    }
+
+    void removeRingReader( int reader ) {
+        m_ring_buffer->removeReader( reader );
+    }
+
+    UINT peekRing( int reader, UINT32 frames, AudioFrameSpans& spans ) {
+        return m_ring_buffer->peekRead( frames, spans, reader );
+    }
+
+    bool consumeRing( int reader, UINT32 frames ) {
+        return m_ring_buffer->consumeRead( frames, reader );
+    }
+
+    UINT getRingBacklog( int reader ) const {
+        return m_ring_buffer->size( reader );
+    }
+
+    ULONG getRingDroppedFrames( int reader ) const {
+        return m_ring_buffer->getDroppedFrames( reader );
+    }
+
+    bool isTap() const {
+        return m_source != NULL;
+    }
+
+    void setPaused( bool paused ) {
+        if ( m_paused != paused ) {
+            m_paused = paused;
+            if ( m_paused )
+                m_sink->stop();
+            else
+                m_sink->start();
+        }
+    }
+
+    // Takes effect when the stream is opened
+    void setRenderPeriod( UINT period_ms ) {
+        m_render_period_ms = ( period_ms == 0 ) ? 0 : min( max( period_ms, MIN_RENDER_PERIOD_MS ), MAX_RENDER_PERIOD_MS );
+    }
+
+    AudioSink* getSink() const {
+        return m_sink;
+    }
+
+    void setResamplerQuality( ResamplerQuality quality ) {
+        m_resampler_quality = quality;
+    }
+
+    bool isPlaying() const {
+        return m_playing;
+    }
+
+    bool isPaused() const {
+        return m_paused;
+    }
+
+    void cancel(void);
+
+    // The frames in the ring are the last of the stream (cleared by the next delivery)
+    void setEndOfStream( void ) {
+        m_end_of_stream = true;
+        m_play_wait.SetEvent();
+    }
+
+    bool isEndOfStream( void ) const {
+        return isTap() ? m_source->m_end_of_stream.load() : m_end_of_stream.load();
+    }
+
+    virtual HRESULT openAudioStream( WAVEFORMATEX* format );
+    virtual HRESULT closeAudioStream();
+
+    static void collectAudioRenderDevices();
+    static AudioRenderDeviceArray audioRenderDevices;
+
+    static AudioOutputStream* createAudioStream( LPCSTR render_device=NULL, AudioOutputStream* source=NULL );
+    static void releaseAudioStream( AudioOutputStream* audio_stream );
+
+private:
+    static AudioSink* createAudioSink( LPCSTR render_device );
+
+    void attachTap( AudioOutputStream* tap );
+    void detachTap( AudioOutputStream* tap );
+    void interrupt(void);
+
+    HRESULT playAudioStream();
+    UINT32 fillBuffer( UINT32 numFramesAvailable, LPBYTE pData );
+};
+
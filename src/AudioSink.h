@@ -0,0 +1,85 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#pragma once
+
+#include "stdafx.h"
+
+#define SAFE_RELEASE(punk)  \
+              if ((punk) != NULL)  \
+                { (punk)->Release(); (punk) = NULL; }
+
+// REFERENCE_TIME time units per second and per millisecond
+#define REFTIMES_PER_SEC  10000000
+#define REFTIMES_PER_MILLISEC  10000
+
+#define AUDIO_TIMER_BUFFER_MS   1000                // Device buffer in timer mode (the largest a real time sink uses)
+
+#define AUDIO_OUTPUT_ASSERT( hr, ... ) \
+    if ( !SUCCEEDED(hr) ) { \
+        CString message( "Audio output stream " ); \
+        message.AppendFormat( __VA_ARGS__ ); \
+        message.AppendFormat( " (0x%lx)", hr ); \
+        throw StudioException( __FILE__, __LINE__, (LPCSTR)message ); \
+    }
+
+// Render device as seen by the AudioOutputStream render loop.  Modelled on the subset of
+// the WASAPI shared mode IAudioClient/IAudioRenderClient the loop uses so the scheduling
+// logic can be driven by other clocks.  Failures throw StudioException.
+
+class AudioSink
+{
+public:
+    virtual ~AudioSink() {}
+
+    virtual LPCSTR getName( void ) const = 0;
+
+    // Acquire the device; the mix format is available afterwards
+    virtual void open( void ) = 0;
+    virtual void close( void ) = 0;
+
+    // Native format of the device
+    virtual const WAVEFORMATEX* getMixFormat( void ) const = 0;
+
+    // Prepare to render frames in format.  auto_convert allows formats other than the mix
+    // format.  Event driven sinks signal every period_ms; if the sink cannot do that it falls 
+    // back to timer mode (check isEventDriven()).
+    virtual void initialize( const WAVEFORMATEX* format, bool auto_convert, bool event_driven, UINT period_ms ) = 0;
+
+    virtual bool isEventDriven( void ) const = 0;
+    virtual UINT32 getBufferFrames( void ) const = 0;
+
+    // Frames queued in the sink but not yet played
+    virtual UINT32 getPadding( void ) = 0;
+
+    virtual BYTE* getBuffer( UINT32 frames ) = 0;
+    virtual void releaseBuffer( UINT32 frames ) = 0;
+
+    virtual void start( void ) = 0;
+    virtual void stop( void ) = 0;
+    virtual void reset( void ) = 0;
+
+    // Block until the sink wants more frames, wake is signaled or timeout_ms elapses.  
+    // Returns true if the sink is ready for more frames.
+    virtual bool waitForBuffer( HANDLE wake, DWORD timeout_ms ) = 0;
+};
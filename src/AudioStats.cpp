@@ -0,0 +1,283 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#include "stdafx.h"
+#include "AudioStats.h"
+
+// ----------------------------------------------------------------------------
+//
+UINT AudioHistogram::getBucket( ULONG value )
+{
+    UINT bucket = 0;
+
+    while ( value != 0 && bucket < AUDIO_HISTOGRAM_BUCKETS-1 ) {
+        value >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+// ----------------------------------------------------------------------------
+//
+void AudioHistogram::reset( void )
+{
+    for ( UINT i=0; i < AUDIO_HISTOGRAM_BUCKETS; i++ )
+        m_buckets[i] = 0;
+
+    m_count = 0;
+    m_min = ULONG_MAX;
+    m_max = 0;
+    m_sum = 0;
+}
+
+// ----------------------------------------------------------------------------
+// Single writer so plain load/store is enough for min and max
+//
+void AudioHistogram::record( ULONG value )
+{
+    m_buckets[ getBucket( value ) ].fetch_add( 1, std::memory_order_relaxed );
+    m_sum.fetch_add( value, std::memory_order_relaxed );
+
+    if ( value < m_min.load( std::memory_order_relaxed ) )
+        m_min.store( value, std::memory_order_relaxed );
+    if ( value > m_max.load( std::memory_order_relaxed ) )
+        m_max.store( value, std::memory_order_relaxed );
+
+    m_count.fetch_add( 1, std::memory_order_release );
+}
+
+// ----------------------------------------------------------------------------
+//
+void AudioHistogram::getInfo( AudioHistogramInfo* info ) const
+{
+    info->count = m_count.load( std::memory_order_acquire );
+    info->min = ( info->count > 0 ) ? m_min.load( std::memory_order_relaxed ) : 0;
+    info->max = m_max.load( std::memory_order_relaxed );
+    info->mean = ( info->count > 0 ) ? (ULONG)(m_sum.load( std::memory_order_relaxed ) / info->count) : 0;
+
+    for ( UINT i=0; i < AUDIO_HISTOGRAM_BUCKETS; i++ )
+        info->buckets[i] = m_buckets[i].load( std::memory_order_relaxed );
+}
+
+// ----------------------------------------------------------------------------
+//
+ULONG AudioHistogram::getPercentile( double percentile ) const
+{
+    ULONG count = m_count.load( std::memory_order_acquire );
+    if ( count == 0 )
+        return 0;
+
+    ULONG target = (ULONG)ceil( count * percentile / 100.0 );
+    ULONG seen = 0;
+
+    for ( UINT i=0; i < AUDIO_HISTOGRAM_BUCKETS; i++ ) {
+        seen += m_buckets[i].load( std::memory_order_relaxed );
+
+        if ( seen >= target )
+            return min( ( i == 0 ) ? 0 : (ULONG)((1ULL << i) - 1), m_max.load( std::memory_order_relaxed ) );
+    }
+
+    return m_max.load( std::memory_order_relaxed );
+}
+
+// ----------------------------------------------------------------------------
+//
+AudioStats::AudioStats() :
+    m_frames_delivered( 0 ),
+    m_frames_deferred( 0 ),
+    m_mark_head( 0 ),
+    m_mark_tail( 0 ),
+    m_resync( false )
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency( &frequency );
+    m_tick_frequency = frequency.QuadPart;
+
+    reset();
+}
+
+// ----------------------------------------------------------------------------
+// The delivered total also positions the latency marks so it is never zeroed - the
+// reported count starts again from a base.  Outstanding marks stay valid.
+//
+void AudioStats::reset( void )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    m_delivered_base = m_frames_delivered.load( std::memory_order_relaxed );
+    m_deferred_base = m_frames_deferred.load( std::memory_order_relaxed );
+
+    m_frames_rendered = 0;
+    m_fills = 0;
+    m_underruns = 0;
+    m_device_starved = 0;
+    m_stutter_reported = 0;
+
+    m_ring_fill.reset();
+    m_device_padding.reset();
+    m_latency.reset();
+}
+
+// ----------------------------------------------------------------------------
+// Producer - counts the delivery and marks the time its last frame arrived.  If the marks
+// are all in flight this delivery simply goes unmeasured.
+//
+void AudioStats::delivered( UINT32 accepted, UINT32 offered )
+{
+    m_frames_deferred.fetch_add( offered - accepted, std::memory_order_relaxed );
+
+    if ( accepted == 0 )
+        return;
+
+    ULONGLONG frame_end = m_frames_delivered.fetch_add( accepted, std::memory_order_release ) + accepted;
+
+    UINT head = m_mark_head.load( std::memory_order_relaxed );
+    if ( head - m_mark_tail.load( std::memory_order_acquire ) >= AUDIO_LATENCY_MARKS )
+        return;
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter( &now );
+
+    DeliveryMark& mark = m_marks[ head & (AUDIO_LATENCY_MARKS-1) ];
+    mark.m_frame_end = frame_end;
+    mark.m_ticks = now.QuadPart;
+
+    m_mark_head.store( head + 1, std::memory_order_release );
+}
+
+// ----------------------------------------------------------------------------
+// Render thread - one device buffer fill.  The device is starved when it has played out
+// everything queued; that is an underrun when the ring could not refill it either (delivery
+// fell behind) rather than the render thread waking late.  A partial fill with audio still
+// queued in the device is not starvation, and neither is the first fill of a play pass or
+// the device draining at the end of the stream.
+//
+void AudioStats::filled( UINT32 requested, UINT32 rendered, UINT32 ring_fill, UINT32 device_padding, bool primed, bool end_of_stream )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    m_fills.fetch_add( 1, std::memory_order_relaxed );
+    m_frames_rendered.fetch_add( rendered, std::memory_order_relaxed );
+
+    m_ring_fill.record( ring_fill );
+    m_device_padding.record( device_padding );
+
+    if ( primed && !end_of_stream && device_padding == 0 ) {
+        m_device_starved.fetch_add( 1, std::memory_order_relaxed );
+
+        if ( rendered < requested )
+            m_underruns.fetch_add( 1, std::memory_order_relaxed );
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Render thread - every delivered frame not still in the ring has been handed to the 
+// device, so retire the delivery marks it covers and record how long they took.
+//
+void AudioStats::rendered( UINT32 ring_remaining )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    ULONGLONG delivered = m_frames_delivered.load( std::memory_order_acquire );
+    ULONGLONG consumed = ( delivered > ring_remaining ) ? delivered - ring_remaining : 0;
+
+    bool discard = m_resync.exchange( false );
+
+    UINT tail = m_mark_tail.load( std::memory_order_relaxed );
+    UINT head = m_mark_head.load( std::memory_order_acquire );
+
+    if ( tail == head )
+        return;
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter( &now );
+
+    while ( tail != head ) {
+        DeliveryMark& mark = m_marks[ tail & (AUDIO_LATENCY_MARKS-1) ];
+
+        if ( mark.m_frame_end > consumed && !discard )
+            break;
+
+        if ( !discard )
+            m_latency.record( (ULONG)((now.QuadPart - mark.m_ticks) * 1000000 / m_tick_frequency) );
+
+        tail++;
+    }
+
+    m_mark_tail.store( tail, std::memory_order_release );
+}
+
+// ----------------------------------------------------------------------------
+//
+ULONG AudioStats::takeStutter( void )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    ULONG underruns = m_underruns.load( std::memory_order_relaxed );
+
+    return underruns - m_stutter_reported.exchange( underruns );
+}
+
+// ----------------------------------------------------------------------------
+//
+void AudioStats::getInfo( AudioStatsInfo* info ) const
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    info->frames_delivered = m_frames_delivered.load( std::memory_order_relaxed ) - m_delivered_base;
+    info->frames_deferred = m_frames_deferred.load( std::memory_order_relaxed ) - m_deferred_base;
+    info->frames_rendered = m_frames_rendered.load( std::memory_order_relaxed );
+    info->fills = m_fills.load( std::memory_order_relaxed );
+    info->underruns = m_underruns.load( std::memory_order_relaxed );
+    info->device_starved = m_device_starved.load( std::memory_order_relaxed );
+    info->monitor_dropped_frames = 0;
+    info->analysis_dropped_frames = 0;
+    info->analysis_degraded_frames = 0;
+
+    m_ring_fill.getInfo( &info->ring_fill );
+    m_device_padding.getInfo( &info->device_padding );
+    m_latency.getInfo( &info->latency_us );
+}
+
+// ----------------------------------------------------------------------------
+// Percentiles are bucket upper bounds
+//
+void AudioStats::log( LPCSTR name, UINT sample_rate ) const
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    if ( m_fills.load( std::memory_order_relaxed ) == 0 )
+        return;
+
+    log_status( "Audio stream %s: %I64u frames delivered, %I64u deferred, %I64u rendered, %lu fills, %lu underruns, %lu device starved",
+        name, m_frames_delivered.load() - m_delivered_base, m_frames_deferred.load() - m_deferred_base, m_frames_rendered.load(), 
+        m_fills.load(), m_underruns.load(), m_device_starved.load() );
+
+    log_status( "Audio stream %s: ring fill p10 %lums p50 %lums, device padding p10 %lu p50 %lu frames, latency p50 %lums p99 %lums",
+        name, 
+        sample_rate ? m_ring_fill.getPercentile( 10 ) * 1000 / sample_rate : 0,
+        sample_rate ? m_ring_fill.getPercentile( 50 ) * 1000 / sample_rate : 0,
+        m_device_padding.getPercentile( 10 ), m_device_padding.getPercentile( 50 ),
+        m_latency.getPercentile( 50 ) / 1000, m_latency.getPercentile( 99 ) / 1000 );
+}
@@ -0,0 +1,118 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#pragma once
+
+#include "stdafx.h"
+#include "MusicPlayerApi.h"
+
+#define AUDIO_LATENCY_MARKS     1024                // Delivery time marks in flight (power of 2)
+
+// Log2 bucketed histogram.  Recorded from one thread and read from any; a snapshot taken
+// while recording may be slightly inconsistent but is never invalid.
+//
+class AudioHistogram
+{
+    std::atomic<ULONG>      m_buckets[AUDIO_HISTOGRAM_BUCKETS];
+    std::atomic<ULONG>      m_count;
+    std::atomic<ULONG>      m_min;
+    std::atomic<ULONG>      m_max;
+    std::atomic<ULONGLONG>  m_sum;
+
+public:
+    AudioHistogram() {
+        reset();
+    }
+
+    void reset( void );
+    void record( ULONG value );
+    void getInfo( AudioHistogramInfo* info ) const;
+
+    // Upper bound of the bucket holding the given percentile (0-100)
+    ULONG getPercentile( double percentile ) const;
+
+    inline ULONG getCount() const {
+        return m_count.load( std::memory_order_relaxed );
+    }
+
+    static UINT getBucket( ULONG value );
+};
+
+// Audio path counters for one output stream.  delivered() is called by the producer 
+// (music delivery); filled() and rendered() by the render thread.  reset() may come from
+// any thread - it holds m_lock against the render thread and leaves the producer's totals
+// running, starting them again from a base instead.
+//
+class AudioStats
+{
+    struct DeliveryMark {
+        ULONGLONG           m_frame_end;            // Total delivered frames including this delivery
+        LONGLONG            m_ticks;                // When it was delivered
+    };
+
+    std::atomic<ULONGLONG>  m_frames_delivered;
+    std::atomic<ULONGLONG>  m_frames_deferred;
+    std::atomic<ULONGLONG>  m_frames_rendered;
+    std::atomic<ULONG>      m_fills;
+    std::atomic<ULONG>      m_underruns;
+    std::atomic<ULONG>      m_device_starved;
+    std::atomic<ULONG>      m_stutter_reported;     // Underruns already reported by takeStutter()
+    ULONGLONG               m_delivered_base;       // Producer totals at the last reset
+    ULONGLONG               m_deferred_base;
+
+    mutable CCriticalSection m_lock;                // Render thread and reset / readers
+
+    AudioHistogram          m_ring_fill;
+    AudioHistogram          m_device_padding;
+    AudioHistogram          m_latency;
+
+    DeliveryMark            m_marks[AUDIO_LATENCY_MARKS];
+    std::atomic<UINT>       m_mark_head;            // Producer only
+    std::atomic<UINT>       m_mark_tail;            // Render thread only
+    std::atomic<bool>       m_resync;               // Buffered frames were discarded
+    LONGLONG                m_tick_frequency;
+
+public:
+    AudioStats();
+
+    void delivered( UINT32 accepted, UINT32 offered );
+    void filled( UINT32 requested, UINT32 rendered, UINT32 ring_fill, UINT32 device_padding, bool primed, bool end_of_stream );
+    void rendered( UINT32 ring_remaining );
+
+    // Buffered frames were discarded (cancel) - their delivery marks must not count as latency
+    void resync( void ) {
+        m_resync = true;
+    }
+
+    // Frames accepted since the stream was created (not cleared by reset)
+    ULONGLONG getFramesDelivered( void ) const {
+        return m_frames_delivered.load( std::memory_order_acquire );
+    }
+
+    // Underruns since the last call (libspotify's stutter count)
+    ULONG takeStutter( void );
+
+    void reset( void );
+    void getInfo( AudioStatsInfo* info ) const;
+    void log( LPCSTR name, UINT sample_rate ) const;
+};
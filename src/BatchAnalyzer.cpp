@@ -0,0 +1,342 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+#include "stdafx.h"
+#include "BatchAnalyzer.h"
+#include "AudioFormatConverter.h"
+#include "TrackAnalysisFile.h"
+#include "SimpleJsonParser.h"
+
+#include <io.h>
+
+// ----------------------------------------------------------------------------
+// Workers are only stopped once the whole batch is done
+//
+UINT BatchAnalyzeWorker::run()
+{
+    while ( isRunning() ) {
+        if ( !m_batch->analyzeNext() )
+            Sleep( BATCH_IDLE_MS );
+    }
+
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+//
+BatchAnalyzer::BatchAnalyzer( AnalysisPack& pack, SimdLevel simd ) :
+    m_pack( pack ),
+    m_simd( simd ),
+    m_next_track( 0 ),
+    m_finished( 0 ),
+    m_analyzed( 0 ),
+    m_done( FALSE, TRUE )
+{
+}
+
+// ----------------------------------------------------------------------------
+//
+bool BatchAnalyzer::loadManifest( LPCSTR manifest_file )
+{
+    FILE* hFile = _fsopen( manifest_file, "rt", _SH_DENYWR );
+    if ( hFile == NULL ) {
+        log( "Unable to read batch manifest %s", manifest_file );
+        return false;
+    }
+
+    fseek( hFile, 0L, SEEK_END );
+    size_t size = ftell( hFile );
+    rewind( hFile );
+
+    CString data;
+    size = fread( data.GetBufferSetLength(size), 1, size, hFile );
+    data.ReleaseBufferSetLength( size );
+    fclose( hFile );
+
+    // Relative file names are relative to the manifest
+    CString directory( manifest_file );
+    int separator = max( directory.ReverseFind( '\\' ), directory.ReverseFind( '/' ) );
+    directory = directory.Left( separator+1 );
+
+    SimpleJsonParser parser;
+    std::set<CString> links;
+
+    try {
+        parser.parse( data );
+
+        for ( JsonNode* node : parser.getObjects( "tracks" ) ) {
+            BatchTrack track;
+
+            track.m_link = node->get<CString>( "link" );
+
+            // Two workers would write the same track's analysis
+            if ( !links.insert( track.m_link ).second )
+                throw StudioException( "Track %s is listed more than once", (LPCSTR)track.m_link );
+
+            track.m_filename = node->get<CString>( "file" );
+            track.m_sample_rate = node->get<UINT>( "sample_rate", RAW_PCM_SAMPLE_RATE );
+            track.m_channels = node->get<UINT>( "channels", RAW_PCM_CHANNELS );
+
+            bool absolute = track.m_filename.Find( ':' ) != -1 || 
+                            track.m_filename.Left( 1 ) == "\\" || track.m_filename.Left( 1 ) == "/";
+
+            if ( !absolute )
+                track.m_filename = directory + track.m_filename;
+
+            m_tracks.push_back( track );
+        }
+    }
+    catch ( std::exception& e ) {
+        log( StudioException( "Batch manifest %s error (%s)", manifest_file, e.what() ) );
+        m_tracks.clear();
+        return false;
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+//
+UINT BatchAnalyzer::analyze( UINT max_threads )
+{
+    if ( m_tracks.empty() )
+        return 0;
+
+    SYSTEM_INFO system_info;
+    GetSystemInfo( &system_info );
+
+    UINT threads = ( max_threads > 0 ) ? max_threads : system_info.dwNumberOfProcessors;
+    threads = max( 1U, min( threads, (UINT)m_tracks.size() ) );
+
+    m_next_track = m_finished = m_analyzed = 0;
+    m_done.ResetEvent();
+
+    DWORD start = GetCurrentTime();
+
+    log_status( "Batch analyzing %u tracks on %u threads", (UINT)m_tracks.size(), threads );
+
+    BatchAnalyzeWorkerArray workers;
+
+    for ( UINT i=0; i < threads; i++ ) {
+        BatchAnalyzeWorker* worker = new BatchAnalyzeWorker( this );
+
+        if ( worker->startThread() )
+            workers.push_back( worker );
+        else
+            delete worker;
+    }
+
+    if ( workers.empty() )
+        return 0;
+
+    ::WaitForSingleObject( m_done, INFINITE );
+
+    for ( BatchAnalyzeWorker* worker : workers ) {
+        // A stop is only seen once the thread is running
+        while ( !worker->isRunning() )
+            Sleep( 1 );
+
+        worker->stopThread();
+        delete worker;
+    }
+
+    log_status( "Batch analyzed %u of %u tracks in %lu ms", m_analyzed, (UINT)m_tracks.size(), GetCurrentTime() - start );
+
+    return m_analyzed;
+}
+
+// ----------------------------------------------------------------------------
+// Analyzes the next track in the batch.  Returns false once every track has been 
+// handed out.
+//
+bool BatchAnalyzer::analyzeNext( void )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    if ( m_next_track >= m_tracks.size() )
+        return false;
+
+    const BatchTrack& track = m_tracks[ m_next_track++ ];
+
+    lock.Unlock();
+
+    bool analyzed = false;
+
+    try {
+        analyzed = analyzeTrack( track );
+    }
+    catch ( std::exception& ex ) {
+        log( ex );
+    }
+
+    lock.Lock();
+
+    if ( analyzed )
+        m_analyzed++;
+
+    if ( ++m_finished == m_tracks.size() )
+        m_done.SetEvent();
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// The whole track goes through one analyzer, so it is saved with complete coverage
+// (short of any truncation)
+//
+bool BatchAnalyzer::analyzeTrack( const BatchTrack& track )
+{
+    WAVEFORMATEXTENSIBLE format;
+    ULONGLONG data_bytes = 0;
+
+    FILE* hFile = openTrackFile( track, format, data_bytes );
+    if ( hFile == NULL )
+        return false;
+
+    UINT frame_size = format.Format.nBlockAlign;
+    ULONGLONG frames = data_bytes / frame_size;
+    DWORD length_ms = (DWORD)(frames * 1000 / format.Format.nSamplesPerSec);
+
+    TrackAnalyzer* analyzer = TrackAnalyzer::create( &format.Format, length_ms, track.m_link, 0, m_simd );
+
+    std::vector<BYTE> buffer( BATCH_READ_FRAMES * frame_size );
+
+    while ( frames > 0 ) {
+        UINT count = (UINT)min( frames, (ULONGLONG)BATCH_READ_FRAMES );
+        UINT read = (UINT)fread( &buffer[0], frame_size, count, hFile );
+
+        if ( read > 0 )
+            analyzer->addData( read, &buffer[0] );
+
+        if ( read < count ) {
+            log( "Track file '%s' is truncated", (LPCSTR)track.m_filename );
+            break;
+        }
+
+        frames -= count;
+    }
+
+    fclose( hFile );
+
+    analyzer->finishData();
+
+    TrackAnalysisData analysis;
+    analysis.m_info = analyzer->captureAnalyzerData();
+    analysis.m_bands = analyzer->captureBandData();
+    analysis.m_beats = analyzer->captureBeatData();
+    analysis.m_pyramid = analyzer->capturePyramid();
+    analysis.m_loudness = analyzer->captureLoudnessData();
+    analysis.m_coverage = analyzer->getCoverage();
+
+    delete analyzer;
+
+    bool written = m_pack.write( analysis );
+
+    freeTrackAnalysisData( analysis );
+
+    return written;
+}
+
+// ----------------------------------------------------------------------------
+// Leaves the file at the first sample
+//
+FILE* BatchAnalyzer::openTrackFile( const BatchTrack& track, WAVEFORMATEXTENSIBLE& format, ULONGLONG& data_bytes )
+{
+    FILE* hFile = _fsopen( track.m_filename, "rb", _SH_DENYWR );
+    if ( hFile == NULL ) {
+        log( "Unable to open track file '%s'", (LPCSTR)track.m_filename );
+        return NULL;
+    }
+
+    memset( &format, 0, sizeof(format) );
+
+    if ( track.m_filename.Right( 4 ).CompareNoCase( ".wav" ) == 0 ) {
+        if ( !readWaveHeader( hFile, format, data_bytes ) || AudioFormatConverter::getSampleType( &format.Format ) == SAMPLE_UNSUPPORTED ) {
+            log( "Track file '%s' is not a 16-bit PCM or 32-bit float WAV file", (LPCSTR)track.m_filename );
+            fclose( hFile );
+            return NULL;
+        }
+    }
+    else {
+        format.Format.wFormatTag = WAVE_FORMAT_PCM;
+        format.Format.nChannels = (WORD)track.m_channels;
+        format.Format.nSamplesPerSec = track.m_sample_rate;
+        format.Format.wBitsPerSample = 16;
+        format.Format.nBlockAlign = format.Format.nChannels * sizeof(int16_t);
+        format.Format.nAvgBytesPerSec = format.Format.nSamplesPerSec * format.Format.nBlockAlign;
+
+        data_bytes = _filelengthi64( _fileno( hFile ) );
+    }
+
+    if ( !TrackAnalyzer::canAnalyze( &format.Format ) ) {
+        log( "Track file '%s' has an unsupported channel count or sample rate", (LPCSTR)track.m_filename );
+        fclose( hFile );
+        return NULL;
+    }
+
+    return hFile;
+}
+
+// ----------------------------------------------------------------------------
+// Walks the RIFF chunks to the data chunk.  A zero or oversized data length (a 
+// render that was never closed) means the rest of the file.
+//
+bool BatchAnalyzer::readWaveHeader( FILE* hFile, WAVEFORMATEXTENSIBLE& format, ULONGLONG& data_bytes )
+{
+    char riff[12];
+
+    if ( fread( riff, 1, sizeof(riff), hFile ) != sizeof(riff) || memcmp( riff, "RIFF", 4 ) != 0 || memcmp( &riff[8], "WAVE", 4 ) != 0 )
+        return false;
+
+    bool have_format = false;
+
+    while ( true ) {
+        char chunk_id[4];
+        DWORD chunk_size;
+
+        if ( fread( chunk_id, 1, 4, hFile ) != 4 || fread( &chunk_size, sizeof(DWORD), 1, hFile ) != 1 )
+            return false;
+
+        if ( memcmp( chunk_id, "data", 4 ) == 0 ) {
+            ULONGLONG remaining = _filelengthi64( _fileno( hFile ) ) - _ftelli64( hFile );
+
+            data_bytes = ( chunk_size == 0 || chunk_size > remaining ) ? remaining : chunk_size;
+
+            return have_format;
+        }
+
+        LONGLONG skip = chunk_size + (chunk_size & 1);          // Chunks are word aligned
+
+        if ( memcmp( chunk_id, "fmt ", 4 ) == 0 ) {
+            DWORD size = min( chunk_size, (DWORD)sizeof(format) );
+
+            if ( fread( &format, 1, size, hFile ) != size )
+                return false;
+
+            skip -= size;
+            have_format = true;
+        }
+
+        if ( _fseeki64( hFile, skip, SEEK_CUR ) != 0 )
+            return false;
+    }
+}
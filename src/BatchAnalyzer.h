@@ -0,0 +1,107 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+#pragma once
+
+#include "stdafx.h"
+#include "Threadable.h"
+#include "TrackAnalyzer.h"
+#include "AnalysisPack.h"
+
+#define BATCH_READ_FRAMES           44100       // Frames read from a file at a time
+#define BATCH_IDLE_MS               50          // Idle worker sleep until the batch stops it
+#define RAW_PCM_SAMPLE_RATE         44100       // Raw PCM defaults (WAV files carry their own format)
+#define RAW_PCM_CHANNELS            2
+
+struct BatchTrack {
+    CString     m_link;
+    CString     m_filename;
+    UINT        m_sample_rate;                  // Raw PCM only
+    UINT        m_channels;                     // Raw PCM only
+};
+
+typedef std::vector<BatchTrack> BatchTrackArray;
+
+class BatchAnalyzer;
+
+// Analyzes whole tracks from the batch until there are none left
+//
+class BatchAnalyzeWorker : public Threadable
+{
+    BatchAnalyzer*      m_batch;
+
+    virtual UINT run();
+
+public:
+    BatchAnalyzeWorker( BatchAnalyzer* batch ) :
+        Threadable( "BatchAnalyzeWorker" ),
+        m_batch( batch )
+    {}
+};
+
+typedef std::vector<BatchAnalyzeWorker*> BatchAnalyzeWorkerArray;
+
+// Runs the track analyzer over local renders of tracks and writes the results to the
+// analysis cache as if each track had been played through.  Tracks are analyzed in 
+// parallel, one per core.
+//
+// The manifest maps track links to 16-bit PCM or 32-bit float WAV files, or raw 16-bit 
+// interleaved PCM.
+// Relative file names are relative to the manifest.
+//
+//  { "tracks": [
+//      { "link": "spotify:track:...", "file": "render.wav" },
+//      { "link": "spotify:track:...", "file": "render.pcm", "sample_rate": 48000, "channels": 2 }
+//  ] }
+//
+class BatchAnalyzer
+{
+    AnalysisPack&       m_pack;                 // Receives the analysis
+    SimdLevel           m_simd;
+    BatchTrackArray     m_tracks;
+
+    CCriticalSection    m_lock;                 // Protects the counters below
+    size_t              m_next_track;           // Next track to hand out
+    UINT                m_finished;             // Tracks done (analyzed or failed)
+    UINT                m_analyzed;
+    CEvent              m_done;                 // Set when every track is finished
+
+public:
+    BatchAnalyzer( AnalysisPack& pack, SimdLevel simd=getSimdLevel() );
+
+    bool loadManifest( LPCSTR manifest_file );
+
+    // Blocks until every track is analyzed.  Returns the number analyzed.
+    UINT analyze( UINT max_threads=0 );
+
+    inline const BatchTrackArray& getTracks( void ) const {
+        return m_tracks;
+    }
+
+    bool analyzeNext( void );
+
+private:
+    bool analyzeTrack( const BatchTrack& track );
+
+    static FILE* openTrackFile( const BatchTrack& track, WAVEFORMATEXTENSIBLE& format, ULONGLONG& data_bytes );
+    static bool readWaveHeader( FILE* hFile, WAVEFORMATEXTENSIBLE& format, ULONGLONG& data_bytes );
+};
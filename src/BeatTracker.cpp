@@ -0,0 +1,275 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#include "stdafx.h"
+#include "BeatTracker.h"
+
+#include <math.h>
+
+static const float ONSET_MULTIPLIER = 1.5f;         // Flux must exceed the local mean by this much
+static const float ONSET_MIN_FLUX = 1.0f;           // and this (keeps noise in near silence out)
+static const float BEAT_TOLERANCE = 0.25f;          // Beat search window either side of the prediction (periods)
+static const double BEAT_PRIOR_OCTAVES = 0.7;       // Width of the tempo prior (octaves)
+
+// ----------------------------------------------------------------------------
+//
+BeatTracker::BeatTracker( UINT bins, UINT fft_size, UINT hop_ms, DWORD start_ms ) :
+    m_bins( bins ),
+    m_hop_ms( hop_ms ),
+    m_start_ms( start_ms ),
+    m_period( 0.0f ),
+    m_tempo_confidence( 0.0f ),
+    m_next_beat( -1.0 ),
+    m_onset( false ),
+    m_beats_taken( 0 )
+{
+    // A full scale sine peaks at about 32768 * fft_size / 4 in its bin
+    m_magnitude_scale = 100.0f * 4.0f / (32768.0f * fft_size);
+
+    m_previous.resize( bins, 0.0f );
+    m_flux.reserve( 60 * 1000 * 10 / hop_ms );       // Ten minutes
+
+    m_min_lag = 60000 / (BEAT_MAX_BPM * hop_ms);
+    m_max_lag = (60000 + BEAT_MIN_BPM * hop_ms - 1) / (BEAT_MIN_BPM * hop_ms);
+}
+
+// ----------------------------------------------------------------------------
+//
+void BeatTracker::addSpectrum( const float* power )
+{
+    float flux = 0.0f;
+
+    for ( UINT bin=1; bin < m_bins; bin++ ) {
+        float magnitude = log1pf( sqrtf( power[bin] ) * m_magnitude_scale );
+        float rise = magnitude - m_previous[bin];
+
+        if ( rise > 0.0f )
+            flux += rise;
+
+        m_previous[bin] = magnitude;
+    }
+
+    addFlux( m_flux.empty() ? 0.0f : flux );            // First hop rises from nothing
+}
+
+// ----------------------------------------------------------------------------
+// A hop with no new spectrum holds the last onset strength
+//
+void BeatTracker::repeatSpectrum( void )
+{
+    addFlux( m_flux.empty() ? 0.0f : m_flux.back() );
+}
+
+// ----------------------------------------------------------------------------
+//
+void BeatTracker::addFlux( float flux )
+{
+    m_flux.push_back( flux );
+
+    detectOnset();
+
+    UINT update_hops = BEAT_TEMPO_UPDATE_MS / m_hop_ms;
+
+    if ( m_flux.size() >= 2 * m_max_lag && (m_flux.size() % update_hops) == 0 )
+        estimateTempo();
+
+    trackBeats();
+}
+
+// ----------------------------------------------------------------------------
+// Mean flux over the preceding ONSET_THRESHOLD_MS
+//
+float BeatTracker::onsetThreshold( size_t hop ) const
+{
+    size_t window = ONSET_THRESHOLD_MS / m_hop_ms;
+    size_t start = ( hop > window ) ? hop - window : 0;
+
+    if ( start == hop )
+        return ONSET_MIN_FLUX;
+
+    float sum = 0.0f;
+    for ( size_t i=start; i < hop; i++ )
+        sum += m_flux[i];
+
+    return ONSET_MULTIPLIER * sum / (hop - start) + ONSET_MIN_FLUX;
+}
+
+// ----------------------------------------------------------------------------
+// A hop is an onset if it is a local flux peak above the threshold.  That takes the next
+// hop to decide, so m_onset refers to the hop before the last.
+//
+void BeatTracker::detectOnset( void )
+{
+    size_t count = m_flux.size();
+
+    m_onset = false;
+
+    if ( count < 3 )
+        return;
+
+    size_t hop = count - 2;
+
+    m_onset = m_flux[hop] > m_flux[hop-1] && m_flux[hop] >= m_flux[hop+1] && m_flux[hop] > onsetThreshold( hop );
+}
+
+// ----------------------------------------------------------------------------
+//
+void BeatTracker::estimateTempo( void )
+{
+    size_t count = m_flux.size();
+    size_t window = min( count, (size_t)(BEAT_TEMPO_WINDOW_MS / m_hop_ms) );
+    const float* flux = &m_flux[count - window];
+
+    float mean = 0.0f;
+    for ( size_t i=0; i < window; i++ )
+        mean += flux[i];
+    mean /= window;
+
+    // Smoothing spreads each onset over neighbouring hops so periods that are not a whole 
+    // number of hops still line up with themselves
+    static const float SMOOTHING[] = { 1.0f/9, 2.0f/9, 3.0f/9, 2.0f/9, 1.0f/9 };
+
+    std::vector<float> centred( window );
+    for ( size_t i=0; i < window; i++ ) {
+        float sum = 0.0f;
+
+        for ( int tap=-2; tap <= 2; tap++ ) {
+            size_t hop = (size_t)min( max( (int)i + tap, 0 ), (int)window - 1 );
+            sum += SMOOTHING[tap+2] * flux[hop];
+        }
+
+        centred[i] = sum - mean;
+    }
+
+    auto autocorrelation = [&]( UINT lag ) -> float {
+        float sum = 0.0f;
+        for ( size_t i=0; i+lag < window; i++ )
+            sum += centred[i] * centred[i+lag];
+        return sum / (window - lag);
+    };
+
+    float energy = autocorrelation( 0 );
+    if ( energy <= 0.0f )
+        return;
+
+    UINT best_lag = 0;
+    float best_score = 0.0f;
+    std::vector<float> acf( m_max_lag + 2, 0.0f );
+
+    for ( UINT lag=m_min_lag-1; lag <= m_max_lag+1; lag++ )
+        acf[lag] = autocorrelation( lag );
+
+    for ( UINT lag=m_min_lag; lag <= m_max_lag; lag++ ) {
+        double octaves = log( (60000.0 / BEAT_PRIOR_BPM) / (lag * m_hop_ms) ) / log( 2.0 ) / BEAT_PRIOR_OCTAVES;
+        float score = acf[lag] * (float)exp( -0.5 * octaves * octaves );
+
+        if ( score > best_score ) {
+            best_score = score;
+            best_lag = lag;
+        }
+    }
+
+    if ( best_lag == 0 )
+        return;
+
+    // Refine to a fractional period from the neighbouring lags
+    float a = acf[best_lag-1], b = acf[best_lag], c = acf[best_lag+1];
+    float denominator = a - 2.0f * b + c;
+    float period = best_lag + ( denominator < 0.0f ? 0.5f * (a - c) / denominator : 0.0f );
+
+    // Small changes are drift and are smoothed; anything larger is a new tempo
+    if ( m_period > 0.0f && fabs( period - m_period ) / m_period < 0.08f )
+        m_period = 0.75f * m_period + 0.25f * period;
+    else
+        m_period = period;
+
+    m_tempo_confidence = min( 1.0f, max( 0.0f, b / energy ) );
+}
+
+// ----------------------------------------------------------------------------
+// Each beat is placed once the search window around its prediction has been heard
+//
+void BeatTracker::trackBeats( void )
+{
+    if ( m_period <= 0.0f )
+        return;
+
+    size_t count = m_flux.size();
+
+    if ( m_next_beat < 0.0 ) {
+        // Phase from the strongest flux in the last period
+        size_t start = count - min( count, (size_t)m_period );
+        size_t strongest = start;
+
+        for ( size_t hop=start; hop < count; hop++ )
+            if ( m_flux[hop] > m_flux[strongest] )
+                strongest = hop;
+
+        m_next_beat = (double)strongest;
+    }
+
+    double tolerance = BEAT_TOLERANCE * m_period;
+
+    while ( m_next_beat + tolerance + 1.0 < count ) {
+        size_t first = (size_t)max( 0.0, ceil( m_next_beat - tolerance ) );
+        size_t last = (size_t)floor( m_next_beat + tolerance );
+        size_t best = first;
+        float best_score = -1.0f;
+
+        for ( size_t hop=first; hop <= last; hop++ ) {
+            double distance = (hop - m_next_beat) / (tolerance / 2.0);
+            float score = m_flux[hop] * (float)exp( -0.5 * distance * distance );
+
+            if ( score > best_score ) {
+                best_score = score;
+                best = hop;
+            }
+        }
+
+        BeatInfo beat;
+        float threshold = onsetThreshold( best );
+
+        if ( m_flux[best] > threshold ) {
+            beat.time_ms = hopToMs( (double)best );
+            beat.confidence = m_tempo_confidence * min( 1.0f, m_flux[best] / (2.0f * threshold) );
+            m_next_beat = best + m_period;
+        }
+        else {
+            beat.time_ms = hopToMs( m_next_beat );
+            beat.confidence = 0.0f;
+            m_next_beat += m_period;
+        }
+
+        m_beats.push_back( beat );
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+void BeatTracker::takeNewBeats( BeatArray& beats )
+{
+    if ( m_beats_taken < m_beats.size() ) {
+        beats.insert( beats.end(), m_beats.begin() + m_beats_taken, m_beats.end() );
+        m_beats_taken = m_beats.size();
+    }
+}
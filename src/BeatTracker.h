@@ -0,0 +1,101 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#pragma once
+
+#include "stdafx.h"
+#include "MusicPlayerApi.h"
+
+#define BEAT_MIN_BPM            60
+#define BEAT_MAX_BPM            180
+#define BEAT_PRIOR_BPM          120                 // Tempo prior centre (resolves octave errors)
+#define BEAT_TEMPO_WINDOW_MS    6000                // Onset history used to estimate tempo
+#define BEAT_TEMPO_UPDATE_MS    1000                // How often tempo is re-estimated
+#define ONSET_THRESHOLD_MS      500                 // Adaptive threshold averaging window
+
+typedef std::vector<BeatInfo> BeatArray;
+
+// Streaming onset detection and beat tracking from one power spectrum per hop.
+//
+// Onsets are peaks in the spectral flux (log magnitude increase summed over bins) that
+// rise above an adaptive threshold.  Tempo comes from the autocorrelation of the flux 
+// over the last few seconds, weighted towards BEAT_PRIOR_BPM.  Beats are placed one period 
+// after the last, snapped to the strongest nearby flux if it is an onset.
+//
+class BeatTracker
+{
+    UINT                    m_bins;
+    UINT                    m_hop_ms;
+    DWORD                   m_start_ms;             // Track position of the first hop
+    float                   m_magnitude_scale;      // Full scale sine bin to 100
+    std::vector<float>      m_previous;             // Log magnitudes of the last spectrum
+    std::vector<float>      m_flux;                 // Onset strength for every hop so far
+    UINT                    m_min_lag;              // Tempo search range in hops
+    UINT                    m_max_lag;
+    float                   m_period;               // Beat period in hops (0 until a tempo is found)
+    float                   m_tempo_confidence;
+    double                  m_next_beat;            // Predicted hop of the next beat (-1 before the first)
+    bool                    m_onset;                // The last hop that can be judged was an onset
+    BeatArray               m_beats;
+    size_t                  m_beats_taken;
+
+public:
+    BeatTracker( UINT bins, UINT fft_size, UINT hop_ms, DWORD start_ms=0 );
+
+    void addSpectrum( const float* power );
+    void repeatSpectrum( void );
+
+    // Tempo in BPM (0 until one has been found)
+    inline float getTempo() const {
+        return ( m_period > 0.0f ) ? 60000.0f / (m_period * m_hop_ms) : 0.0f;
+    }
+
+    inline bool isOnset() const {
+        return m_onset;
+    }
+
+    // Flux of the hop isOnset() refers to
+    inline float getOnsetStrength() const {
+        return ( m_flux.size() >= 2 ) ? m_flux[m_flux.size()-2] : 0.0f;
+    }
+
+    inline const BeatArray& getBeats() const {
+        return m_beats;
+    }
+
+    // Appends beats placed since the last call
+    void takeNewBeats( BeatArray& beats );
+
+private:
+    void addFlux( float flux );
+    float onsetThreshold( size_t hop ) const;
+    void detectOnset( void );
+    void estimateTempo( void );
+    void trackBeats( void );
+
+    // Flux peaks once an attack is about one hop inside the end of the transform window
+    // (the window tapers the newest samples), so a hop's onset time is its start
+    inline DWORD hopToMs( double hop ) const {
+        return m_start_ms + (DWORD)(hop * m_hop_ms + 0.5);
+    }
+};
@@ -0,0 +1,96 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#include "stdafx.h"
+#include "CacheFileIndex.h"
+
+// ----------------------------------------------------------------------------
+// FNV-1a of the name after the last path separator
+//
+ULONGLONG CacheFileIndex::makeKey( LPCSTR filename )
+{
+    LPCSTR name = strrchr( filename, '\\' );
+    name = ( name != NULL ) ? name+1 : filename;
+
+    ULONGLONG key = 14695981039346656037ULL;
+
+    while ( *name ) {
+        key ^= (BYTE)*name++;
+        key *= 1099511628211ULL;
+    }
+
+    return key;
+}
+
+// ----------------------------------------------------------------------------
+//
+UINT CacheFileIndex::scan( LPCSTR pattern )
+{
+    std::unordered_set<ULONGLONG> names;
+
+    WIN32_FIND_DATA find_data;
+    HANDLE hFind = FindFirstFile( pattern, &find_data );
+
+    if ( hFind != INVALID_HANDLE_VALUE ) {
+        do {
+            if ( !(find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) )
+                names.insert( makeKey( find_data.cFileName ) );
+        }
+        while ( FindNextFile( hFind, &find_data ) );
+
+        FindClose( hFind );
+    }
+
+    CSingleLock lock( &m_lock, TRUE );
+
+    m_names.swap( names );
+
+    return (UINT)m_names.size();
+}
+
+// ----------------------------------------------------------------------------
+//
+bool CacheFileIndex::contains( LPCSTR filename )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    return m_names.find( makeKey( filename ) ) != m_names.end();
+}
+
+// ----------------------------------------------------------------------------
+//
+void CacheFileIndex::add( LPCSTR filename )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    m_names.insert( makeKey( filename ) );
+}
+
+// ----------------------------------------------------------------------------
+//
+void CacheFileIndex::remove( LPCSTR filename )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    m_names.erase( makeKey( filename ) );
+}
@@ -0,0 +1,53 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#pragma once
+
+#include "stdafx.h"
+
+// Which files a cache directory holds, read once so checking for a file does not touch
+// the disk.  Only a 64 bit hash of each name is kept; a false positive needs a hash 
+// collision and costs no more than a failed open.
+//
+class CacheFileIndex
+{
+    CCriticalSection                m_lock;
+    std::unordered_set<ULONGLONG>   m_names;
+
+    static ULONGLONG makeKey( LPCSTR filename );
+
+public:
+    // Replaces the index with the files matching pattern (e.g. "dir\\*.info").  Returns
+    // the number found.
+    UINT scan( LPCSTR pattern );
+
+    // Files are named by path or name alone; only the name is compared
+    bool contains( LPCSTR filename );
+    void add( LPCSTR filename );
+    void remove( LPCSTR filename );
+
+    inline size_t size( void ) {
+        CSingleLock lock( &m_lock, TRUE );
+        return m_names.size();
+    }
+};
@@ -0,0 +1,112 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#include "stdafx.h"
+#include "FileAudioSink.h"
+
+#define WAV_HEADER_SIZE     (12 + 8 + sizeof(WAVEFORMATEX) + 8)
+
+// ----------------------------------------------------------------------------
+//
+FileAudioSink::FileAudioSink( LPCSTR filename, bool raw ) :
+    NullAudioSink( filename ),
+    m_filename( filename ),
+    m_raw( raw ),
+    m_file( NULL ),
+    m_data_bytes( 0 )
+{
+}
+
+// ----------------------------------------------------------------------------
+//
+FileAudioSink::~FileAudioSink(void)
+{
+    close();
+}
+
+// ----------------------------------------------------------------------------
+//
+void FileAudioSink::initialize( const WAVEFORMATEX* format, bool auto_convert, bool event_driven, UINT period_ms )
+{
+    NullAudioSink::initialize( format, auto_convert, event_driven, period_ms );
+
+    errno_t err = fopen_s( &m_file, m_filename, "wb" );
+    STUDIO_ASSERT( err == 0 && m_file != NULL, "Audio output stream cannot create file %s (%d)", (LPCSTR)m_filename, err );
+
+    m_data_bytes = 0;
+
+    if ( !m_raw )
+        writeHeader();                          // Placeholder sizes until close
+}
+
+// ----------------------------------------------------------------------------
+//
+void FileAudioSink::close( void )
+{
+    if ( m_file == NULL )
+        return;
+
+    if ( !m_raw ) {
+        fseek( m_file, 0, SEEK_SET );
+        writeHeader();
+    }
+
+    fclose( m_file );
+    m_file = NULL;
+
+    log_status( "Audio output stream %s wrote %I64u bytes", (LPCSTR)m_filename, m_data_bytes );
+}
+
+// ----------------------------------------------------------------------------
+//
+void FileAudioSink::releaseBuffer( UINT32 frames )
+{
+    size_t bytes = frames * m_format.nBlockAlign;
+
+    if ( m_file != NULL && bytes > 0 ) {
+        STUDIO_ASSERT( fwrite( &m_buffer[0], 1, bytes, m_file ) == bytes, 
+                       "Audio output stream %s write failed", (LPCSTR)m_filename );
+        m_data_bytes += bytes;
+    }
+
+    NullAudioSink::releaseBuffer( frames );
+}
+
+// ----------------------------------------------------------------------------
+// RIFF/WAVE header with a plain WAVEFORMATEX fmt chunk.  Sizes are clamped to 32 bits.
+//
+void FileAudioSink::writeHeader( void )
+{
+    DWORD data_size = (DWORD)min( m_data_bytes, (ULONGLONG)(0xFFFFFFFF - WAV_HEADER_SIZE) );
+    DWORD riff_size = (DWORD)(WAV_HEADER_SIZE - 8 + data_size);
+    DWORD fmt_size = sizeof(WAVEFORMATEX);
+
+    fwrite( "RIFF", 1, 4, m_file );
+    fwrite( &riff_size, sizeof(DWORD), 1, m_file );
+    fwrite( "WAVE", 1, 4, m_file );
+    fwrite( "fmt ", 1, 4, m_file );
+    fwrite( &fmt_size, sizeof(DWORD), 1, m_file );
+    fwrite( &m_format, sizeof(WAVEFORMATEX), 1, m_file );
+    fwrite( "data", 1, 4, m_file );
+    fwrite( &data_size, sizeof(DWORD), 1, m_file );
+}
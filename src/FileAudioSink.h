@@ -0,0 +1,48 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#pragma once
+
+#include "stdafx.h"
+#include "NullAudioSink.h"
+
+// Free running sink that records rendered frames to a WAV file (or headerless raw PCM)
+
+class FileAudioSink : public NullAudioSink
+{
+    CString                 m_filename;
+    bool                    m_raw;              // No RIFF header
+    FILE*                   m_file;
+    ULONGLONG               m_data_bytes;
+
+public:
+    FileAudioSink( LPCSTR filename, bool raw=false );
+    virtual ~FileAudioSink(void);
+
+    void close( void );
+    void initialize( const WAVEFORMATEX* format, bool auto_convert, bool event_driven, UINT period_ms );
+    void releaseBuffer( UINT32 frames );
+
+private:
+    void writeHeader( void );
+};
@@ -0,0 +1,141 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+#include "stdafx.h"
+#include "LoudnessMeter.h"
+
+// ----------------------------------------------------------------------------
+//
+LoudnessMeter::LoudnessMeter( UINT sample_rate, SimdLevel simd ) :
+    m_simd( simd ),
+    m_step_frames( (sample_rate * LOUDNESS_STEP_MS) / 1000 ),
+    m_step_fill( 0 ),
+    m_step_squares( 0.0 ),
+    m_step_count( 0 )
+{
+    m_filter.design( sample_rate );
+
+    memset( m_steps, 0, sizeof(m_steps) );
+}
+
+// ----------------------------------------------------------------------------
+//
+void LoudnessMeter::addFrames( const int16_t* stereo, UINT frames )
+{
+    while ( frames > 0 ) {
+        UINT count = min( frames, m_step_frames - m_step_fill );
+
+        m_step_squares += kWeightedSquares( stereo, count, m_filter, m_simd );
+
+        stereo = &stereo[ count * 2 ];
+        frames -= count;
+        m_step_fill += count;
+
+        if ( m_step_fill == m_step_frames )
+            finishStep();
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Channel mean squares are summed (BS.1770 weights left and right at 1.0) and scaled
+// to full scale = 1.0
+//
+void LoudnessMeter::finishStep( void )
+{
+    static const double FULL_SCALE = 32768.0 * 32768.0;
+
+    m_steps[ m_step_count % LOUDNESS_SHORT_TERM_STEPS ] = m_step_squares / m_step_frames / FULL_SCALE;
+    m_step_count++;
+
+    if ( m_step_count >= LOUDNESS_BLOCK_STEPS )
+        m_block_power.push_back( (float)(sumSteps( LOUDNESS_BLOCK_STEPS ) / LOUDNESS_BLOCK_STEPS) );
+
+    m_step_fill = 0;
+    m_step_squares = 0.0;
+}
+
+// ----------------------------------------------------------------------------
+//
+double LoudnessMeter::sumSteps( UINT steps ) const
+{
+    double sum = 0.0;
+
+    for ( UINT i=1; i <= steps; i++ )
+        sum += m_steps[ (m_step_count - i) % LOUDNESS_SHORT_TERM_STEPS ];
+
+    return sum;
+}
+
+// ----------------------------------------------------------------------------
+//
+float LoudnessMeter::powerToLufs( double power )
+{
+    if ( power <= 0.0 )
+        return LOUDNESS_SILENCE_LUFS;
+
+    return (float)max( (double)LOUDNESS_SILENCE_LUFS, -0.691 + 10.0 * log10( power ) );
+}
+
+// ----------------------------------------------------------------------------
+//
+float LoudnessMeter::getShortTerm( void ) const
+{
+    UINT steps = min( m_step_count, (UINT)LOUDNESS_SHORT_TERM_STEPS );
+
+    if ( steps == 0 )
+        return LOUDNESS_SILENCE_LUFS;
+
+    return powerToLufs( sumSteps( steps ) / steps );
+}
+
+// ----------------------------------------------------------------------------
+// Blocks under the absolute gate (LOUDNESS_SILENCE_LUFS) are dropped, then blocks more
+// than LOUDNESS_RELATIVE_GATE_LU under the level of what is left
+//
+float LoudnessMeter::getIntegrated( void ) const
+{
+    double absolute_sum = 0.0;
+    UINT absolute_count = 0;
+
+    for ( float power : m_block_power ) {
+        if ( powerToLufs( power ) > LOUDNESS_SILENCE_LUFS ) {
+            absolute_sum += power;
+            absolute_count++;
+        }
+    }
+
+    if ( absolute_count == 0 )
+        return LOUDNESS_SILENCE_LUFS;
+
+    double relative_gate = (absolute_sum / absolute_count) * pow( 10.0, -LOUDNESS_RELATIVE_GATE_LU / 10.0 );
+    double gated_sum = 0.0;
+    UINT gated_count = 0;
+
+    for ( float power : m_block_power ) {
+        if ( powerToLufs( power ) > LOUDNESS_SILENCE_LUFS && power > relative_gate ) {
+            gated_sum += power;
+            gated_count++;
+        }
+    }
+
+    return ( gated_count > 0 ) ? powerToLufs( gated_sum / gated_count ) : LOUDNESS_SILENCE_LUFS;
+}
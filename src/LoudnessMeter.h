@@ -0,0 +1,72 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+#pragma once
+
+#include "stdafx.h"
+#include "MusicPlayerApi.h"
+#include "AnalyzerKernels.h"
+
+#define LOUDNESS_STEP_MS            100         // Gating block step (75% overlap)
+#define LOUDNESS_BLOCK_STEPS        4           // 400ms gating blocks
+#define LOUDNESS_SHORT_TERM_STEPS   30          // 3 second short-term window
+#define LOUDNESS_RELATIVE_GATE_LU   10.0        // Blocks this far under the ungated level are left out
+
+// K-weighted loudness (ITU-R BS.1770 / EBU R128) of interleaved stereo frames.  Mean 
+// squares are kept per LOUDNESS_STEP_MS so the short-term window and the overlapping 
+// gating blocks come from the same running sums.
+//
+// The filter makes its own scan of each analyzer block rather than riding in the copy or
+// peak pass.  Its cost is the serial biquad recurrence (about 210us per second of 44.1kHz
+// stereo with SSE2, against 23us for the whole peak pass) and the block is still in L1 
+// from the copy, so fusing the loops would only save the reload.
+//
+class LoudnessMeter
+{
+    SimdLevel               m_simd;
+    KWeightFilter           m_filter;
+    UINT                    m_step_frames;
+    UINT                    m_step_fill;            // Frames in the current step
+    double                  m_step_squares;
+
+    double                  m_steps[LOUDNESS_SHORT_TERM_STEPS];    // Mean square of the last steps (ring)
+    UINT                    m_step_count;           // Steps completed
+
+    std::vector<float>      m_block_power;          // Mean square of every gating block
+
+public:
+    LoudnessMeter( UINT sample_rate, SimdLevel simd=getSimdLevel() );
+
+    void addFrames( const int16_t* stereo, UINT frames );
+
+    // K-weighted loudness over the last 3 seconds (less at the start)
+    float getShortTerm( void ) const;
+
+    // Gated loudness of everything added
+    float getIntegrated( void ) const;
+
+    static float powerToLufs( double power );
+
+private:
+    void finishStep( void );
+    double sumSteps( UINT steps ) const;
+};
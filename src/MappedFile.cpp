@@ -0,0 +1,149 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+#include "stdafx.h"
+#include "MappedFile.h"
+
+// ----------------------------------------------------------------------------
+//
+MappedFile::MappedFile() :
+    m_file( INVALID_HANDLE_VALUE ),
+    m_mapping( NULL ),
+    m_data( NULL ),
+    m_view_offset( 0 ),
+    m_view_size( 0 ),
+    m_size( 0 ),
+    m_window( 0 ),
+    m_writable( false )
+{
+}
+
+// ----------------------------------------------------------------------------
+//
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+// ----------------------------------------------------------------------------
+// Empty files cannot be mapped and are treated as missing
+//
+bool MappedFile::open( LPCSTR filename, bool writable, size_t window )
+{
+    close();
+
+    m_file = CreateFile( filename, writable ? GENERIC_READ|GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE, 
+                         NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+    if ( m_file == INVALID_HANDLE_VALUE )
+        return false;
+
+    LARGE_INTEGER size;
+
+    if ( !GetFileSizeEx( m_file, &size ) || size.QuadPart == 0 || (window == 0 && (ULONGLONG)size.QuadPart > (size_t)-1) ) {
+        close();
+        return false;
+    }
+
+    m_mapping = CreateFileMapping( m_file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, NULL );
+    if ( m_mapping == NULL ) {
+        close();
+        return false;
+    }
+
+    m_size = (ULONGLONG)size.QuadPart;
+    m_window = window;
+    m_writable = writable;
+
+    if ( window == 0 && !mapView( 0, (size_t)m_size ) ) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Views start on the allocation granularity
+//
+bool MappedFile::mapView( ULONGLONG offset, size_t size )
+{
+    static DWORD granularity = 0;
+
+    if ( granularity == 0 ) {
+        SYSTEM_INFO system_info;
+        GetSystemInfo( &system_info );
+        granularity = system_info.dwAllocationGranularity;
+    }
+
+    if ( m_data != NULL )
+        UnmapViewOfFile( m_data );
+
+    ULONGLONG start = offset - (offset % granularity);
+    ULONGLONG end = min( m_size, max( offset + size, start + m_window ) );
+
+    m_data = (BYTE*)MapViewOfFile( m_mapping, m_writable ? FILE_MAP_WRITE : FILE_MAP_READ, 
+                                   (DWORD)(start >> 32), (DWORD)start, (SIZE_T)(end - start) );
+    if ( m_data == NULL ) {
+        m_view_offset = m_view_size = 0;
+        return false;
+    }
+
+    m_view_offset = start;
+    m_view_size = (size_t)(end - start);
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+//
+const BYTE* MappedFile::getRange( ULONGLONG offset, size_t size )
+{
+    if ( m_mapping == NULL || offset > m_size || size > m_size - offset )
+        return NULL;
+
+    if ( m_data == NULL || offset < m_view_offset || offset + size > m_view_offset + m_view_size ) {
+        if ( !mapView( offset, size ) )
+            return NULL;
+    }
+
+    return &m_data[offset - m_view_offset];
+}
+
+// ----------------------------------------------------------------------------
+//
+void MappedFile::close( void )
+{
+    if ( m_data != NULL )
+        UnmapViewOfFile( m_data );
+    if ( m_mapping != NULL )
+        CloseHandle( m_mapping );
+    if ( m_file != INVALID_HANDLE_VALUE )
+        CloseHandle( m_file );
+
+    m_file = INVALID_HANDLE_VALUE;
+    m_mapping = NULL;
+    m_data = NULL;
+    m_view_offset = m_view_size = 0;
+    m_size = 0;
+    m_window = 0;
+    m_writable = false;
+}
@@ -0,0 +1,78 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+#pragma once
+
+#include "stdafx.h"
+
+// View of a file.  Other handles may still write to (append to) the file; the view keeps
+// the size the file had when it was opened.
+//
+// The whole file is mapped unless a window size is given.  A windowed file maps only the
+// part getRange() asks for (at least window bytes of it) so a file larger than the address
+// space can still be read.
+//
+class MappedFile
+{
+    HANDLE          m_file;
+    HANDLE          m_mapping;
+    BYTE*           m_data;                     // Current view
+    ULONGLONG       m_view_offset;
+    size_t          m_view_size;
+    ULONGLONG       m_size;
+    size_t          m_window;                   // 0 when the whole file is mapped
+    bool            m_writable;
+
+    bool mapView( ULONGLONG offset, size_t size );
+
+    MappedFile(MappedFile& other) {}
+    MappedFile& operator=(MappedFile& rhs) { return *this; }
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open( LPCSTR filename, bool writable=false, size_t window=0 );
+    void close( void );
+
+    inline bool isOpen( void ) const {
+        return m_mapping != NULL;
+    }
+
+    // The whole file (NULL when windowed)
+    inline const BYTE* getData( void ) const {
+        return m_window == 0 ? m_data : NULL;
+    }
+
+    // NULL unless opened writable (and not windowed)
+    inline BYTE* getWritableData( void ) const {
+        return m_writable && m_window == 0 ? m_data : NULL;
+    }
+
+    // size bytes at offset, valid until the next call or close.  NULL if the range is 
+    // past the end of the file or cannot be mapped.
+    const BYTE* getRange( ULONGLONG offset, size_t size );
+
+    inline ULONGLONG getSize( void ) const {
+        return m_size;
+    }
+};
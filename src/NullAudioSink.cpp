@@ -0,0 +1,84 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#include "stdafx.h"
+#include "NullAudioSink.h"
+
+// ----------------------------------------------------------------------------
+//
+NullAudioSink::NullAudioSink( LPCSTR name ) :
+    m_name( name ),
+    m_event_driven( false ),
+    m_started( false ),
+    m_buffer_frames( 0 ),
+    m_frames_rendered( 0 )
+{
+    memset( &m_format, 0, sizeof(WAVEFORMATEX) );
+}
+
+// ----------------------------------------------------------------------------
+//
+NullAudioSink::~NullAudioSink(void)
+{
+}
+
+// ----------------------------------------------------------------------------
+// Buffer sizes follow the render mode so fills are the same size as with a device
+//
+void NullAudioSink::initialize( const WAVEFORMATEX* format, bool auto_convert, bool event_driven, UINT period_ms )
+{
+    m_format = *format;
+    m_format.cbSize = 0;
+    m_event_driven = event_driven;
+
+    if ( event_driven )
+        m_buffer_frames = max( 1UL, m_format.nSamplesPerSec * period_ms / 1000 );
+    else
+        m_buffer_frames = m_format.nSamplesPerSec * AUDIO_TIMER_BUFFER_MS / 1000;
+
+    m_buffer.resize( m_buffer_frames * m_format.nBlockAlign );
+}
+
+// ----------------------------------------------------------------------------
+//
+BYTE* NullAudioSink::getBuffer( UINT32 frames )
+{
+    STUDIO_ASSERT( frames <= m_buffer_frames, "Audio output stream %s buffer overrun", (LPCSTR)m_name );
+
+    return &m_buffer[0];
+}
+
+// ----------------------------------------------------------------------------
+//
+void NullAudioSink::releaseBuffer( UINT32 frames )
+{
+    m_frames_rendered += frames;
+}
+
+// ----------------------------------------------------------------------------
+// Never blocks while started; the render loop runs as fast as the ring is filled
+//
+bool NullAudioSink::waitForBuffer( HANDLE wake, DWORD timeout_ms )
+{
+    return ::WaitForSingleObject( wake, m_started ? 0 : timeout_ms ) == WAIT_TIMEOUT && m_started;
+}
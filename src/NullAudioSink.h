@@ -0,0 +1,89 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#pragma once
+
+#include "stdafx.h"
+#include "AudioSink.h"
+
+// A free running sink that accepts any format and discards frames as fast as they are 
+// rendered.  Used to drive the delivery -> ring -> analyzer pipeline headless.
+
+class NullAudioSink : public AudioSink
+{
+protected:
+    CString                 m_name;
+    WAVEFORMATEX            m_format;           // Format being rendered
+    bool                    m_event_driven;
+    bool                    m_started;
+    UINT32                  m_buffer_frames;
+    std::vector<BYTE>       m_buffer;
+    std::atomic<ULONGLONG>  m_frames_rendered;
+
+public:
+    NullAudioSink( LPCSTR name="Null" );
+    virtual ~NullAudioSink(void);
+
+    LPCSTR getName( void ) const {
+        return m_name;
+    }
+
+    const WAVEFORMATEX* getMixFormat( void ) const {
+        return NULL;                            // Any format
+    }
+
+    bool isEventDriven( void ) const {
+        return m_event_driven;
+    }
+
+    UINT32 getBufferFrames( void ) const {
+        return m_buffer_frames;
+    }
+
+    ULONGLONG getFramesRendered( void ) const {
+        return m_frames_rendered;
+    }
+
+    virtual void open( void ) {}
+    virtual void close( void ) {}
+    virtual void initialize( const WAVEFORMATEX* format, bool auto_convert, bool event_driven, UINT period_ms );
+
+    UINT32 getPadding( void ) {
+        return 0;                               // Everything is consumed immediately
+    }
+
+    BYTE* getBuffer( UINT32 frames );
+    virtual void releaseBuffer( UINT32 frames );
+
+    void start( void ) {
+        m_started = true;
+    }
+
+    void stop( void ) {
+        m_started = false;
+    }
+
+    void reset( void ) {}
+
+    bool waitForBuffer( HANDLE wake, DWORD timeout_ms );
+};
@@ -0,0 +1,340 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#include "stdafx.h"
+#include "PolyphaseResampler.h"
+
+#include <immintrin.h>
+
+#define PI      3.14159265358979323846
+
+// Filter design per quality tier.  Stop band attenuation follows beta (~50/70/90dB) and the
+// transition band narrows as the taps increase, so the cutoff can move closer to Nyquist.
+static const struct {
+    LPCSTR      m_name;
+    UINT        m_taps;                         // Taps per phase (multiple of 8 for the SIMD kernels)
+    double      m_beta;                         // Kaiser window shape
+    double      m_cutoff;                       // Cutoff as a fraction of the lower Nyquist frequency
+} quality_tiers[] = {
+    { "linear",  2,  0.0, 1.00 },               // Not polyphase - see AudioFormatConverter
+    { "low",    16,  5.0, 0.80 },
+    { "medium", 32,  7.0, 0.90 },
+    { "high",   64,  9.0, 0.94 }
+};
+
+// ----------------------------------------------------------------------------
+// FILTER KERNELS - one output frame from a window of taps input frames
+// ----------------------------------------------------------------------------
+
+static void kernelScalar( const float* input, const float* coefficients, UINT taps, UINT channels, float* output )
+{
+    for ( UINT channel=0; channel < channels; channel++ ) {
+        const float* sample = &input[channel];
+        float sum = 0.0f;
+
+        for ( UINT tap=0; tap < taps; tap++ )
+            sum += sample[tap * channels] * coefficients[tap];
+
+        output[channel] = sum;
+    }
+}
+
+static void kernelMonoSSE2( const float* input, const float* coefficients, UINT taps, UINT channels, float* output )
+{
+    __m128 sum = _mm_setzero_ps();
+
+    for ( UINT tap=0; tap < taps; tap += 4 )
+        sum = _mm_add_ps( sum, _mm_mul_ps( _mm_loadu_ps( &input[tap] ), _mm_loadu_ps( &coefficients[tap] ) ) );
+
+    sum = _mm_add_ps( sum, _mm_movehl_ps( sum, sum ) );
+    sum = _mm_add_ss( sum, _mm_shuffle_ps( sum, sum, 1 ) );
+
+    _mm_store_ss( output, sum );
+}
+
+// Stereo kernels use a table with each coefficient doubled (c0 c0 c1 c1 ...) to line up 
+// with interleaved L R L R input
+
+static void kernelStereoSSE2( const float* input, const float* coefficients, UINT taps, UINT channels, float* output )
+{
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    UINT samples = taps * 2;
+
+    for ( UINT i=0; i < samples; i += 8 ) {
+        sum0 = _mm_add_ps( sum0, _mm_mul_ps( _mm_loadu_ps( &input[i] ), _mm_loadu_ps( &coefficients[i] ) ) );
+        sum1 = _mm_add_ps( sum1, _mm_mul_ps( _mm_loadu_ps( &input[i+4] ), _mm_loadu_ps( &coefficients[i+4] ) ) );
+    }
+
+    sum0 = _mm_add_ps( sum0, sum1 );                                // L R L R
+    sum0 = _mm_add_ps( sum0, _mm_movehl_ps( sum0, sum0 ) );         // L R
+
+    _mm_storel_pi( (__m64*)output, sum0 );
+}
+
+static void kernelStereoAVX2( const float* input, const float* coefficients, UINT taps, UINT channels, float* output )
+{
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    UINT samples = taps * 2;
+
+    for ( UINT i=0; i < samples; i += 16 ) {
+        sum0 = _mm256_add_ps( sum0, _mm256_mul_ps( _mm256_loadu_ps( &input[i] ), _mm256_loadu_ps( &coefficients[i] ) ) );
+        sum1 = _mm256_add_ps( sum1, _mm256_mul_ps( _mm256_loadu_ps( &input[i+8] ), _mm256_loadu_ps( &coefficients[i+8] ) ) );
+    }
+
+    sum0 = _mm256_add_ps( sum0, sum1 );
+    __m128 sum = _mm_add_ps( _mm256_castps256_ps128( sum0 ), _mm256_extractf128_ps( sum0, 1 ) );
+    sum = _mm_add_ps( sum, _mm_movehl_ps( sum, sum ) );
+
+    _mm_storel_pi( (__m64*)output, sum );
+
+    _mm256_zeroupper();
+}
+
+// ----------------------------------------------------------------------------
+//
+static UINT greatestCommonDivisor( UINT a, UINT b )
+{
+    while ( b != 0 ) {
+        UINT remainder = a % b;
+        a = b;
+        b = remainder;
+    }
+
+    return a;
+}
+
+// ----------------------------------------------------------------------------
+// Zeroth order modified Bessel function (Kaiser window)
+//
+static double besselI0( double x )
+{
+    double sum = 1.0;
+    double term = 1.0;
+
+    for ( int k=1; k < 64; k++ ) {
+        double factor = x / (2.0 * k);
+        term *= factor * factor;
+        sum += term;
+
+        if ( term < sum * 1e-12 )
+            break;
+    }
+
+    return sum;
+}
+
+// ----------------------------------------------------------------------------
+//
+PolyphaseResampler::PolyphaseResampler( UINT channels, UINT in_rate, UINT out_rate, ResamplerQuality quality, SimdLevel simd ) :
+    m_channels( channels ),
+    m_in_rate( in_rate ),
+    m_out_rate( out_rate ),
+    m_quality( quality ),
+    m_kernel( kernelScalar ),
+    m_buffered( 0 ),
+    m_index( 0 ),
+    m_phase( 0 ),
+    m_elapsed_ticks( 0 ),
+    m_frames_out( 0 )
+{
+    STUDIO_ASSERT( canResample( in_rate, out_rate ), "Unsupported resampler rates %u -> %u", in_rate, out_rate );
+    STUDIO_ASSERT( quality > RESAMPLE_LINEAR && quality <= RESAMPLE_HIGH, "Invalid resampler quality %d", quality );
+
+    UINT divisor = greatestCommonDivisor( in_rate, out_rate );
+    m_phases = out_rate / divisor;
+    m_step = in_rate / divisor;
+    m_taps = quality_tiers[quality].m_taps;
+
+    bool interleave_stereo = channels == 2 && simd != SIMD_SCALAR;
+
+    if ( interleave_stereo )
+        m_kernel = ( simd == SIMD_AVX2 ) ? kernelStereoAVX2 : kernelStereoSSE2;
+    else if ( channels == 1 && simd != SIMD_SCALAR )
+        m_kernel = kernelMonoSSE2;
+
+    // Downsampling must also band limit to the new Nyquist
+    double cutoff = quality_tiers[quality].m_cutoff * min( 1.0, (double)out_rate / in_rate );
+
+    buildTable( quality_tiers[quality].m_beta, cutoff, interleave_stereo );
+
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency( &frequency );
+    m_tick_frequency = frequency.QuadPart;
+
+    reset();
+}
+
+// ----------------------------------------------------------------------------
+//
+PolyphaseResampler::~PolyphaseResampler()
+{
+}
+
+// ----------------------------------------------------------------------------
+//
+bool PolyphaseResampler::canResample( UINT in_rate, UINT out_rate )
+{
+    if ( in_rate == 0 || out_rate == 0 )
+        return false;
+
+    return out_rate / greatestCommonDivisor( in_rate, out_rate ) <= MAX_POLYPHASE_PHASES;
+}
+
+// ----------------------------------------------------------------------------
+//
+LPCSTR PolyphaseResampler::getQualityName( ResamplerQuality quality )
+{
+    if ( quality < RESAMPLE_LINEAR || quality > RESAMPLE_HIGH )
+        return "unknown";
+
+    return quality_tiers[quality].m_name;
+}
+
+// ----------------------------------------------------------------------------
+// Row p holds the filter for an output position p/L of the way between two input frames.
+// Rows are normalized to unity DC gain.
+//
+void PolyphaseResampler::buildTable( double beta, double cutoff, bool interleave_stereo )
+{
+    UINT half = m_taps / 2;
+    UINT copies = interleave_stereo ? 2 : 1;
+    double i0_beta = besselI0( beta );
+    std::vector<double> row( m_taps );
+
+    m_table_stride = m_taps * copies;
+    m_table.resize( m_phases * m_table_stride );
+
+    for ( UINT phase=0; phase < m_phases; phase++ ) {
+        double fraction = (double)phase / m_phases;
+        double sum = 0.0;
+
+        for ( UINT tap=0; tap < m_taps; tap++ ) {
+            double distance = fraction + half - 1 - tap;            // Input frames from tap to output position
+            double ratio = distance / half;
+            double window = ( fabs(ratio) < 1.0 ) ? besselI0( beta * sqrt( 1.0 - ratio * ratio ) ) / i0_beta : 0.0;
+            double x = PI * cutoff * distance;
+            double sinc = ( fabs(x) < 1e-9 ) ? 1.0 : sin( x ) / x;
+
+            row[tap] = cutoff * sinc * window;
+            sum += row[tap];
+        }
+
+        float* coefficients = &m_table[phase * m_table_stride];
+
+        for ( UINT tap=0; tap < m_taps; tap++ )
+            for ( UINT copy=0; copy < copies; copy++ )
+                coefficients[tap * copies + copy] = (float)(row[tap] / sum);
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+void PolyphaseResampler::reset( void )
+{
+    UINT history = m_taps / 2 - 1;              // Centres the first output on the first input frame
+
+    if ( m_buffer.size() < history * m_channels )
+        m_buffer.resize( history * m_channels );
+
+    std::fill( m_buffer.begin(), m_buffer.begin() + history * m_channels, 0.0f );
+
+    m_buffered = history;
+    m_index = 0;
+    m_phase = 0;
+}
+
+// ----------------------------------------------------------------------------
+//
+UINT PolyphaseResampler::getInputFramesNeeded( UINT output_frames ) const
+{
+    if ( output_frames == 0 )
+        return 0;
+
+    ULONGLONG last_phase = m_phase + (ULONGLONG)(output_frames - 1) * m_step;
+    UINT window_end = m_index + (UINT)(last_phase / m_phases) + m_taps;
+
+    return window_end > m_buffered ? window_end - m_buffered : 0;
+}
+
+// ----------------------------------------------------------------------------
+//
+UINT PolyphaseResampler::process( const float* input, UINT input_frames, float* output, UINT output_frames, UINT* input_consumed )
+{
+    LARGE_INTEGER start, end;
+    QueryPerformanceCounter( &start );
+
+    UINT frames = min( input_frames, getInputFramesNeeded( output_frames ) );
+
+    if ( m_buffer.size() < (m_buffered + frames) * m_channels )
+        m_buffer.resize( (m_buffered + frames) * m_channels );
+
+    memcpy( &m_buffer[m_buffered * m_channels], input, frames * m_channels * sizeof(float) );
+    m_buffered += frames;
+
+    UINT produced = 0;
+
+    while ( produced < output_frames && m_index + m_taps <= m_buffered ) {
+        m_kernel( &m_buffer[m_index * m_channels], &m_table[m_phase * m_table_stride], m_taps, m_channels, output );
+
+        output = &output[m_channels];
+        produced++;
+
+        m_phase += m_step;
+        m_index += m_phase / m_phases;
+        m_phase %= m_phases;
+    }
+
+    // Slide the unused tail of the window to the front
+    if ( m_index >= m_buffered ) {
+        m_index -= m_buffered;
+        m_buffered = 0;
+    }
+    else if ( m_index > 0 ) {
+        m_buffered -= m_index;
+        memmove( &m_buffer[0], &m_buffer[m_index * m_channels], m_buffered * m_channels * sizeof(float) );
+        m_index = 0;
+    }
+
+    QueryPerformanceCounter( &end );
+
+    m_elapsed_ticks += end.QuadPart - start.QuadPart;
+    m_frames_out += produced;
+
+    *input_consumed = frames;
+    return produced;
+}
+
+// ----------------------------------------------------------------------------
+//
+double PolyphaseResampler::getCostPerSecond( void ) const
+{
+    if ( m_frames_out == 0 )
+        return 0.0;
+
+    double elapsed_us = (double)m_elapsed_ticks * 1000000.0 / m_tick_frequency;
+    double audio_seconds = (double)m_frames_out / m_out_rate;
+
+    return elapsed_us / audio_seconds;
+}
@@ -0,0 +1,91 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#pragma once
+
+#include "stdafx.h"
+#include "MusicPlayerApi.h"
+#include "SimdSupport.h"
+
+#define MAX_POLYPHASE_PHASES    1024            // Largest reduced output rate (e.g. 160 for 44.1k->48k)
+
+typedef void (*PolyphaseKernel)( const float* input, const float* coefficients, UINT taps, UINT channels, float* output );
+
+// Rational ratio polyphase resampler.  The rates are reduced to L/M (L phases, M input frames
+// per L output frames) and each phase has a precomputed Kaiser windowed sinc filter, so every
+// output frame is a single dot product of the input window with one table row.
+// Not thread safe - owned by the render thread.
+
+class PolyphaseResampler
+{
+    UINT                m_channels;
+    UINT                m_in_rate;
+    UINT                m_out_rate;
+    ResamplerQuality    m_quality;
+
+    UINT                m_phases;               // L - reduced output rate
+    UINT                m_step;                 // M - reduced input rate
+    UINT                m_taps;                 // Filter taps per phase
+    UINT                m_table_stride;         // Floats per table row
+    std::vector<float>  m_table;                // m_phases rows of coefficients
+    PolyphaseKernel     m_kernel;
+
+    std::vector<float>  m_buffer;               // Input window history followed by pending input
+    UINT                m_buffered;             // Frames in m_buffer
+    UINT                m_index;                // First window frame of the next output
+    UINT                m_phase;                // Phase of the next output
+
+    LONGLONG            m_elapsed_ticks;        // Performance counter ticks spent in process()
+    ULONGLONG           m_frames_out;
+    LONGLONG            m_tick_frequency;
+
+public:
+    PolyphaseResampler( UINT channels, UINT in_rate, UINT out_rate, ResamplerQuality quality, SimdLevel simd=::getSimdLevel() );
+    ~PolyphaseResampler();
+
+    static bool canResample( UINT in_rate, UINT out_rate );
+    static LPCSTR getQualityName( ResamplerQuality quality );
+
+    inline ResamplerQuality getQuality() const {
+        return m_quality;
+    }
+
+    inline UINT getTaps() const {
+        return m_taps;
+    }
+
+    // Input frames still required to produce output_frames
+    UINT getInputFramesNeeded( UINT output_frames ) const;
+
+    // Returns frames written to output; input_consumed receives input frames used up
+    UINT process( const float* input, UINT input_frames, float* output, UINT output_frames, UINT* input_consumed );
+
+    // Forget filter history (stream discontinuity)
+    void reset( void );
+
+    // Microseconds of CPU spent per second of audio produced
+    double getCostPerSecond( void ) const;
+
+private:
+    void buildTable( double beta, double cutoff, bool interleave_stereo );
+};
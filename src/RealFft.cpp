@@ -0,0 +1,235 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#include "stdafx.h"
+#include "RealFft.h"
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <immintrin.h>
+
+// ----------------------------------------------------------------------------
+// BUTTERFLY KERNELS
+//
+// One radix-2 stage of half size h over n points.  Twiddles for the stage are contiguous
+// so the vector versions process 4 or 8 butterflies of a group at once.
+// ----------------------------------------------------------------------------
+
+static void radix2StageScalar( float* re, float* im, UINT n, UINT h, const float* wr, const float* wi )
+{
+    for ( UINT k=0; k < n; k += 2*h ) {
+        float* ar = &re[k];
+        float* ai = &im[k];
+        float* br = &re[k+h];
+        float* bi = &im[k+h];
+
+        for ( UINT j=0; j < h; j++ ) {
+            float tr = wr[j] * br[j] - wi[j] * bi[j];
+            float ti = wr[j] * bi[j] + wi[j] * br[j];
+
+            br[j] = ar[j] - tr;
+            bi[j] = ai[j] - ti;
+            ar[j] += tr;
+            ai[j] += ti;
+        }
+    }
+}
+
+static void radix2StageSSE2( float* re, float* im, UINT n, UINT h, const float* wr, const float* wi )
+{
+    for ( UINT k=0; k < n; k += 2*h ) {
+        float* ar = &re[k];
+        float* ai = &im[k];
+        float* br = &re[k+h];
+        float* bi = &im[k+h];
+
+        for ( UINT j=0; j < h; j += 4 ) {
+            __m128 w_r = _mm_loadu_ps( &wr[j] );
+            __m128 w_i = _mm_loadu_ps( &wi[j] );
+            __m128 b_r = _mm_loadu_ps( &br[j] );
+            __m128 b_i = _mm_loadu_ps( &bi[j] );
+            __m128 a_r = _mm_loadu_ps( &ar[j] );
+            __m128 a_i = _mm_loadu_ps( &ai[j] );
+
+            __m128 tr = _mm_sub_ps( _mm_mul_ps( w_r, b_r ), _mm_mul_ps( w_i, b_i ) );
+            __m128 ti = _mm_add_ps( _mm_mul_ps( w_r, b_i ), _mm_mul_ps( w_i, b_r ) );
+
+            _mm_storeu_ps( &br[j], _mm_sub_ps( a_r, tr ) );
+            _mm_storeu_ps( &bi[j], _mm_sub_ps( a_i, ti ) );
+            _mm_storeu_ps( &ar[j], _mm_add_ps( a_r, tr ) );
+            _mm_storeu_ps( &ai[j], _mm_add_ps( a_i, ti ) );
+        }
+    }
+}
+
+static void radix2StageAVX2( float* re, float* im, UINT n, UINT h, const float* wr, const float* wi )
+{
+    for ( UINT k=0; k < n; k += 2*h ) {
+        float* ar = &re[k];
+        float* ai = &im[k];
+        float* br = &re[k+h];
+        float* bi = &im[k+h];
+
+        for ( UINT j=0; j < h; j += 8 ) {
+            __m256 w_r = _mm256_loadu_ps( &wr[j] );
+            __m256 w_i = _mm256_loadu_ps( &wi[j] );
+            __m256 b_r = _mm256_loadu_ps( &br[j] );
+            __m256 b_i = _mm256_loadu_ps( &bi[j] );
+            __m256 a_r = _mm256_loadu_ps( &ar[j] );
+            __m256 a_i = _mm256_loadu_ps( &ai[j] );
+
+            __m256 tr = _mm256_sub_ps( _mm256_mul_ps( w_r, b_r ), _mm256_mul_ps( w_i, b_i ) );
+            __m256 ti = _mm256_add_ps( _mm256_mul_ps( w_r, b_i ), _mm256_mul_ps( w_i, b_r ) );
+
+            _mm256_storeu_ps( &br[j], _mm256_sub_ps( a_r, tr ) );
+            _mm256_storeu_ps( &bi[j], _mm256_sub_ps( a_i, ti ) );
+            _mm256_storeu_ps( &ar[j], _mm256_add_ps( a_r, tr ) );
+            _mm256_storeu_ps( &ai[j], _mm256_add_ps( a_i, ti ) );
+        }
+    }
+
+    _mm256_zeroupper();
+}
+
+// ----------------------------------------------------------------------------
+// The first two radix-2 stages (twiddles 1 and -i) done as one radix-4 pass
+//
+static void radix4FirstPass( float* re, float* im, UINT n )
+{
+    for ( UINT k=0; k < n; k += 4 ) {
+        float y0r = re[k] + re[k+1],    y0i = im[k] + im[k+1];
+        float y1r = re[k] - re[k+1],    y1i = im[k] - im[k+1];
+        float y2r = re[k+2] + re[k+3],  y2i = im[k+2] + im[k+3];
+        float y3r = re[k+2] - re[k+3],  y3i = im[k+2] - im[k+3];
+
+        re[k] = y0r + y2r;      im[k] = y0i + y2i;
+        re[k+2] = y0r - y2r;    im[k+2] = y0i - y2i;
+        re[k+1] = y1r + y3i;    im[k+1] = y1i - y3r;        // y1 + (-i)y3
+        re[k+3] = y1r - y3i;    im[k+3] = y1i + y3r;
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+RealFft::RealFft( UINT size, SimdLevel simd ) :
+    m_size( size ),
+    m_half( size / 2 ),
+    m_simd( simd )
+{
+    STUDIO_ASSERT( size >= 8 && (size & (size-1)) == 0, "FFT size %u must be a power of 2 of at least 8", size );
+
+    UINT bits = 0;
+    while ( (1U << bits) < m_half )
+        bits++;
+
+    m_bit_reverse.resize( m_half );
+    for ( UINT i=0; i < m_half; i++ ) {
+        UINT reversed = 0;
+        for ( UINT bit=0; bit < bits; bit++ )
+            if ( i & (1U << bit) )
+                reversed |= 1U << (bits - 1 - bit);
+        m_bit_reverse[i] = reversed;
+    }
+
+    m_stage_re.resize( m_half );
+    m_stage_im.resize( m_half );
+
+    for ( UINT h=1; h < m_half; h *= 2 ) {
+        for ( UINT j=0; j < h; j++ ) {
+            double angle = -M_PI * j / h;
+            m_stage_re[h-1+j] = (float)cos( angle );
+            m_stage_im[h-1+j] = (float)sin( angle );
+        }
+    }
+
+    m_unpack_re.resize( m_half );
+    m_unpack_im.resize( m_half );
+
+    for ( UINT k=0; k < m_half; k++ ) {
+        double angle = -2.0 * M_PI * k / m_size;
+        m_unpack_re[k] = (float)cos( angle );
+        m_unpack_im[k] = (float)sin( angle );
+    }
+
+    m_re.resize( m_half );
+    m_im.resize( m_half );
+}
+
+// ----------------------------------------------------------------------------
+// In place complex FFT of m_re/m_im (already in bit reversed order)
+//
+void RealFft::transform( void )
+{
+    float* re = &m_re[0];
+    float* im = &m_im[0];
+
+    radix4FirstPass( re, im, m_half );
+
+    for ( UINT h=4; h < m_half; h *= 2 ) {
+        const float* wr = &m_stage_re[h-1];
+        const float* wi = &m_stage_im[h-1];
+
+        if ( m_simd == SIMD_AVX2 && h >= 8 )
+            radix2StageAVX2( re, im, m_half, h, wr, wi );
+        else if ( m_simd != SIMD_SCALAR )
+            radix2StageSSE2( re, im, m_half, h, wr, wi );
+        else
+            radix2StageScalar( re, im, m_half, h, wr, wi );
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Even samples go in the real part and odd samples in the imaginary part of an N/2 point
+// transform Z, then X[k] = E[k] + W^k O[k] where E and O are recovered from Z[k] and 
+// conj(Z[N/2-k]).
+//
+void RealFft::powerSpectrum( const float* input, const float* window, float* power )
+{
+    for ( UINT m=0; m < m_half; m++ ) {
+        UINT index = m_bit_reverse[m];
+        m_re[index] = input[2*m] * window[2*m];
+        m_im[index] = input[2*m+1] * window[2*m+1];
+    }
+
+    transform();
+
+    float dc = m_re[0] + m_im[0];
+    float nyquist = m_re[0] - m_im[0];
+
+    power[0] = dc * dc;
+    power[m_half] = nyquist * nyquist;
+
+    for ( UINT k=1; k < m_half; k++ ) {
+        float zr = m_re[k],             zi = m_im[k];
+        float cr = m_re[m_half-k],      ci = -m_im[m_half-k];       // conj( Z[N/2-k] )
+
+        float er = 0.5f * (zr + cr),    ei = 0.5f * (zi + ci);
+        float dr = 0.5f * (zr - cr),    di = 0.5f * (zi - ci);
+        float or_ = di,                 oi = -dr;                   // (Z - conj) / 2i
+
+        float xr = er + m_unpack_re[k] * or_ - m_unpack_im[k] * oi;
+        float xi = ei + m_unpack_re[k] * oi + m_unpack_im[k] * or_;
+
+        power[k] = xr * xr + xi * xi;
+    }
+}
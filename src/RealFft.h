@@ -0,0 +1,68 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#pragma once
+
+#include "stdafx.h"
+#include "SimdSupport.h"
+
+// Power spectrum of a block of real samples.  The N real points are packed into an N/2
+// point complex FFT (split real/imaginary arrays, radix-4 first pass then radix-2 stages
+// vectorized across butterflies) and unpacked afterwards.  Twiddles and the bit reversal
+// permutation are computed once per transform size.
+//
+class RealFft
+{
+    UINT                    m_size;                 // Real input points (power of 2, >= 8)
+    UINT                    m_half;                 // Complex FFT points
+    SimdLevel               m_simd;
+
+    std::vector<UINT>       m_bit_reverse;
+    std::vector<float>      m_stage_re;             // Twiddles for the stage of half size h start at h-1
+    std::vector<float>      m_stage_im;
+    std::vector<float>      m_unpack_re;            // e^(-2 pi i k / N) for the real unpacking
+    std::vector<float>      m_unpack_im;
+    std::vector<float>      m_re;
+    std::vector<float>      m_im;
+
+public:
+    RealFft( UINT size, SimdLevel simd=::getSimdLevel() );
+
+    inline UINT getSize() const {
+        return m_size;
+    }
+
+    inline UINT getBins() const {
+        return m_half+1;
+    }
+
+    inline SimdLevel getSimdLevel() const {
+        return m_simd;
+    }
+
+    // Windows the input and fills power with |X[k]|^2 for k = 0 .. size/2
+    void powerSpectrum( const float* input, const float* window, float* power );
+
+private:
+    void transform( void );
+};
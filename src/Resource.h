@@ -1,16 +1,16 @@
-//{{NO_DEPENDENCIES}}
-// Microsoft Visual C++ generated include file.
-// Used by SpotifyEngine.rc
-//
-
-// Next default values for new objects
-//
-#ifdef APSTUDIO_INVOKED
-#ifndef APSTUDIO_READONLY_SYMBOLS
-
-#define _APS_NEXT_RESOURCE_VALUE	2000
-#define _APS_NEXT_CONTROL_VALUE		2000
-#define _APS_NEXT_SYMED_VALUE		2000
-#define _APS_NEXT_COMMAND_VALUE		32771
-#endif
-#endif
+//{{NO_DEPENDENCIES}}
+// Microsoft Visual C++ generated include file.
+// Used by SpotifyEngine.rc
+//
+
+// Next default values for new objects
+//
+#ifdef APSTUDIO_INVOKED
+#ifndef APSTUDIO_READONLY_SYMBOLS
+
+#define _APS_NEXT_RESOURCE_VALUE	2000
+#define _APS_NEXT_CONTROL_VALUE		2000
+#define _APS_NEXT_SYMED_VALUE		2000
+#define _APS_NEXT_COMMAND_VALUE		32771
+#endif
+#endif
@@ -0,0 +1,70 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#include "stdafx.h"
+#include "SimdSupport.h"
+
+#include <intrin.h>
+
+// ----------------------------------------------------------------------------
+// Best SIMD level supported by both this CPU and the OS (AVX state must be saved
+// by the OS on context switch or the upper register halves get trashed)
+//
+SimdLevel getSimdLevel( void )
+{
+    static SimdLevel level = (SimdLevel)-1;
+
+    if ( level != (SimdLevel)-1 )
+        return level;
+
+    int info[4];
+
+    __cpuid( info, 0 );
+    int max_leaf = info[0];
+
+    __cpuid( info, 1 );
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    bool avx2 = false;
+
+    if ( max_leaf >= 7 && osxsave && avx && (_xgetbv( 0 ) & 0x6) == 0x6 ) {
+        __cpuidex( info, 7, 0 );
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+
+    level = avx2 ? SIMD_AVX2 : sse2 ? SIMD_SSE2 : SIMD_SCALAR;
+
+    return level;
+}
+
+// ----------------------------------------------------------------------------
+//
+LPCSTR getSimdLevelName( SimdLevel level )
+{
+    switch ( level ) {
+        case SIMD_AVX2:     return "AVX2";
+        case SIMD_SSE2:     return "SSE2";
+        default:            return "scalar";
+    }
+}
@@ -0,0 +1,209 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#include "stdafx.h"
+#include "SimulatedAudioSink.h"
+
+// ----------------------------------------------------------------------------
+//
+SimulatedAudioSink::SimulatedAudioSink( const WAVEFORMATEX* mix_format, double realtime_multiple, LPCSTR name ) :
+    Threadable( "SimulatedAudioSink" ),
+    m_name( name ),
+    m_mix_format( *mix_format ),
+    m_event_driven( false ),
+    m_period_frames( 1 ),
+    m_buffer_frames( 0 ),
+    m_running( false ),
+    m_clock( 0 ),
+    m_written( 0 ),
+    m_played( 0 ),
+    m_realtime_multiple( realtime_multiple )
+{
+    STUDIO_ASSERT( realtime_multiple > 0.0, "Invalid simulated audio device clock multiple %f", realtime_multiple );
+
+    m_mix_format.cbSize = 0;                            // We only keep the WAVEFORMATEX part
+    m_format = m_mix_format;
+}
+
+// ----------------------------------------------------------------------------
+//
+SimulatedAudioSink::~SimulatedAudioSink(void)
+{
+    close();
+}
+
+// ----------------------------------------------------------------------------
+//
+void SimulatedAudioSink::close( void )
+{
+    stopThread();
+}
+
+// ----------------------------------------------------------------------------
+// Mirrors the WASAPI sink: event mode buffers two periods, timer mode buffers one second
+// and wants filling every half second.  Faster than real time clocks scale the buffer so
+// the render loop still wakes every period of wall clock time.
+//
+void SimulatedAudioSink::initialize( const WAVEFORMATEX* format, bool auto_convert, bool event_driven, UINT period_ms )
+{
+    STUDIO_ASSERT( auto_convert || 
+                   ( format->nChannels == m_mix_format.nChannels && 
+                     format->nSamplesPerSec == m_mix_format.nSamplesPerSec &&
+                     format->wBitsPerSample == m_mix_format.wBitsPerSample ),
+                   "Audio output stream %s does not support [%d %d-bit channel(s) @ %dHz]", (LPCSTR)m_name,
+                   format->nChannels, format->wBitsPerSample, format->nSamplesPerSec );
+
+    m_format = *format;
+    m_format.cbSize = 0;
+    m_event_driven = event_driven;
+
+    if ( event_driven ) {
+        m_period_frames = max( 1UL, m_format.nSamplesPerSec * period_ms / 1000 );
+        m_buffer_frames = m_period_frames * 2;
+    }
+    else {
+        m_buffer_frames = m_format.nSamplesPerSec * AUDIO_TIMER_BUFFER_MS / 1000;
+        m_period_frames = m_buffer_frames / 2;
+    }
+
+    if ( m_realtime_multiple > 1.0 ) {
+        m_period_frames = (UINT32)(m_period_frames * m_realtime_multiple);
+        m_buffer_frames = (UINT32)(m_buffer_frames * m_realtime_multiple);
+    }
+
+    m_buffer.resize( m_buffer_frames * m_format.nBlockAlign );
+
+    if ( !isRunning() )
+        startThread();
+}
+
+// ----------------------------------------------------------------------------
+// Clock thread - advances the device clock by elapsed wall clock time * multiple
+//
+UINT SimulatedAudioSink::run(void)
+{
+    LARGE_INTEGER frequency, last, now;
+    double pending = 0.0;
+
+    QueryPerformanceFrequency( &frequency );
+    QueryPerformanceCounter( &last );
+
+    while ( isRunning() ) {
+        Sleep( 1 );
+
+        QueryPerformanceCounter( &now );
+
+        pending += (double)(now.QuadPart - last.QuadPart) / frequency.QuadPart * m_format.nSamplesPerSec * m_realtime_multiple;
+        last = now;
+
+        UINT32 frames = (UINT32)pending;
+        if ( frames > 0 ) {
+            advanceClock( frames );
+            pending -= frames;
+        }
+    }
+
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+//
+UINT32 SimulatedAudioSink::getPadding( void )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    return (UINT32)(m_written - m_played);
+}
+
+// ----------------------------------------------------------------------------
+//
+BYTE* SimulatedAudioSink::getBuffer( UINT32 frames )
+{
+    STUDIO_ASSERT( frames <= m_buffer_frames - getPadding(), "Audio output stream %s buffer overrun", (LPCSTR)m_name );
+
+    return &m_buffer[0];
+}
+
+// ----------------------------------------------------------------------------
+//
+void SimulatedAudioSink::releaseBuffer( UINT32 frames )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    m_written += frames;
+}
+
+// ----------------------------------------------------------------------------
+//
+void SimulatedAudioSink::start( void )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    m_running = true;
+}
+
+// ----------------------------------------------------------------------------
+//
+void SimulatedAudioSink::stop( void )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    m_running = false;
+}
+
+// ----------------------------------------------------------------------------
+//
+void SimulatedAudioSink::reset( void )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    m_written = m_played;                               // Discard anything queued
+}
+
+// ----------------------------------------------------------------------------
+// Both modes are paced by the simulated clock
+//
+bool SimulatedAudioSink::waitForBuffer( HANDLE wake, DWORD timeout_ms )
+{
+    HANDLE events[] = { m_buffer_event, wake };
+
+    return ::WaitForMultipleObjects( 2, events, FALSE, timeout_ms ) == WAIT_OBJECT_0;
+}
+
+// ----------------------------------------------------------------------------
+//
+void SimulatedAudioSink::advanceClock( UINT32 frames )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    if ( !m_running )
+        return;
+
+    m_played += min( (ULONGLONG)frames, m_written - m_played );
+
+    ULONGLONG period = m_clock / m_period_frames;
+    m_clock += frames;
+
+    if ( m_clock / m_period_frames != period )
+        m_buffer_event.SetEvent();
+}
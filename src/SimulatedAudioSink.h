@@ -0,0 +1,91 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#pragma once
+
+#include "stdafx.h"
+#include "AudioSink.h"
+#include "Threadable.h"
+
+// A render device whose clock is advanced by a thread rather than by hardware.  Lets the
+// render loop's scheduling (fill sizes, wake ups, underruns) be run without a sound card,
+// at real time or a multiple of it.  Rendered frames are discarded.  It uses the MFC
+// synchronization classes like the rest of the engine, so it only runs on Windows.
+
+class SimulatedAudioSink : public AudioSink, public Threadable
+{
+    CString                 m_name;
+    WAVEFORMATEX            m_mix_format;
+    WAVEFORMATEX            m_format;           // Format being rendered
+    bool                    m_event_driven;
+    UINT32                  m_period_frames;    // Frames between buffer wake ups
+    UINT32                  m_buffer_frames;
+    std::vector<BYTE>       m_buffer;
+
+    CCriticalSection        m_lock;             // Protects the clock and counters
+    CEvent                  m_buffer_event;     // Signaled each period of simulated time
+    bool                    m_running;
+    ULONGLONG               m_clock;            // Simulated time in frames
+    ULONGLONG               m_written;          // Frames released into the buffer
+    ULONGLONG               m_played;           // Frames consumed by the simulated device
+    double                  m_realtime_multiple;// Clock thread speed
+
+    UINT run(void);
+
+    // Move the device clock forward
+    void advanceClock( UINT32 frames );
+
+public:
+    SimulatedAudioSink( const WAVEFORMATEX* mix_format, double realtime_multiple=1.0, LPCSTR name="Simulated" );
+    virtual ~SimulatedAudioSink(void);
+
+    LPCSTR getName( void ) const {
+        return m_name;
+    }
+
+    const WAVEFORMATEX* getMixFormat( void ) const {
+        return &m_mix_format;
+    }
+
+    bool isEventDriven( void ) const {
+        return m_event_driven;
+    }
+
+    UINT32 getBufferFrames( void ) const {
+        return m_buffer_frames;
+    }
+
+    void open( void ) {}
+    void close( void );
+    void initialize( const WAVEFORMATEX* format, bool auto_convert, bool event_driven, UINT period_ms );
+
+    UINT32 getPadding( void );
+    BYTE* getBuffer( UINT32 frames );
+    void releaseBuffer( UINT32 frames );
+
+    void start( void );
+    void stop( void );
+    void reset( void );
+
+    bool waitForBuffer( HANDLE wake, DWORD timeout_ms );
+};
@@ -1,868 +1,1480 @@
-/* 
-Copyright (C) 2011-17 Robert DeSantis
-hopluvr at gmail dot com
-
-This file is part of DMX Studio.
- 
-DMX Studio is free software; you can redistribute it and/or modify
-it under the terms of the GNU General Public License as published by
-the Free Software Foundation; either version 3 of the License, or (at your
-option) any later version.
- 
-DMX Studio is distributed in the hope that it will be useful, but
-WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
-or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
-License for more details.
- 
-You should have received a copy of the GNU General Public License
-along with DMX Studio; see the file _COPYING.txt.  If not, write to
-the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
-MA 02111-1307, USA.
-*/
-
-#include "stdafx.h"
-#include "SpotifyEngine.h"
-#include "SimpleJsonBuilder.h"
-#include "SimpleJsonParser.h"
-
-#define DEBUG_SPOTIFY   false
-
-#define SPOTIFY_API_CALLED( fmt, ... )		\
-    if ( DEBUG_SPOTIFY ) { printf( fmt, __VA_ARGS__ ); printf( "\n" ); }
-
-#define SPOTIFY_CREDENTIALS_FILE "spotify.credentials"
-
-// ----------------------------------------------------------------------------
-//
-SpotifyEngine::SpotifyEngine(void) :
-    m_current_track(NULL),
-    m_track_state( TRACK_ENDED ),
-    m_spotify_session(NULL),
-    m_spotify_command( CMD_NONE ),
-    m_login_state( NOT_LOGGED_IN ),
-    m_audio_out( NULL ),
-    m_track_length_ms( 0 ),
-    m_track_seek_ms( 0 ),
-    m_track_timer( this ),
-    Threadable( "Engine" )
-{
-    memset( &spconfig, 0, sizeof(sp_session_config) );
-
-    inititializeSpotifyCallbacks();
-
-    spconfig.api_version = SPOTIFY_API_VERSION;
-    spconfig.cache_location = "/tmp_dmxstudio_spotify";
-    spconfig.settings_location = spconfig.cache_location;
-    spconfig.application_key = g_appkey;
-    spconfig.application_key_size = g_appkey_size;
-    spconfig.user_agent = "DMXStudio-spotify-controller";
-
-    spconfig.callbacks = &session_callbacks;
-    spconfig.userdata = this;
-    spconfig.compress_playlists = false;
-    spconfig.dont_save_metadata_for_playlists = false;
-    spconfig.initially_unload_playlists = false;
-
-    spconfig.proxy = NULL;
-    spconfig.proxy_username = NULL;
-    spconfig.proxy_password = NULL;
-    spconfig.tracefile = NULL;
-    spconfig.device_id = "DMXSTUDIO-1";
-
-    m_trackAnalysisContainer.Format( "%s\\DMXStudio\\SpotifyTrackAnalyzeCache", getUserDocumentDirectory() );
-    CreateDirectory( m_trackAnalysisContainer, NULL );
-}
-
-// ----------------------------------------------------------------------------
-//
-SpotifyEngine::~SpotifyEngine(void)
-{
-    disconnect();
-}
-
-// ----------------------------------------------------------------------------
-// UI API METHODS
-// ----------------------------------------------------------------------------
-
-// ----------------------------------------------------------------------------
-//
-bool SpotifyEngine::connect()
-{
-    CString username;
-    CString blob;
-
-    if ( !_readCredentials( username, blob ) )
-        return false;
-
-    return connect( username, NULL, blob );
-}
-
-// ----------------------------------------------------------------------------
-//
-bool SpotifyEngine::connect( LPCSTR username, LPCSTR password, LPCSTR blob ) 
-{
-    sp_error err;
-
-    if ( !m_spotify_session ) {                // Create a new Spoty session
-        err = sp_session_create( &spconfig, &m_spotify_session);
-        if ( SP_ERROR_OK != err ) {
-            m_spotify_error.Format( "Unable to create session: %s", sp_error_message(err) );
-            return false;
-        }
-    }
-
-    m_login_state = LOGIN_WAIT;
-
-    err = sp_session_login( m_spotify_session, username, password, 1, blob );
-    if (SP_ERROR_OK != err) {
-        m_spotify_error.Format( "Unable to log in: %s", sp_error_message(err) );
-        return false;
-    }
-
-    // We appear to get a "successful" login callback immediately after the sp_session_login(), 
-    // then, eventually, a bad login. This wait is to help combat that odd behavior by sucking up
-    // both messages.  It is, obviously, highly timing dependant.
-
-    ULONG future = GetCurrentTime() + (2 * 1000);
-    while ( GetCurrentTime() < future && getLoginState() != LOGIN_FAILED ) {
-        int next_timeout = 0;
-        do {
-            sp_session_process_events( m_spotify_session, &next_timeout );
-        } while (next_timeout == 0);
-
-        Sleep( 100 );
-    }
-
-    future = GetCurrentTime() + (60 * 1000);
-
-    while ( getLoginState() == LOGIN_WAIT ) {
-        int next_timeout = 0;
-        do {
-            sp_session_process_events( m_spotify_session, &next_timeout );
-        } while (next_timeout == 0);
-
-        if ( GetCurrentTime() > future ) {
-            m_spotify_error = "Login timed-out";
-            break;
-        }
-
-        Sleep( 100 );
-    }
-
-    if ( m_login_state != LOGIN_SUCCESS )
-        return false;
-
-    m_waveFormat.wFormatTag = WAVE_FORMAT_PCM;
-    m_waveFormat.nChannels = 2;
-    m_waveFormat.nSamplesPerSec = 44100;
-    m_waveFormat.wBitsPerSample = 16;
-    m_waveFormat.cbSize = 0;
-    m_waveFormat.nBlockAlign = (m_waveFormat.wBitsPerSample * m_waveFormat.nChannels) / 8;
-    m_waveFormat.nAvgBytesPerSec = m_waveFormat.nSamplesPerSec * m_waveFormat.nBlockAlign;
-    
-    try {
-        m_audio_out = AudioOutputStream::createAudioStream();
-        m_audio_out->openAudioStream( &m_waveFormat );
-    }
-    catch ( std::exception& ex ) {
-        log( ex );
-        m_spotify_error = ex.what();
-        disconnect();
-        return false;
-    }
-
-    m_track_timer.startThread();
-
-    return startThread();
-}
-
-// ----------------------------------------------------------------------------
-//
-bool SpotifyEngine::disconnect( void )
-{
-    m_track_timer.stopThread();
-
-    if ( m_spotify_session ) {
-        // Seems to be very important to stop all active tracks before killing Spotify
-
-        clearTrackQueue( );         // Clear any pending tracks
-        stopTrack();                // Stop any playing track(s)
-        stopThread();               // Stop the spotify dispatcher
-
-        ULONG future = GetCurrentTime() + (2 * 60 * 1000);
-
-        // Logout the user        
-        sp_session_logout( m_spotify_session );
-        while ( getLoginState() != NOT_LOGGED_IN ) {
-            int next_timeout = 0;
-            do {
-                sp_session_process_events( m_spotify_session, &next_timeout );
-            } while (next_timeout == 0);
-
-            if ( GetCurrentTime() > future )
-                break;
-
-            Sleep( 100 );
-        }
-    }
-
-    if ( m_audio_out ) {
-        AudioOutputStream::releaseAudioStream ( m_audio_out );
-        m_audio_out = NULL;
-    }
-
-    removeTrackAnalyzer();
-
-    freeTrackAnalysisCache();
-
-    return true;
-}
-
-// ----------------------------------------------------------------------------
-//
-bool SpotifyEngine::registerEventListener( IPlayerEventCallback* listener )
-{
-    CSingleLock lock( &m_event_lock, TRUE );
-
-    if ( findListener( listener ) != m_event_listeners.end() )
-        return false;
-
-    m_event_listeners.push_back( listener );
-
-    return true;
-}
-
-// ----------------------------------------------------------------------------
-//
-bool SpotifyEngine::unregisterEventListener( IPlayerEventCallback* listener )
-{
-    CSingleLock lock( &m_event_lock, TRUE );
-
-    auto it = findListener( listener );
-    if ( it == m_event_listeners.end() )
-        return false;
-
-    m_event_listeners.erase( it );
-    return true;
-}
-
-// ----------------------------------------------------------------------------
-//
-EventListeners::iterator SpotifyEngine::findListener( IPlayerEventCallback* listener ) {
-    auto it=m_event_listeners.begin();
-
-    while ( it != m_event_listeners.end() ) {
-        if ( (*it) == listener )
-            break;
-        it++;
-    }
-
-    return it;
-}
-
-// ----------------------------------------------------------------------------
-//
-void SpotifyEngine::sendEvent( PlayerEvent event, ULONG event_ms, LPCSTR track_link ) 
-{
-    CSingleLock lock( &m_event_lock, TRUE );
-
-    PlayerEventData trackEvent( event, event_ms, track_link );
-
-    for ( IPlayerEventCallback* callback : m_event_listeners )
-        callback->notify( &trackEvent );
-
-    m_track_event.SetEvent();
-}
-
-// ----------------------------------------------------------------------------
-//
-void SpotifyEngine::sendTrackQueueEvent() 
-{
-    CSingleLock lock( &m_event_lock, TRUE );
-
-    PlayerEventData trackEvent( m_track_played_queue.size(), m_track_queue.size() );
-
-    for ( IPlayerEventCallback* callback : m_event_listeners )
-        callback->notify( &trackEvent );
-
-    m_track_event.SetEvent();
-}
-
-// ----------------------------------------------------------------------------
-//
-void SpotifyEngine::sendPlaylistEvent( PlayerEvent event, sp_playlist *playlist ) {
-/* Playlist notification appear to be really broken - just ignore these for now
-    sp_link* link = sp_link_create_from_playlist( playlist );
-
-    if ( link != NULL ) {
-        CString spotify_link;
-        LPSTR spotify_link_ptr = spotify_link.GetBufferSetLength( 512 );
-        sp_link_as_string ( link, spotify_link_ptr, 512 );
-        sp_link_release( link );
-
-        sendEvent( event, 0L, (LPCSTR)spotify_link );
-    }
-*/
-}
-
-// ----------------------------------------------------------------------------
-//
-void SpotifyEngine::stopTrack()
-{
-    sendCommand( CMD_STOP_TRACK );
-}
-
-// ----------------------------------------------------------------------------
-//
-void SpotifyEngine::clearTrackQueue( )
-{
-    CSingleLock lock( &m_mutex, TRUE );
-
-    m_track_queue.clear();
-
-    sendTrackQueueEvent();
-}
-
-// ----------------------------------------------------------------------------
-//
-void SpotifyEngine::previousTrack()
-{
-    CSingleLock lock( &m_mutex, TRUE );
-
-    if ( m_current_track && getTrackPlayTime() > 10*1000 ) {    // If current track > 10 seconds in, return to start
-        if ( m_track_played_queue.size() )
-            m_track_played_queue.pop_back();
-
-        playTrack( m_current_track_link, 0L ); 
-    }
-    else if ( m_track_played_queue.size() ) {
-        if ( m_current_track ) {                                // Skip over currently playing track (re-queue it)
-            TrackQueueEntry track = m_track_played_queue.back();
-            m_track_played_queue.pop_back();
-            m_track_queue.push_front( track );
-        }
-
-        if ( m_track_played_queue.size() ) {
-            TrackQueueEntry track = m_track_played_queue.back();
-            m_track_played_queue.pop_back();
-            playTrack( track.m_track_link, 0L ); 
-        }
-        else {                                                  // Current track was the only track in the played queue
-            stopTrack();
-
-            sendTrackQueueEvent();
-        }
-    }
-}
-
-// ----------------------------------------------------------------------------
-//
-void SpotifyEngine::playTrack( LPCSTR track_link, DWORD seek_ms )
-{
-    CSingleLock lock( &m_mutex, TRUE );
-
-    // See if this track is already in the played list - and move to that position
-    TrackQueue::iterator it_position;
-    for ( it_position=m_track_played_queue.begin(); it_position != m_track_played_queue.end() && (*it_position).m_track_link != track_link; )
-        it_position++;
-
-    if ( it_position != m_track_played_queue.end() ) {
-        (*it_position).m_seek_ms = seek_ms;
-
-        size_t count = std::distance( it_position, m_track_played_queue.end() );
-        while ( count-- > 0 ) {
-            m_track_queue.push_front( m_track_played_queue.back() );
-            m_track_played_queue.pop_back();
-        }
-    }
-    else {
-        // See if this track is already in the queue list - and move to that position
-        TrackQueue::iterator it_position;
-        for ( it_position=m_track_queue.begin(); it_position != m_track_queue.end() && (*it_position).m_track_link != track_link; )
-            it_position++;
-    
-        if ( it_position != m_track_queue.end() ) {
-            (*it_position).m_seek_ms = seek_ms;
-            std::copy( m_track_queue.begin(), it_position, back_inserter(m_track_played_queue) );
-            m_track_queue.erase( m_track_queue.begin(), it_position );
-        }
-        else 
-            m_track_queue.push_front( TrackQueueEntry( track_link, seek_ms ) );
-    
-    }
-
-    sendCommand( CMD_NEXT_TRACK );
-
-    sendTrackQueueEvent();
-}
-
-// ----------------------------------------------------------------------------
-//
-void SpotifyEngine::playTracks( TrackLinkList& playlist ) 
-{
-    CSingleLock lock( &m_mutex, TRUE );
-    m_track_queue.clear();
-
-    for ( auto const& track_uri : playlist )
-        m_track_queue.push_back( TrackQueueEntry( track_uri, 0L ) );
-
-    sendCommand( CMD_NEXT_TRACK );
-
-    sendTrackQueueEvent();
-}
-
-// ----------------------------------------------------------------------------
-//
-void SpotifyEngine::queueTracks( TrackLinkList& playlist ) 
-{
-    CSingleLock lock( &m_mutex, TRUE );
-
-    for ( auto const& track_uri : playlist )
-        m_track_queue.push_back( TrackQueueEntry( track_uri, 0L ) );
-
-    sendCommand( CMD_CHECK_PLAYING );
-
-    sendTrackQueueEvent();
-}
-
-// ----------------------------------------------------------------------------
-//
-void SpotifyEngine::nextTrack()
-{
-    sendCommand( CMD_NEXT_TRACK );
-}
-
-// ----------------------------------------------------------------------------
-//
-void SpotifyEngine::queueTrack( LPCSTR track_link )
-{
-    CSingleLock lock( &m_mutex, TRUE );
-    m_track_queue.push_back( TrackQueueEntry( track_link, 0L ) );
-
-    sendCommand( CMD_CHECK_PLAYING );
-
-    sendTrackQueueEvent();
-}
-
-// ----------------------------------------------------------------------------
-//
-void SpotifyEngine::pauseTrack( bool pause )
-{
-    sendCommand( ( pause ) ? CMD_PAUSE_TRACK : CMD_RESUME_TRACK );
-}
-
-// ----------------------------------------------------------------------------
-//
-void SpotifyEngine::removeTrackAnalyzer() {
-    if ( isAnalyzing() ) {
-        delete m_analyzer;
-        m_analyzer = NULL;
-    }
-}
-
-// ----------------------------------------------------------------------------
-// ENGINE DISPATCHER AND HELPER METHODS
-// ----------------------------------------------------------------------------
-
-// ----------------------------------------------------------------------------
-//
-UINT SpotifyEngine::run()
-{
-    log_status( "Spotify engine started" );
-    
-    int next_timeout = 0;
-    ULONG wait_time = 0L;
-
-    while ( isRunning() ) {
-        try {
-            while ( ::WaitForSingleObject( m_spotify_notify, 100 ) != WAIT_OBJECT_0 ) {
-                if ( m_current_track != NULL ) {
-                    switch ( m_track_state ) {
-                        case TRACK_STREAM_COMPLETE:
-                            sp_session_player_unload( m_spotify_session );
-                            m_track_state = TRACK_PLAYING;
-                            break;
-
-                        case TRACK_PLAYING:
-                            if ( m_audio_out->getCachedSamples() == 0 ) {
-                                _processTrackAnalysis();
-
-                                m_track_state = TRACK_ENDED;
-                                m_current_track = NULL;
-                                wait_time = 0;
-
-                                m_track_timer.stop();
-
-                                _startTrack();
-                            }
-                            break;
-                    }
-                }
-
-                if ( GetCurrentTime() > wait_time )
-                    break;
-            }
-
-            // Handle any pending user command
-            switch ( m_spotify_command ) {
-                case CMD_STOP_TRACK:
-                    _stopTrack();                
-                    break;
-
-                case CMD_NEXT_TRACK:
-                    _stopTrack();
-                    _startTrack();
-                    break;
-
-                case CMD_PAUSE_TRACK:
-                    _pause();
-                    break;
-
-                case CMD_RESUME_TRACK:
-                    _resume();
-                    break;
-
-                case CMD_CHECK_PLAYING:
-                    if ( m_current_track == NULL )
-                        _startTrack();
-                    break;
-            }
-
-            m_spotify_command = CMD_NONE;
-
-            // Dispatch Spotify messages
-            do {
-                sp_session_process_events( m_spotify_session, &next_timeout );
-            } while (next_timeout == 0);
-
-            if ( next_timeout != 0 )
-                wait_time = next_timeout + GetCurrentTime();
-            else
-                wait_time = 0;
-        }
-        catch ( std::exception& ex ) {
-            log( ex );
-            m_spotify_error = ex.what();
-        }
-    }
-
-    log_status( "Spotify engine stopped" );
-
-    return 0;
-}
-
-// ----------------------------------------------------------------------------
-//
-void SpotifyEngine::_stopTrack( )
-{
-    if ( m_current_track != NULL ) {
-        sp_session_player_unload( m_spotify_session );
-        m_audio_out->cancel();
-
-        m_current_track = NULL;
-        m_current_track_link.Empty();
-        m_track_state = TRACK_ENDED;
-        m_track_length_ms = m_track_seek_ms = 0L;
-
-        m_track_timer.stop( );
-
-        removeTrackAnalyzer();
-    }
-}
-
-// ----------------------------------------------------------------------------
-//
-void SpotifyEngine::_startTrack( )
-{
-	CSingleLock lock( &m_mutex, TRUE );
-
-	sp_error result;
-
-    while ( m_track_queue.size() ) {
-        TrackQueueEntry entry = m_track_queue.front();
-        m_track_queue.pop_front();
-		m_track_played_queue.push_back( entry );
-
-		// Get the libspotify track
-		m_current_track = linkToTrack( entry.m_track_link );
-		if ( m_current_track == NULL ) {
-			StudioException ex( "Invalid Spotify track link from '%s'", m_current_track_link );
-			log( ex );
-			m_spotify_error = ex.what();
-			continue;
-		}
-
-		m_current_track_link = entry.m_track_link;
-
-		if ( (result = sp_session_player_load( m_spotify_session, m_current_track )) != SP_ERROR_OK ) {
-			bool loaded = sp_track_is_loaded( m_current_track );
-
-			StudioException ex( "Error %d from sp_session_player_load (loaded=%d)", (INT)result, loaded );
-			log( ex );
-			m_spotify_error = ex.what();
-			_stopTrack( );
-			continue;
-        }
-
-        m_track_state = TRACK_STREAM_PENDING;
-        m_track_length_ms = sp_track_duration( m_current_track );
-        m_track_seek_ms = entry.m_seek_ms > m_track_length_ms ? 0 : entry.m_seek_ms;
-
-        if ( m_track_seek_ms != 0L )
-            sp_session_player_seek( m_spotify_session, m_track_seek_ms );
-        else if ( !haveTrackAnalysis(m_current_track_link) ) {
-            m_analyzer = new TrackAnalyzer( &m_waveFormat, m_track_length_ms, m_current_track_link );
-        }
-
-        if ( !isTrackPaused() ) {
-            result = sp_session_player_play( m_spotify_session, true );
-            if ( result != SP_ERROR_OK ) {
-				StudioException ex( "Error %d from sp_session_player_play", (INT)result );
-				log( ex );
-				m_spotify_error = ex.what();
-				_stopTrack( );
-				continue;
-            }
-        }
-
-        sendTrackQueueEvent();
-
-		break;
-    }
-}
-
-// ----------------------------------------------------------------------------
-//
-void SpotifyEngine::_resume( )
-{
-    if ( isTrackPaused() ) {
-        sp_session_player_play( m_spotify_session, true );
-
-        if ( m_audio_out->isPaused() )
-            m_audio_out->setPaused( false );
-
-        m_track_timer.resume();
-    }
-}
-
-// ----------------------------------------------------------------------------
-//
-void SpotifyEngine::_pause( )
-{
-    if ( !isTrackPaused() ) {
-        m_audio_out->setPaused( true );
-        sp_session_player_play( m_spotify_session, false );
-
-        m_track_timer.pause();
-    }
-}
-
-// ----------------------------------------------------------------------------
-//
-void SpotifyEngine::_processTrackAnalysis() 
-{
-    if ( isAnalyzing() ) {
-        saveTrackAnalysis( m_analyzer->captureAnalyzerData() );
-        removeTrackAnalyzer();
-    }
-}
-
-// ----------------------------------------------------------------------------
-// CREDENTIALS PERSISTANCE METHODS
-// ----------------------------------------------------------------------------
-
-// ----------------------------------------------------------------------------
-//
-bool SpotifyEngine::_readCredentials( CString& username, CString& credentials )
-{
-    CString filename;
-    filename.Format( "%s\\DMXStudio\\%s", getUserDocumentDirectory(), SPOTIFY_CREDENTIALS_FILE );
-
-    username.Empty();
-    credentials.Empty();
-
-    if ( GetFileAttributes( filename ) == INVALID_FILE_ATTRIBUTES )
-        return false;
-
-    FILE* hFile = _fsopen( filename, "rt", _SH_DENYWR );
-    if ( hFile == NULL )
-        return false;
-
-    LPSTR lpUsername = username.GetBufferSetLength( 256 );
-    LPSTR lpCredentials = credentials.GetBufferSetLength( 2048 );
-
-    size_t read = fscanf_s( hFile, "%s %s", lpUsername, 256, lpCredentials, 256 );
-
-    username.ReleaseBuffer();
-    credentials.ReleaseBuffer();
-    fclose( hFile );
-
-    return read == 2;
-}
-
-// ----------------------------------------------------------------------------
-//
-void SpotifyEngine::_writeCredentials( LPCSTR username, LPCSTR credentials )
-{
-    CString filename;
-    filename.Format( "%s\\DMXStudio\\%s", getUserDocumentDirectory(), SPOTIFY_CREDENTIALS_FILE );
-
-    FILE* hFile = _fsopen( filename, "wt", _SH_DENYWR );
-    fprintf( hFile, "%s %s", username, credentials );
-    fclose( hFile );
-}
-
-// ----------------------------------------------------------------------------
-// TRACK ANALYSIS PERSISTANCE METHODS
-// ----------------------------------------------------------------------------
-
-// ----------------------------------------------------------------------------
-//
-AnalyzeInfo* SpotifyEngine::getTrackAnalysis( LPCSTR track_link )
-{
-    return loadTrackAnalysis( track_link );
-}
-
-// ----------------------------------------------------------------------------
-//
-void SpotifyEngine::freeTrackAnalysisCache( )
-{
-    for ( auto const& it : m_track_analysis_cache )
-        free( it.second );
-
-    m_track_analysis_cache.clear();
-}
-
-// ----------------------------------------------------------------------------
-//
-CString makeTrackAnalysisFileName( LPCSTR directory, LPCSTR spotify_id )
-{
-    CString safe_id( spotify_id );
-    safe_id.Replace( ':', '_' );
-    safe_id.Replace( '/', '_' );
-    safe_id.Replace( '\\', '_' );
-
-    CString filename;
-    filename.Format( "%s\\%s.analyze", directory, (LPCSTR)safe_id );
-
-    return filename;
-}
-
-// ----------------------------------------------------------------------------
-//
-bool SpotifyEngine::haveTrackAnalysis( LPCSTR spotify_link ) {
-    if ( m_track_analysis_cache.find( spotify_link ) != m_track_analysis_cache.end() )
-        return true;
-
-    // See if it exists but is not loaded
-    CString filename = makeTrackAnalysisFileName( m_trackAnalysisContainer, spotify_link );
-
-    DWORD dwAttrib = GetFileAttributes( filename );
-
-    return ( dwAttrib != INVALID_FILE_ATTRIBUTES &&  !(dwAttrib & FILE_ATTRIBUTE_DIRECTORY) );
-}
-
-// ----------------------------------------------------------------------------
-//
-bool SpotifyEngine::saveTrackAnalysis( AnalyzeInfo* info )
-{
-    CString contents;
-
-    JsonBuilder json( contents );
-
-    json.startObject();
-    json.add( "link", info->link );
-
-    std::vector<uint16_t> data( std::begin( info->data), &info->data[info->data_count] );
-
-    json.startObject( "amplitude" );
-    json.add( "duration_ms", info->duration_ms );
-    json.add( "data_count", info->data_count );
-    json.addArray< std::vector<uint16_t>>( "data", data );
-    json.endObject( "amplitude" );
-
-    json.endObject();
-
-    // Write the file out
-    CString filename = makeTrackAnalysisFileName( m_trackAnalysisContainer, info->link );
-
-    FILE* hFile = _fsopen( filename, "wt", _SH_DENYWR );
-    size_t written = fwrite( (LPCSTR)contents, 1, contents.GetLength(), hFile );
-    fclose( hFile );
-
-    if ( written != contents.GetLength() ) {
-        log( "Unable to write track analysis to %s", filename );
-        return false;
-    }
-
-    // Add it to the cache
-    TrackAnalysisCache::iterator it = m_track_analysis_cache.find( info->link );
-    if ( it != m_track_analysis_cache.end() ) {
-        free( (it)->second );
-        m_track_analysis_cache.erase( it );
-    }
-
-    m_track_analysis_cache[info->link] = info;
-
-    return true;
-}
-
-// ----------------------------------------------------------------------------
-//
-AnalyzeInfo* SpotifyEngine::loadTrackAnalysis( LPCSTR spotify_id )
-{
-    TrackAnalysisCache::iterator it = m_track_analysis_cache.find( spotify_id );
-    if ( it != m_track_analysis_cache.end() )
-        return (it)->second;
-
-    // See if it existing on disk - if available, load into the cache and return
-    CString filename = makeTrackAnalysisFileName( m_trackAnalysisContainer, spotify_id );
-
-    if ( GetFileAttributes( filename ) == INVALID_FILE_ATTRIBUTES )
-        return NULL;
-
-    FILE* hFile = _fsopen( filename, "rt", _SH_DENYWR );
-    if ( hFile == NULL ) {
-        log( "Unable to read track analysis from %s", filename );
-        return NULL;
-    }
-
-    // Get file size
-    fseek( hFile, 0L, SEEK_END );
-    size_t size = ftell( hFile );
-    rewind( hFile );
-
-    CString data;
-    fread( data.GetBufferSetLength(size), 1, size, hFile );
-    fclose( hFile );
-        
-    SimpleJsonParser parser;
-
-    try {
-        parser.parse( data );
-
-        CString spotify_id = parser.get<CString>( "link" );
-
-        SimpleJsonParser amplitute_parser = parser.get<SimpleJsonParser>( "amplitude" );
-
-        size_t data_count = amplitute_parser.get<size_t>( "data_count" );
-        UINT duration_ms = amplitute_parser.get<size_t>( "duration_ms" );
-        std::vector<uint16_t> amplitude_data = amplitute_parser.getArrayAsVector<uint16_t>( "data" );
-
-        AnalyzeInfo* info = (AnalyzeInfo*)calloc( sizeof(AnalyzeInfo) + (sizeof(uint16_t) * data_count), 1 );
-        for ( size_t i=0; i < data_count; i++ )
-            info->data[i] = amplitude_data[i];
-
-        strncpy_s( info->link, spotify_id, sizeof(info->link) );
-        info->data_count = data_count;
-        info->duration_ms = duration_ms;
-        m_track_analysis_cache[info->link] = info;
-
-        return info;
-    }
-    catch ( std::exception& e ) {
-        log( StudioException( "JSON parser error (%s) data (%s)", e.what(), data ) );
-        return NULL;
-    }
-}
-
+/* 
+Copyright (C) 2011-17 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+ 
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+ 
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+ 
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+#include "stdafx.h"
+#include "SpotifyEngine.h"
+#include "SimpleJsonBuilder.h"
+#include "SimpleJsonParser.h"
+
+#define DEBUG_SPOTIFY   false
+
+#define SPOTIFY_API_CALLED( fmt, ... )		\
+    if ( DEBUG_SPOTIFY ) { printf( fmt, __VA_ARGS__ ); printf( "\n" ); }
+
+#define SPOTIFY_CREDENTIALS_FILE "spotify.credentials"
+
+// ----------------------------------------------------------------------------
+//
+SpotifyEngine::SpotifyEngine(void) :
+    m_current_track(NULL),
+    m_track_state( TRACK_ENDED ),
+    m_spotify_session(NULL),
+    m_spotify_command( CMD_NONE ),
+    m_login_state( NOT_LOGGED_IN ),
+    m_audio_out( NULL ),
+    m_monitor_out( NULL ),
+    m_resampler_quality( RESAMPLE_MEDIUM ),
+    m_render_period_ms( DEFAULT_RENDER_PERIOD_MS ),
+    m_track_length_ms( 0 ),
+    m_track_seek_ms( 0 ),
+    m_analyzer( NULL ),
+    m_save_analysis( false ),
+    m_track_timer( this ),
+    m_analysis_worker( this, &m_track_timer ),
+    m_analysis_backpressure( ANALYSIS_BLOCK ),
+    m_analysis_cache_bytes( 0 ),
+    m_analysis_cache_budget( ANALYSIS_CACHE_BUDGET_BYTES ),
+    m_analysis_released( false ),
+    Threadable( "Engine" )
+{
+    memset( &spconfig, 0, sizeof(sp_session_config) );
+    memset( &m_analysis_cache_stats, 0, sizeof(m_analysis_cache_stats) );
+
+    inititializeSpotifyCallbacks();
+
+    spconfig.api_version = SPOTIFY_API_VERSION;
+    spconfig.cache_location = "/tmp_dmxstudio_spotify";
+    spconfig.settings_location = spconfig.cache_location;
+    spconfig.application_key = g_appkey;
+    spconfig.application_key_size = g_appkey_size;
+    spconfig.user_agent = "DMXStudio-spotify-controller";
+
+    spconfig.callbacks = &session_callbacks;
+    spconfig.userdata = this;
+    spconfig.compress_playlists = false;
+    spconfig.dont_save_metadata_for_playlists = false;
+    spconfig.initially_unload_playlists = false;
+
+    spconfig.proxy = NULL;
+    spconfig.proxy_username = NULL;
+    spconfig.proxy_password = NULL;
+    spconfig.tracefile = NULL;
+    spconfig.device_id = "DMXSTUDIO-1";
+
+    m_trackAnalysisContainer.Format( "%s\\DMXStudio\\SpotifyTrackAnalyzeCache", getUserDocumentDirectory() );
+    CreateDirectory( m_trackAnalysisContainer, NULL );
+
+    m_analysis_pack.open( m_trackAnalysisContainer );
+}
+
+// ----------------------------------------------------------------------------
+//
+SpotifyEngine::~SpotifyEngine(void)
+{
+    disconnect();
+}
+
+// ----------------------------------------------------------------------------
+// UI API METHODS
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+//
+bool SpotifyEngine::connect()
+{
+    CString username;
+    CString blob;
+
+    if ( !_readCredentials( username, blob ) )
+        return false;
+
+    return connect( username, NULL, blob );
+}
+
+// ----------------------------------------------------------------------------
+//
+bool SpotifyEngine::connect( LPCSTR username, LPCSTR password, LPCSTR blob ) 
+{
+    sp_error err;
+
+    if ( !m_spotify_session ) {                // Create a new Spoty session
+        err = sp_session_create( &spconfig, &m_spotify_session);
+        if ( SP_ERROR_OK != err ) {
+            m_spotify_error.Format( "Unable to create session: %s", sp_error_message(err) );
+            return false;
+        }
+    }
+
+    m_login_state = LOGIN_WAIT;
+
+    err = sp_session_login( m_spotify_session, username, password, 1, blob );
+    if (SP_ERROR_OK != err) {
+        m_spotify_error.Format( "Unable to log in: %s", sp_error_message(err) );
+        return false;
+    }
+
+    // We appear to get a "successful" login callback immediately after the sp_session_login(), 
+    // then, eventually, a bad login. This wait is to help combat that odd behavior by sucking up
+    // both messages.  It is, obviously, highly timing dependant.
+
+    ULONG future = GetCurrentTime() + (2 * 1000);
+    while ( GetCurrentTime() < future && getLoginState() != LOGIN_FAILED ) {
+        int next_timeout = 0;
+        do {
+            sp_session_process_events( m_spotify_session, &next_timeout );
+        } while (next_timeout == 0);
+
+        Sleep( 100 );
+    }
+
+    future = GetCurrentTime() + (60 * 1000);
+
+    while ( getLoginState() == LOGIN_WAIT ) {
+        int next_timeout = 0;
+        do {
+            sp_session_process_events( m_spotify_session, &next_timeout );
+        } while (next_timeout == 0);
+
+        if ( GetCurrentTime() > future ) {
+            m_spotify_error = "Login timed-out";
+            break;
+        }
+
+        Sleep( 100 );
+    }
+
+    if ( m_login_state != LOGIN_SUCCESS )
+        return false;
+
+    m_waveFormat.wFormatTag = WAVE_FORMAT_PCM;
+    m_waveFormat.nChannels = 2;
+    m_waveFormat.nSamplesPerSec = 44100;
+    m_waveFormat.wBitsPerSample = 16;
+    m_waveFormat.cbSize = 0;
+    m_waveFormat.nBlockAlign = (m_waveFormat.wBitsPerSample * m_waveFormat.nChannels) / 8;
+    m_waveFormat.nAvgBytesPerSec = m_waveFormat.nSamplesPerSec * m_waveFormat.nBlockAlign;
+    
+    try {
+        m_audio_out = AudioOutputStream::createAudioStream( m_render_device );
+        m_audio_out->setResamplerQuality( m_resampler_quality );
+        m_audio_out->setRenderPeriod( m_render_period_ms );
+        m_audio_out->openAudioStream( &m_waveFormat );
+
+        if ( !m_monitor_device.IsEmpty() ) {
+            m_monitor_out = AudioOutputStream::createAudioStream( m_monitor_device, m_audio_out );
+            m_monitor_out->setResamplerQuality( m_resampler_quality );
+            m_monitor_out->setRenderPeriod( m_render_period_ms );
+            m_monitor_out->openAudioStream( &m_waveFormat );
+        }
+
+        m_analysis_worker.attach( m_audio_out, m_analysis_backpressure );
+    }
+    catch ( std::exception& ex ) {
+        log( ex );
+        m_spotify_error = ex.what();
+        disconnect();
+        return false;
+    }
+
+    m_track_timer.startThread();
+    m_analysis_pack.startWorker();
+
+    return startThread();
+}
+
+// ----------------------------------------------------------------------------
+//
+bool SpotifyEngine::disconnect( void )
+{
+    m_track_timer.stopThread();
+
+    if ( m_spotify_session ) {
+        // Seems to be very important to stop all active tracks before killing Spotify
+
+        clearTrackQueue( );         // Clear any pending tracks
+        stopTrack();                // Stop any playing track(s)
+        stopThread();               // Stop the spotify dispatcher
+
+        ULONG future = GetCurrentTime() + (2 * 60 * 1000);
+
+        // Logout the user        
+        sp_session_logout( m_spotify_session );
+        while ( getLoginState() != NOT_LOGGED_IN ) {
+            int next_timeout = 0;
+            do {
+                sp_session_process_events( m_spotify_session, &next_timeout );
+            } while (next_timeout == 0);
+
+            if ( GetCurrentTime() > future )
+                break;
+
+            Sleep( 100 );
+        }
+    }
+
+    removeTrackAnalyzer();
+
+    // Analysis the worker was still finishing is saved with what it has
+    m_analysis_worker.discardBacklog();
+    _mergeFinishedAnalysis();
+
+    // Writes analysis still queued
+    m_analysis_pack.stopWorker();
+
+    // Ring readers go first
+    m_analysis_worker.detach();
+
+    // Taps go first - they read the primary stream's ring
+    if ( m_monitor_out ) {
+        AudioOutputStream::releaseAudioStream ( m_monitor_out );
+        m_monitor_out = NULL;
+    }
+
+    if ( m_audio_out ) {
+        AudioOutputStream::releaseAudioStream ( m_audio_out );
+        m_audio_out = NULL;
+    }
+
+    freeTrackAnalysisCache();
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+//
+bool SpotifyEngine::registerEventListener( IPlayerEventCallback* listener )
+{
+    CSingleLock lock( &m_event_lock, TRUE );
+
+    if ( findListener( listener ) != m_event_listeners.end() )
+        return false;
+
+    m_event_listeners.push_back( listener );
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+//
+bool SpotifyEngine::unregisterEventListener( IPlayerEventCallback* listener )
+{
+    CSingleLock lock( &m_event_lock, TRUE );
+
+    auto it = findListener( listener );
+    if ( it == m_event_listeners.end() )
+        return false;
+
+    m_event_listeners.erase( it );
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+//
+EventListeners::iterator SpotifyEngine::findListener( IPlayerEventCallback* listener ) {
+    auto it=m_event_listeners.begin();
+
+    while ( it != m_event_listeners.end() ) {
+        if ( (*it) == listener )
+            break;
+        it++;
+    }
+
+    return it;
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::sendEvent( PlayerEvent event, ULONG event_ms, LPCSTR track_link ) 
+{
+    CSingleLock lock( &m_event_lock, TRUE );
+
+    PlayerEventData trackEvent( event, event_ms, track_link );
+
+    for ( IPlayerEventCallback* callback : m_event_listeners )
+        callback->notify( &trackEvent );
+
+    m_track_event.SetEvent();
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::sendBeatEvent( ULONG beat_ms, LPCSTR track_link, float confidence ) 
+{
+    CSingleLock lock( &m_event_lock, TRUE );
+
+    PlayerEventData beatEvent( beat_ms, track_link, confidence );
+
+    for ( IPlayerEventCallback* callback : m_event_listeners )
+        callback->notify( &beatEvent );
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::sendTrackQueueEvent() 
+{
+    CSingleLock lock( &m_event_lock, TRUE );
+
+    PlayerEventData trackEvent( m_track_played_queue.size(), m_track_queue.size() );
+
+    for ( IPlayerEventCallback* callback : m_event_listeners )
+        callback->notify( &trackEvent );
+
+    m_track_event.SetEvent();
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::sendPlaylistEvent( PlayerEvent event, sp_playlist *playlist ) {
+/* Playlist notification appear to be really broken - just ignore these for now
+    sp_link* link = sp_link_create_from_playlist( playlist );
+
+    if ( link != NULL ) {
+        CString spotify_link;
+        LPSTR spotify_link_ptr = spotify_link.GetBufferSetLength( 512 );
+        sp_link_as_string ( link, spotify_link_ptr, 512 );
+        sp_link_release( link );
+
+        sendEvent( event, 0L, (LPCSTR)spotify_link );
+    }
+*/
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::stopTrack()
+{
+    sendCommand( CMD_STOP_TRACK );
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::clearTrackQueue( )
+{
+    CSingleLock lock( &m_mutex, TRUE );
+
+    m_track_queue.clear();
+
+    sendTrackQueueEvent();
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::previousTrack()
+{
+    CSingleLock lock( &m_mutex, TRUE );
+
+    if ( m_current_track && getTrackPlayTime() > 10*1000 ) {    // If current track > 10 seconds in, return to start
+        if ( m_track_played_queue.size() )
+            m_track_played_queue.pop_back();
+
+        playTrack( m_current_track_link, 0L ); 
+    }
+    else if ( m_track_played_queue.size() ) {
+        if ( m_current_track ) {                                // Skip over currently playing track (re-queue it)
+            TrackQueueEntry track = m_track_played_queue.back();
+            m_track_played_queue.pop_back();
+            m_track_queue.push_front( track );
+        }
+
+        if ( m_track_played_queue.size() ) {
+            TrackQueueEntry track = m_track_played_queue.back();
+            m_track_played_queue.pop_back();
+            playTrack( track.m_track_link, 0L ); 
+        }
+        else {                                                  // Current track was the only track in the played queue
+            stopTrack();
+
+            sendTrackQueueEvent();
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::playTrack( LPCSTR track_link, DWORD seek_ms )
+{
+    CSingleLock lock( &m_mutex, TRUE );
+
+    // See if this track is already in the played list - and move to that position
+    TrackQueue::iterator it_position;
+    for ( it_position=m_track_played_queue.begin(); it_position != m_track_played_queue.end() && (*it_position).m_track_link != track_link; )
+        it_position++;
+
+    if ( it_position != m_track_played_queue.end() ) {
+        (*it_position).m_seek_ms = seek_ms;
+
+        size_t count = std::distance( it_position, m_track_played_queue.end() );
+        while ( count-- > 0 ) {
+            m_track_queue.push_front( m_track_played_queue.back() );
+            m_track_played_queue.pop_back();
+        }
+    }
+    else {
+        // See if this track is already in the queue list - and move to that position
+        TrackQueue::iterator it_position;
+        for ( it_position=m_track_queue.begin(); it_position != m_track_queue.end() && (*it_position).m_track_link != track_link; )
+            it_position++;
+    
+        if ( it_position != m_track_queue.end() ) {
+            (*it_position).m_seek_ms = seek_ms;
+            std::copy( m_track_queue.begin(), it_position, back_inserter(m_track_played_queue) );
+            m_track_queue.erase( m_track_queue.begin(), it_position );
+        }
+        else 
+            m_track_queue.push_front( TrackQueueEntry( track_link, seek_ms ) );
+    
+    }
+
+    sendCommand( CMD_NEXT_TRACK );
+
+    sendTrackQueueEvent();
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::playTracks( TrackLinkList& playlist ) 
+{
+    CSingleLock lock( &m_mutex, TRUE );
+    m_track_queue.clear();
+
+    for ( auto const& track_uri : playlist )
+        m_track_queue.push_back( TrackQueueEntry( track_uri, 0L ) );
+
+    sendCommand( CMD_NEXT_TRACK );
+
+    sendTrackQueueEvent();
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::queueTracks( TrackLinkList& playlist ) 
+{
+    CSingleLock lock( &m_mutex, TRUE );
+
+    for ( auto const& track_uri : playlist )
+        m_track_queue.push_back( TrackQueueEntry( track_uri, 0L ) );
+
+    sendCommand( CMD_CHECK_PLAYING );
+
+    sendTrackQueueEvent();
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::nextTrack()
+{
+    sendCommand( CMD_NEXT_TRACK );
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::queueTrack( LPCSTR track_link )
+{
+    CSingleLock lock( &m_mutex, TRUE );
+    m_track_queue.push_back( TrackQueueEntry( track_link, 0L ) );
+
+    sendCommand( CMD_CHECK_PLAYING );
+
+    sendTrackQueueEvent();
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::pauseTrack( bool pause )
+{
+    sendCommand( ( pause ) ? CMD_PAUSE_TRACK : CMD_RESUME_TRACK );
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::removeTrackAnalyzer() {
+    if ( isAnalyzing() ) {
+        m_analysis_worker.setAnalyzer( NULL, false );
+
+        delete m_analyzer;
+        m_analyzer = NULL;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// ENGINE DISPATCHER AND HELPER METHODS
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+//
+UINT SpotifyEngine::run()
+{
+    log_status( "Spotify engine started" );
+    
+    int next_timeout = 0;
+    ULONG wait_time = 0L;
+
+    while ( isRunning() ) {
+        try {
+            while ( ::WaitForSingleObject( m_spotify_notify, 100 ) != WAIT_OBJECT_0 ) {
+                _mergeFinishedAnalysis();
+
+                if ( m_current_track != NULL ) {
+                    switch ( m_track_state ) {
+                        case TRACK_STREAM_COMPLETE:
+                            sp_session_player_unload( m_spotify_session );
+                            m_track_state = TRACK_PLAYING;
+                            break;
+
+                        case TRACK_PLAYING:
+                            if ( m_audio_out->getCachedSamples() == 0 ) {
+                                _processTrackAnalysis();
+
+                                m_track_state = TRACK_ENDED;
+                                m_current_track = NULL;
+                                wait_time = 0;
+
+                                m_track_timer.stop();
+
+                                _startTrack();
+                            }
+                            break;
+                    }
+                }
+
+                if ( GetCurrentTime() > wait_time )
+                    break;
+            }
+
+            // Handle any pending user command
+            switch ( m_spotify_command ) {
+                case CMD_STOP_TRACK:
+                    _stopTrack();                
+                    break;
+
+                case CMD_NEXT_TRACK:
+                    _stopTrack();
+                    _startTrack();
+                    break;
+
+                case CMD_PAUSE_TRACK:
+                    _pause();
+                    break;
+
+                case CMD_RESUME_TRACK:
+                    _resume();
+                    break;
+
+                case CMD_CHECK_PLAYING:
+                    if ( m_current_track == NULL )
+                        _startTrack();
+                    break;
+            }
+
+            m_spotify_command = CMD_NONE;
+
+            // Dispatch Spotify messages
+            do {
+                sp_session_process_events( m_spotify_session, &next_timeout );
+            } while (next_timeout == 0);
+
+            if ( next_timeout != 0 )
+                wait_time = next_timeout + GetCurrentTime();
+            else
+                wait_time = 0;
+        }
+        catch ( std::exception& ex ) {
+            log( ex );
+            m_spotify_error = ex.what();
+        }
+    }
+
+    log_status( "Spotify engine stopped" );
+
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::_stopTrack( )
+{
+    if ( m_current_track != NULL ) {
+        sp_session_player_unload( m_spotify_session );
+
+        // Keep what was analyzed before the delivered audio is thrown away
+        _processTrackAnalysis();
+
+        m_analysis_worker.discardBacklog();
+        m_audio_out->cancel();
+
+        m_current_track = NULL;
+        m_current_track_link.Empty();
+        m_track_state = TRACK_ENDED;
+        m_track_length_ms = m_track_seek_ms = 0L;
+
+        m_track_timer.stop( );
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::_startTrack( )
+{
+	CSingleLock lock( &m_mutex, TRUE );
+
+	sp_error result;
+
+    while ( m_track_queue.size() ) {
+        TrackQueueEntry entry = m_track_queue.front();
+        m_track_queue.pop_front();
+		m_track_played_queue.push_back( entry );
+
+		// Get the libspotify track
+		m_current_track = linkToTrack( entry.m_track_link );
+		if ( m_current_track == NULL ) {
+			StudioException ex( "Invalid Spotify track link from '%s'", m_current_track_link );
+			log( ex );
+			m_spotify_error = ex.what();
+			continue;
+		}
+
+		m_current_track_link = entry.m_track_link;
+
+		if ( (result = sp_session_player_load( m_spotify_session, m_current_track )) != SP_ERROR_OK ) {
+			bool loaded = sp_track_is_loaded( m_current_track );
+
+			StudioException ex( "Error %d from sp_session_player_load (loaded=%d)", (INT)result, loaded );
+			log( ex );
+			m_spotify_error = ex.what();
+			_stopTrack( );
+			continue;
+        }
+
+        m_track_state = TRACK_STREAM_PENDING;
+        m_track_length_ms = sp_track_duration( m_current_track );
+        m_track_seek_ms = entry.m_seek_ms > m_track_length_ms ? 0 : entry.m_seek_ms;
+
+        if ( m_track_seek_ms != 0L )
+            sp_session_player_seek( m_spotify_session, m_track_seek_ms );
+
+        // Every play is analyzed for the live stream and merged into the saved analysis 
+        // until it covers the whole track
+        m_save_analysis = !isTrackAnalysisComplete( m_current_track_link );
+
+        removeTrackAnalyzer();
+        m_analysis_stream.startTrack();
+
+        m_analyzer = TrackAnalyzer::create( &m_waveFormat, m_track_length_ms, m_current_track_link, m_track_seek_ms );
+        m_analyzer->setLiveStream( &m_analysis_stream );
+
+        // The worker loads complete analysis's beats for the timer
+        m_analysis_worker.setAnalyzer( m_analyzer, !m_save_analysis );
+
+        if ( !isTrackPaused() ) {
+            result = sp_session_player_play( m_spotify_session, true );
+            if ( result != SP_ERROR_OK ) {
+				StudioException ex( "Error %d from sp_session_player_play", (INT)result );
+				log( ex );
+				m_spotify_error = ex.what();
+				_stopTrack( );
+				continue;
+            }
+        }
+
+        sendTrackQueueEvent();
+
+		break;
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::_resume( )
+{
+    if ( isTrackPaused() ) {
+        sp_session_player_play( m_spotify_session, true );
+
+        if ( m_audio_out->isPaused() )
+            m_audio_out->setPaused( false );
+        if ( m_monitor_out && m_monitor_out->isPaused() )
+            m_monitor_out->setPaused( false );
+
+        m_track_timer.resume();
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::_pause( )
+{
+    if ( !isTrackPaused() ) {
+        m_audio_out->setPaused( true );
+        if ( m_monitor_out )
+            m_monitor_out->setPaused( true );
+        sp_session_player_play( m_spotify_session, false );
+
+        m_track_timer.pause();
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Analysis normally finishes with playback (it is well ahead of render).  The worker
+// analyzes whatever it is behind by and finishes the analyzer so the engine thread never
+// waits for it; _mergeFinishedAnalysis() saves it.
+//
+void SpotifyEngine::_processTrackAnalysis() 
+{
+    if ( isAnalyzing() && m_save_analysis ) {
+        m_analysis_worker.finishTrack();
+        m_analyzer = NULL;                              // The worker owns it now
+    }
+
+    removeTrackAnalyzer();
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::_mergeFinishedAnalysis() 
+{
+    TrackAnalyzer* analyzer;
+
+    while ( (analyzer = m_analysis_worker.takeFinished()) != NULL ) {
+        try {
+            mergeTrackAnalysis( analyzer );
+        }
+        catch ( std::exception& ex ) {
+            log( ex );
+        }
+
+        delete analyzer;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// CREDENTIALS PERSISTANCE METHODS
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+//
+bool SpotifyEngine::_readCredentials( CString& username, CString& credentials )
+{
+    CString filename;
+    filename.Format( "%s\\DMXStudio\\%s", getUserDocumentDirectory(), SPOTIFY_CREDENTIALS_FILE );
+
+    username.Empty();
+    credentials.Empty();
+
+    if ( GetFileAttributes( filename ) == INVALID_FILE_ATTRIBUTES )
+        return false;
+
+    FILE* hFile = _fsopen( filename, "rt", _SH_DENYWR );
+    if ( hFile == NULL )
+        return false;
+
+    LPSTR lpUsername = username.GetBufferSetLength( 256 );
+    LPSTR lpCredentials = credentials.GetBufferSetLength( 2048 );
+
+    size_t read = fscanf_s( hFile, "%s %s", lpUsername, 256, lpCredentials, 256 );
+
+    username.ReleaseBuffer();
+    credentials.ReleaseBuffer();
+    fclose( hFile );
+
+    return read == 2;
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::_writeCredentials( LPCSTR username, LPCSTR credentials )
+{
+    CString filename;
+    filename.Format( "%s\\DMXStudio\\%s", getUserDocumentDirectory(), SPOTIFY_CREDENTIALS_FILE );
+
+    FILE* hFile = _fsopen( filename, "wt", _SH_DENYWR );
+    fprintf( hFile, "%s %s", username, credentials );
+    fclose( hFile );
+}
+
+// ----------------------------------------------------------------------------
+// TRACK ANALYSIS PERSISTANCE METHODS
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+// Takes effect immediately if the stream is open (the render thread swaps filters)
+//
+void SpotifyEngine::setResamplerQuality( ResamplerQuality quality )
+{
+    m_resampler_quality = quality;
+
+    if ( m_audio_out )
+        m_audio_out->setResamplerQuality( quality );
+    if ( m_monitor_out )
+        m_monitor_out->setResamplerQuality( quality );
+}
+
+// ----------------------------------------------------------------------------
+//
+bool SpotifyEngine::getAudioStats( AudioStatsInfo* audio_stats, bool reset )
+{
+    if ( m_audio_out == NULL )
+        return false;
+
+    m_audio_out->getStats().getInfo( audio_stats );
+
+    if ( m_monitor_out )
+        audio_stats->monitor_dropped_frames = m_monitor_out->getDroppedFrames();
+
+    audio_stats->analysis_dropped_frames = m_analysis_worker.getDroppedFrames();
+    audio_stats->analysis_degraded_frames = m_analysis_worker.getDegradedFrames();
+
+    if ( reset )
+        m_audio_out->getStats().reset();
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Pins the track's analysis (see releaseTrackAnalysis)
+//
+AnalyzeInfo* SpotifyEngine::getTrackAnalysis( LPCSTR track_link )
+{
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    AnalyzeInfo* info = loadTrackAnalysis( track_link );
+    if ( info != NULL )
+        pinTrackAnalysis( track_link );
+
+    return info;
+}
+
+// ----------------------------------------------------------------------------
+// Analysis saved before band levels were added has none
+//
+BandAnalyzeInfo* SpotifyEngine::getTrackBandAnalysis( LPCSTR track_link )
+{
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    if ( loadTrackAnalysis( track_link ) == NULL )
+        return NULL;
+
+    TrackBandAnalysisCache::iterator it = m_track_band_cache.find( track_link );
+    if ( it == m_track_band_cache.end() )
+        return NULL;
+
+    pinTrackAnalysis( track_link );
+
+    return it->second;
+}
+
+// ----------------------------------------------------------------------------
+// Analysis saved before beat tracking was added has none
+//
+BeatAnalyzeInfo* SpotifyEngine::getTrackBeatAnalysis( LPCSTR track_link )
+{
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    if ( loadTrackAnalysis( track_link ) == NULL )
+        return NULL;
+
+    TrackBeatAnalysisCache::iterator it = m_track_beat_cache.find( track_link );
+    if ( it == m_track_beat_cache.end() )
+        return NULL;
+
+    pinTrackAnalysis( track_link );
+
+    return it->second;
+}
+
+// ----------------------------------------------------------------------------
+// Analysis saved before loudness was measured has none
+//
+LoudnessAnalyzeInfo* SpotifyEngine::getTrackLoudnessAnalysis( LPCSTR track_link )
+{
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    if ( loadTrackAnalysis( track_link ) == NULL )
+        return NULL;
+
+    TrackLoudnessCache::iterator it = m_track_loudness_cache.find( track_link );
+    if ( it == m_track_loudness_cache.end() )
+        return NULL;
+
+    pinTrackAnalysis( track_link );
+
+    return it->second;
+}
+
+// ----------------------------------------------------------------------------
+// The caller no longer uses one getter result for the track.  Once every result is 
+// released, replaced analysis for it is freed and the cached analysis may be evicted again.
+// The first release switches pins from ANALYSIS_PIN_MS to lasting until released.
+//
+void SpotifyEngine::releaseTrackAnalysis( LPCSTR track_link )
+{
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    m_analysis_released = true;
+
+    TrackPinMap::iterator it = m_track_pins.find( track_link );
+    if ( it == m_track_pins.end() || --it->second.m_count > 0 )
+        return;
+
+    m_track_pins.erase( it );
+
+    freeRetiredTrackAnalysis( track_link );
+
+    trimTrackAnalysisCache();
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::pinTrackAnalysis( LPCSTR spotify_id )
+{
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    TrackPin& pin = m_track_pins[spotify_id];
+    pin.m_count++;
+    pin.m_pin_ms = GetTickCount();
+}
+
+// ----------------------------------------------------------------------------
+// Callers that never release analysis (hosts older than ReleaseTrackAnalysis) would pin 
+// every track they fetch for good, so their pins lapse ANALYSIS_PIN_MS after the last fetch
+//
+bool SpotifyEngine::isTrackAnalysisPinned( LPCSTR spotify_id )
+{
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    TrackPinMap::iterator it = m_track_pins.find( spotify_id );
+    if ( it == m_track_pins.end() )
+        return false;
+
+    return m_analysis_released || GetTickCount() - it->second.m_pin_ms < ANALYSIS_PIN_MS;
+}
+
+// ----------------------------------------------------------------------------
+// Frames are only released once the device has played to them.  The timer's track position
+// runs from the first delivery and is ahead of the device by the buffered audio.
+//
+UINT SpotifyEngine::readAnalysisStream( int stream, AnalysisFrame* frames, UINT max_frames )
+{
+    if ( !m_track_timer.isTracking() )
+        return 0;
+
+    return m_analysis_stream.read( stream, frames, max_frames, m_track_timer.getRenderPosition() );
+}
+
+// ----------------------------------------------------------------------------
+// Analysis saved before the amplitude pyramid was added has none
+//
+bool SpotifyEngine::getTrackAmplitudeRange( LPCSTR track_link, DWORD start_ms, DWORD end_ms, UINT points, AmplitudeLevel* levels )
+{
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    if ( loadTrackAnalysis( track_link ) == NULL )
+        return false;
+
+    TrackPyramidCache::iterator it = m_track_pyramid_cache.find( track_link );
+    if ( it == m_track_pyramid_cache.end() )
+        return false;
+
+    it->second->getRange( start_ms, end_ms, points, levels );
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+//
+bool SpotifyEngine::getTrackAnalysisCoverage( LPCSTR track_link, AnalysisSegment* segments, UINT max_segments, UINT* num_segments, bool* complete )
+{
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    *num_segments = 0;
+    *complete = false;
+
+    if ( loadTrackAnalysis( track_link ) == NULL )
+        return false;
+
+    TrackCoverageCache::iterator it = m_track_coverage_cache.find( track_link );
+    if ( it == m_track_coverage_cache.end() )
+        return false;
+
+    const AnalysisSegmentArray& coverage = it->second.getSegments();
+
+    for ( size_t i=0; i < coverage.size() && i < max_segments; i++ )
+        segments[i] = coverage[i];
+
+    *num_segments = coverage.size();
+    *complete = it->second.isComplete();
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Analyzes local renders of tracks (see BatchAnalyzer) straight into the analysis cache.
+// Does not need a Spotify connection.
+//
+bool SpotifyEngine::analyzeTrackFiles( LPCSTR manifest_file, UINT* num_analyzed )
+{
+    *num_analyzed = 0;
+
+    BatchAnalyzer batch( m_analysis_pack );
+
+    if ( !batch.loadManifest( manifest_file ) )
+        return false;
+
+    *num_analyzed = batch.analyze();
+
+    // Loaded analysis for these tracks is now stale (the playing track keeps its own
+    // until it is played again).  Eviction keeps pinned analysis so pointers API callers
+    // hold stay valid.
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    for ( const BatchTrack& track : batch.getTracks() )
+        if ( m_current_track_link != track.m_link )
+            evictTrackAnalysis( track.m_link );
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Loaded analysis is unchanged by the import
+//
+UINT SpotifyEngine::migrateTrackAnalysis( void )
+{
+    return m_analysis_pack.importFiles();
+}
+
+// ----------------------------------------------------------------------------
+// Adds newly loaded or saved analysis (replacing any cached for the track) as the most 
+// recently used and trims the cache back to its budget
+//
+void SpotifyEngine::cacheTrackAnalysis( const TrackAnalysisData& analysis )
+{
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    LPCSTR link = analysis.m_info->link;
+
+    evictTrackAnalysis( link );
+
+    m_track_analysis_cache[link] = analysis.m_info;
+
+    if ( analysis.m_bands )
+        m_track_band_cache[link] = analysis.m_bands;
+    if ( analysis.m_beats )
+        m_track_beat_cache[link] = analysis.m_beats;
+    if ( analysis.m_pyramid )
+        m_track_pyramid_cache[link] = analysis.m_pyramid;
+    if ( analysis.m_loudness )
+        m_track_loudness_cache[link] = analysis.m_loudness;
+
+    m_track_coverage_cache[link] = analysis.m_coverage;
+
+    m_track_analysis_lru.push_front( link );
+
+    TrackCacheUsage& usage = m_track_cache_usage[link];
+    usage.m_lru = m_track_analysis_lru.begin();
+    usage.m_bytes = getTrackAnalysisBytes( analysis );
+
+    m_analysis_cache_bytes += usage.m_bytes;
+
+    trimTrackAnalysisCache();
+}
+
+// ----------------------------------------------------------------------------
+// Evicts least recently used tracks until the cache fits its budget.  The most recently 
+// used track (the caller's), the playing track and pinned tracks stay.  Retired analysis
+// and pins that have lapsed (see isTrackAnalysisPinned) are dropped first.
+//
+void SpotifyEngine::trimTrackAnalysisCache( )
+{
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    RetiredTrackAnalysisList::iterator retired_it = m_retired_analysis.begin();
+
+    while ( retired_it != m_retired_analysis.end() ) {
+        if ( isTrackAnalysisPinned( retired_it->m_link ) ) {
+            retired_it++;
+            continue;
+        }
+
+        freeTrackAnalysisData( retired_it->m_analysis );
+        retired_it = m_retired_analysis.erase( retired_it );
+    }
+
+    TrackPinMap::iterator pin_it = m_track_pins.begin();
+
+    while ( pin_it != m_track_pins.end() ) {
+        if ( isTrackAnalysisPinned( pin_it->first ) )
+            pin_it++;
+        else
+            pin_it = m_track_pins.erase( pin_it );
+    }
+
+    if ( m_analysis_cache_budget == 0 || m_track_analysis_lru.size() < 2 )
+        return;
+
+    TrackAnalysisLru::iterator it = m_track_analysis_lru.end();
+
+    while ( m_analysis_cache_bytes > m_analysis_cache_budget && --it != m_track_analysis_lru.begin() ) {
+        if ( *it == m_current_track_link || isTrackAnalysisPinned( *it ) )
+            continue;
+
+        CString victim = *it++;            // Eviction removes it from the LRU
+
+        evictTrackAnalysis( victim );
+
+        m_analysis_cache_stats.evictions++;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Pinned analysis is retired rather than freed; pointers handed out for it stay valid 
+// until the track is no longer pinned
+//
+void SpotifyEngine::evictTrackAnalysis( LPCSTR spotify_id )
+{
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    TrackAnalysisCache::iterator it = m_track_analysis_cache.find( spotify_id );
+    if ( it == m_track_analysis_cache.end() )
+        return;
+
+    RetiredTrackAnalysis retired;
+    retired.m_link = spotify_id;
+    retired.m_analysis.m_info = it->second;
+    retired.m_bytes = 0;
+
+    m_track_analysis_cache.erase( it );
+
+    TrackBandAnalysisCache::iterator band_it = m_track_band_cache.find( spotify_id );
+    if ( band_it != m_track_band_cache.end() ) {
+        retired.m_analysis.m_bands = band_it->second;
+        m_track_band_cache.erase( band_it );
+    }
+
+    TrackBeatAnalysisCache::iterator beat_it = m_track_beat_cache.find( spotify_id );
+    if ( beat_it != m_track_beat_cache.end() ) {
+        retired.m_analysis.m_beats = beat_it->second;
+        m_track_beat_cache.erase( beat_it );
+    }
+
+    TrackPyramidCache::iterator pyramid_it = m_track_pyramid_cache.find( spotify_id );
+    if ( pyramid_it != m_track_pyramid_cache.end() ) {
+        retired.m_analysis.m_pyramid = pyramid_it->second;
+        m_track_pyramid_cache.erase( pyramid_it );
+    }
+
+    TrackLoudnessCache::iterator loudness_it = m_track_loudness_cache.find( spotify_id );
+    if ( loudness_it != m_track_loudness_cache.end() ) {
+        retired.m_analysis.m_loudness = loudness_it->second;
+        m_track_loudness_cache.erase( loudness_it );
+    }
+
+    m_track_coverage_cache.erase( spotify_id );
+
+    TrackCacheUsageMap::iterator usage_it = m_track_cache_usage.find( spotify_id );
+    if ( usage_it != m_track_cache_usage.end() ) {
+        retired.m_bytes = usage_it->second.m_bytes;
+        m_analysis_cache_bytes -= usage_it->second.m_bytes;
+        m_track_analysis_lru.erase( usage_it->second.m_lru );
+        m_track_cache_usage.erase( usage_it );
+    }
+
+    if ( isTrackAnalysisPinned( spotify_id ) )
+        m_retired_analysis.push_back( retired );
+    else
+        freeTrackAnalysisData( retired.m_analysis );
+}
+
+// ----------------------------------------------------------------------------
+// Frees the retired analysis of one track (NULL for every track)
+//
+void SpotifyEngine::freeRetiredTrackAnalysis( LPCSTR spotify_id )
+{
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    RetiredTrackAnalysisList::iterator it = m_retired_analysis.begin();
+
+    while ( it != m_retired_analysis.end() ) {
+        if ( spotify_id != NULL && it->m_link != spotify_id ) {
+            it++;
+            continue;
+        }
+
+        freeTrackAnalysisData( it->m_analysis );
+        it = m_retired_analysis.erase( it );
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Everything goes, including analysis callers may still hold
+//
+void SpotifyEngine::freeTrackAnalysisCache( )
+{
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    while ( m_track_analysis_cache.size() )
+        evictTrackAnalysis( CString( m_track_analysis_cache.begin()->first ) );
+
+    freeRetiredTrackAnalysis( NULL );
+
+    m_track_pins.clear();
+}
+
+// ----------------------------------------------------------------------------
+// Evicts down to the new budget immediately
+//
+void SpotifyEngine::setAnalysisCacheBudget( size_t budget_bytes )
+{
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    m_analysis_cache_budget = budget_bytes;
+
+    trimTrackAnalysisCache();
+}
+
+// ----------------------------------------------------------------------------
+//
+void SpotifyEngine::getAnalysisCacheStats( AnalysisCacheStatsInfo* cache_stats, bool reset )
+{
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    *cache_stats = m_analysis_cache_stats;
+
+    cache_stats->tracks = (ULONG)m_track_analysis_cache.size();
+    cache_stats->bytes = m_analysis_cache_bytes;
+    cache_stats->retired_bytes = 0;
+    cache_stats->budget_bytes = m_analysis_cache_budget;
+
+    for ( const RetiredTrackAnalysis& retired : m_retired_analysis )
+        cache_stats->retired_bytes += retired.m_bytes;
+
+    if ( reset )
+        memset( &m_analysis_cache_stats, 0, sizeof(m_analysis_cache_stats) );
+}
+
+// ----------------------------------------------------------------------------
+//
+bool SpotifyEngine::haveTrackAnalysis( LPCSTR spotify_link ) {
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    if ( m_track_analysis_cache.find( spotify_link ) != m_track_analysis_cache.end() )
+        return true;
+
+    // A loose file was saved before the pack and is not imported yet
+    return m_analysis_pack.contains( spotify_link ) || m_analysis_pack.hasLooseFile( spotify_link );
+}
+
+// ----------------------------------------------------------------------------
+//
+bool SpotifyEngine::isTrackAnalysisComplete( LPCSTR spotify_link ) {
+    // Called as a track starts - the pack answers from its index without reading the 
+    // analysis (a loose file not imported yet counts as incomplete)
+    return m_analysis_pack.isComplete( spotify_link );
+}
+
+// ----------------------------------------------------------------------------
+// Copies the saved beats for the track timer.  Called on the analysis worker as the
+// track starts since it may load the analysis.  Nothing is pinned; the copy is the caller's.
+//
+bool SpotifyEngine::getSavedBeats( LPCSTR track_link, BeatArray& beats )
+{
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    if ( loadTrackAnalysis( track_link ) == NULL )
+        return false;
+
+    TrackBeatAnalysisCache::iterator it = m_track_beat_cache.find( track_link );
+    if ( it == m_track_beat_cache.end() )
+        return false;
+
+    beats.assign( it->second->beats, it->second->beats + it->second->beat_count );
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Folds the analyzer's segment into the saved analysis for the track.  Saved data is kept
+// wherever the new segment does not cover it.
+//
+bool SpotifyEngine::mergeTrackAnalysis( TrackAnalyzer* analyzer )
+{
+    TrackCoverage coverage = analyzer->getCoverage();
+
+    if ( coverage.getCoveredMs() < MIN_ANALYSIS_SEGMENT_MS )
+        return false;
+
+    AnalyzeInfo* info = analyzer->captureAnalyzerData();
+    BandAnalyzeInfo* bands = analyzer->captureBandData();
+    BeatAnalyzeInfo* beats = analyzer->captureBeatData();
+    AmplitudePyramid* pyramid = analyzer->capturePyramid();
+    LoudnessAnalyzeInfo* loudness = analyzer->captureLoudnessData();
+
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    AnalyzeInfo* saved_info = loadTrackAnalysis( analyzer->getLink() );
+
+    if ( saved_info != NULL ) {
+        TrackCoverage saved_coverage = m_track_coverage_cache[ analyzer->getLink() ];
+
+        for ( size_t i=0; i < info->data_count && i < saved_info->data_count; i++ )
+            if ( !coverage.coversBlock( i * info->duration_ms, (i+1) * info->duration_ms ) )
+                info->data[i] = saved_info->data[i];
+
+        // Found in the cache directly; the getters would pin the analysis being replaced
+        TrackLoudnessCache::iterator loudness_it = m_track_loudness_cache.find( analyzer->getLink() );
+
+        if ( loudness_it != m_track_loudness_cache.end() ) {
+            const LoudnessAnalyzeInfo* saved_loudness = loudness_it->second;
+
+            for ( size_t i=0; i < loudness->data_count && i < saved_loudness->data_count; i++ )
+                if ( !coverage.coversBlock( i * loudness->duration_ms, (i+1) * loudness->duration_ms ) )
+                    loudness->data[i] = saved_loudness->data[i];
+
+            // Like the tempo, integrated loudness comes from whichever heard more of the track
+            if ( coverage.getCoveredMs() < saved_coverage.getCoveredMs() )
+                loudness->integrated_lufs = saved_loudness->integrated_lufs;
+        }
+
+        TrackBandAnalysisCache::iterator band_it = m_track_band_cache.find( analyzer->getLink() );
+
+        if ( band_it != m_track_band_cache.end() ) {
+            const BandAnalyzeInfo* saved_bands = band_it->second;
+
+            size_t count = min( bands->data_count, saved_bands->data_count );
+
+            for ( size_t i=0; i < count; i++ ) {
+                if ( coverage.coversBlock( i * bands->duration_ms, (i+1) * bands->duration_ms ) )
+                    continue;
+
+                for ( UINT band=0; band < ANALYZE_BANDS; band++ )
+                    bands->data[ band * bands->data_count + i ] = saved_bands->data[ band * saved_bands->data_count + i ];
+            }
+        }
+
+        TrackPyramidCache::iterator pyramid_it = m_track_pyramid_cache.find( analyzer->getLink() );
+
+        if ( pyramid_it != m_track_pyramid_cache.end() ) {
+            const AmplitudeLevelArray& saved_base = pyramid_it->second->getBase();
+            AmplitudeLevelArray base( pyramid->getBase() );
+
+            if ( base.size() < saved_base.size() )
+                base.resize( saved_base.size() );
+
+            for ( size_t i=0; i < saved_base.size(); i++ )
+                if ( !coverage.coversBlock( (DWORD)i * AMPLITUDE_BASE_MS, (DWORD)(i+1) * AMPLITUDE_BASE_MS ) )
+                    base[i] = saved_base[i];
+
+            pyramid->setBase( base.size() ? &base[0] : NULL, base.size() );
+        }
+
+        TrackBeatAnalysisCache::iterator beat_it = m_track_beat_cache.find( analyzer->getLink() );
+
+        if ( beat_it != m_track_beat_cache.end() ) {
+            const BeatAnalyzeInfo* saved_beats = beat_it->second;
+
+            BeatArray merged( beats->beats, &beats->beats[beats->beat_count] );
+
+            for ( size_t i=0; i < saved_beats->beat_count; i++ )
+                if ( !coverage.covers( saved_beats->beats[i].time_ms, saved_beats->beats[i].time_ms ) )
+                    merged.push_back( saved_beats->beats[i] );
+
+            std::sort( merged.begin(), merged.end(), 
+                []( const BeatInfo& a, const BeatInfo& b ) { return a.time_ms < b.time_ms; } );
+
+            // The tempo comes from whichever heard more of the track
+            float tempo = ( coverage.getCoveredMs() >= saved_coverage.getCoveredMs() ) ? beats->tempo : saved_beats->tempo;
+
+            free( beats );
+
+            beats = (BeatAnalyzeInfo*)calloc( sizeof(BeatAnalyzeInfo) + (sizeof(BeatInfo) * merged.size()), 1 );
+
+            strncpy_s( beats->link, analyzer->getLink(), sizeof(beats->link) );
+            beats->tempo = tempo;
+            beats->beat_count = merged.size();
+
+            if ( merged.size() > 0 )
+                memcpy( beats->beats, &merged[0], sizeof(BeatInfo) * merged.size() );
+        }
+
+        coverage.add( saved_coverage );
+    }
+
+    log_status( "Track '%s' analysis covers %lu of %lu ms", analyzer->getLink(), coverage.getCoveredMs(), coverage.getLength() );
+
+    TrackAnalysisData analysis;
+    analysis.m_info = info;
+    analysis.m_bands = bands;
+    analysis.m_beats = beats;
+    analysis.m_pyramid = pyramid;
+    analysis.m_loudness = loudness;
+    analysis.m_coverage = coverage;
+
+    return saveTrackAnalysis( analysis );
+}
+
+// ----------------------------------------------------------------------------
+// Called as a track ends, so the pack worker does the disk write and the next track 
+// starts without waiting for it.  The lock keeps the queued write and the cache in step
+// with an API thread loading the track.
+//
+bool SpotifyEngine::saveTrackAnalysis( const TrackAnalysisData& analysis )
+{
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    if ( !m_analysis_pack.queueWrite( analysis ) )
+        return false;
+
+    cacheTrackAnalysis( analysis );
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+//
+AnalyzeInfo* SpotifyEngine::loadTrackAnalysis( LPCSTR spotify_id )
+{
+    CSingleLock lock( &m_analysis_cache_lock, TRUE );
+
+    TrackAnalysisCache::iterator it = m_track_analysis_cache.find( spotify_id );
+    if ( it != m_track_analysis_cache.end() ) {
+        TrackCacheUsage& usage = m_track_cache_usage[it->first];
+        m_track_analysis_lru.splice( m_track_analysis_lru.begin(), m_track_analysis_lru, usage.m_lru );
+
+        m_analysis_cache_stats.hits++;
+
+        return (it)->second;
+    }
+
+    m_analysis_cache_stats.misses++;
+
+    // See if it is saved - if available, load into the cache and return
+    TrackAnalysisData analysis;
+
+    if ( !m_analysis_pack.read( spotify_id, analysis ) ) {
+        // Saved before the pack and not imported yet
+        if ( !m_analysis_pack.hasLooseFile( spotify_id ) || 
+             !readTrackAnalysisFile( makeTrackAnalysisFileName( m_trackAnalysisContainer, spotify_id ), analysis ) )
+            return NULL;
+    }
+
+    cacheTrackAnalysis( analysis );
+
+    return analysis.m_info;
+}
+
@@ -1,58 +1,58 @@
-/* 
-Copyright (C) 2011,2012 Robert DeSantis
-hopluvr at gmail dot com
-
-This file is part of DMX Studio.
- 
-DMX Studio is free software; you can redistribute it and/or modify
-it under the terms of the GNU General Public License as published by
-the Free Software Foundation; either version 3 of the License, or (at your
-option) any later version.
- 
-DMX Studio is distributed in the hope that it will be useful, but
-WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
-or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
-License for more details.
- 
-You should have received a copy of the GNU General Public License
-along with DMX Studio; see the file _COPYING.txt.  If not, write to
-the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
-MA 02111-1307, USA.
-*/
-
-#pragma once
-
-#include "stdafx.h"
-#include "resource.h"		// main symbols
-#include "SpotifyEngine.h"
-#include "SpotifyWebEngine.h"
-
-class CSpotifyEngineApp : public CWinApp
-{
-public:
-    SpotifyEngine		m_spotify;					// Deprecated libspotify used to play tracks
-	SpotifyWebEngine	m_spotify_web;				// Web API used for catalog and audio info
-
-    FILE*				m_hLog;
-
-    CSpotifyEngineApp();
-    ~CSpotifyEngineApp();
-
-    void openLogFile( );
-    void closeLogFile( );
-
-// Overrides
-public:
-    virtual BOOL InitInstance();
-
-    DECLARE_MESSAGE_MAP()
-};
-
-extern void log( std::exception& ex );
-extern void log( StudioException& ex );
-extern void log( const char *fmt, ... );
-extern void log_status( const char *fmt, ... );
-
-extern CString getUserDocumentDirectory( void );
-
-extern CSpotifyEngineApp theApp;
+/* 
+Copyright (C) 2011,2012 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+ 
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+ 
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+ 
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+#pragma once
+
+#include "stdafx.h"
+#include "resource.h"		// main symbols
+#include "SpotifyEngine.h"
+#include "SpotifyWebEngine.h"
+
+class CSpotifyEngineApp : public CWinApp
+{
+public:
+    SpotifyEngine		m_spotify;					// Deprecated libspotify used to play tracks
+	SpotifyWebEngine	m_spotify_web;				// Web API used for catalog and audio info
+
+    FILE*				m_hLog;
+
+    CSpotifyEngineApp();
+    ~CSpotifyEngineApp();
+
+    void openLogFile( );
+    void closeLogFile( );
+
+// Overrides
+public:
+    virtual BOOL InitInstance();
+
+    DECLARE_MESSAGE_MAP()
+};
+
+extern void log( std::exception& ex );
+extern void log( StudioException& ex );
+extern void log( const char *fmt, ... );
+extern void log_status( const char *fmt, ... );
+
+extern CString getUserDocumentDirectory( void );
+
+extern CSpotifyEngineApp theApp;
@@ -35,6 +35,10 @@ SpotifyWebEngine::SpotifyWebEngine( ) :
 {
 	m_trackInfoContainer.Format( "%s\\DMXStudio\\SpotifyTrackInfoCache", (LPCSTR)getUserDocumentDirectory() );
 	CreateDirectory( m_trackInfoContainer, NULL );
+
+	CString pattern;
+	pattern.Format( "%s\\*.info", (LPCSTR)m_trackInfoContainer );
+	m_track_info_files.scan( pattern );
 }
 
 // ----------------------------------------------------------------------------
@@ -959,6 +963,8 @@ bool SpotifyWebEngine::saveAudioInfo( AudioInfo& audio_info )
 		return false;
 	}
 
+	m_track_info_files.add( filename );
+
 	return true;
 }
 
@@ -977,7 +983,7 @@ AudioInfo* SpotifyWebEngine::loadAudioInfo( LPCSTR spotify_link )
 	// See if it existing on disk - if available, load into the cache and return
 	CString filename = makeTrackInfoFileName( m_trackInfoContainer, spotify_link );
 
-	if ( GetFileAttributes( filename ) == INVALID_FILE_ATTRIBUTES )
+	if ( !m_track_info_files.contains( filename ) )
 		return NULL;
 
 	FILE* hFile = _fsopen( filename, "rt", _SH_DENYWR );
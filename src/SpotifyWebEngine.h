@@ -23,6 +23,7 @@ MA 02111-1307, USA.
 #pragma once
 
 #include "stdafx.h"
+#include "CacheFileIndex.h"
 
 // Special ID for tracks without information
 #define UNAVAILABLE_ID  "UNAVAILABLE_ID"
@@ -210,6 +211,7 @@ class SpotifyWebEngine : public Threadable
 	TrackMap				m_track_cache;
 
 	CString                 m_trackInfoContainer;
+	CacheFileIndex          m_track_info_files;                 // Track info saved in m_trackInfoContainer
 
 	AudioTrackInfoCache     m_track_audio_info_cache;           // Caches track audio info to avoid http lookups
 	CCriticalSection        m_track_cache_mutex;				// Protect track cache
@@ -0,0 +1,641 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+#include "stdafx.h"
+#include "TrackAnalysisFile.h"
+#include "SimpleJsonParser.h"
+#include "MappedFile.h"
+
+// ----------------------------------------------------------------------------
+//
+static const char* bandNames[ANALYZE_BANDS] = { "bass", "mid", "treble" };
+
+// ----------------------------------------------------------------------------
+//
+CString makeTrackAnalysisFileName( LPCSTR directory, LPCSTR spotify_id )
+{
+    CString safe_id( spotify_id );
+    safe_id.Replace( ':', '_' );
+    safe_id.Replace( '/', '_' );
+    safe_id.Replace( '\\', '_' );
+
+    CString filename;
+    filename.Format( "%s\\%s.analyze", directory, (LPCSTR)safe_id );
+
+    return filename;
+}
+
+// ----------------------------------------------------------------------------
+// BINARY FILE FORMAT
+//
+// A fixed header followed by the raw arrays, each starting on an 8 byte boundary.  Entries
+// have the same layout as the API structures so a mapped file is copied, not parsed.  All
+// values are little-endian (as stored by x86/x64).  The checksum is a CRC-32 of the whole
+// file with the checksum field zeroed.
+// ----------------------------------------------------------------------------
+
+#define ANALYSIS_FILE_MAGIC     "DMXA"
+#define ANALYSIS_FILE_VERSION   1
+#define ANALYSIS_FILE_ALIGN     8
+
+typedef enum {
+    SECTION_COVERAGE = 0,                       // AnalysisSegment
+    SECTION_AMPLITUDE,                          // uint16_t
+    SECTION_BANDS,                              // uint16_t, count per band (band-major)
+    SECTION_BEATS,                              // BeatInfo
+    SECTION_PYRAMID,                            // AmplitudeLevel (the base only)
+    SECTION_LOUDNESS,                           // LoudnessLevel
+    ANALYSIS_SECTIONS
+} AnalysisSectionId;
+
+struct AnalysisFileSection {
+    uint32_t    offset;                         // From the start of the file (0 if the part is missing)
+    uint32_t    count;                          // Entries (per band for bands)
+    uint32_t    entry_size;                     // Bytes per entry
+    uint32_t    duration_ms;                    // Per entry for time series
+};
+
+struct AnalysisFileHeader {
+    char        magic[4];
+    uint16_t    version;
+    uint16_t    header_size;
+    uint32_t    file_size;
+    uint32_t    checksum;
+    char        link[256];
+    uint32_t    length_ms;                      // Track length (for coverage)
+    uint32_t    band_hz[ANALYZE_BANDS+1];
+    float       tempo;
+    float       integrated_lufs;
+    AnalysisFileSection sections[ANALYSIS_SECTIONS];
+};
+
+static_assert( sizeof(AnalysisSegment) == 8 && sizeof(BeatInfo) == 8 && sizeof(AmplitudeLevel) == 6 && sizeof(LoudnessLevel) == 8,
+               "Analysis file entries must match the API structures" );
+
+static const size_t SECTION_ENTRY_SIZE[ANALYSIS_SECTIONS] = {
+    sizeof(AnalysisSegment), sizeof(uint16_t), sizeof(uint16_t), sizeof(BeatInfo), sizeof(AmplitudeLevel), sizeof(LoudnessLevel)
+};
+
+static const size_t SECTION_ENTRY_MULTIPLE[ANALYSIS_SECTIONS] = { 1, 1, ANALYZE_BANDS, 1, 1, 1 };
+
+// ----------------------------------------------------------------------------
+// Built once at load so batch writers on several threads can share it
+//
+static struct Crc32Table {
+    uint32_t    entries[256];
+
+    Crc32Table() {
+        for ( uint32_t i=0; i < 256; i++ ) {
+            uint32_t value = i;
+            for ( int bit=0; bit < 8; bit++ )
+                value = (value & 1) ? (0xEDB88320 ^ (value >> 1)) : (value >> 1);
+            entries[i] = value;
+        }
+    }
+} crcTable;
+
+// ----------------------------------------------------------------------------
+//
+static uint32_t crc32( uint32_t crc, const BYTE* data, size_t size )
+{
+    crc = ~crc;
+
+    for ( size_t i=0; i < size; i++ )
+        crc = crcTable.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+    return ~crc;
+}
+
+// ----------------------------------------------------------------------------
+//
+static uint32_t fileChecksum( const BYTE* contents, size_t size )
+{
+    AnalysisFileHeader header;
+    memcpy( &header, contents, sizeof(header) );
+    header.checksum = 0;
+
+    uint32_t crc = crc32( 0, (const BYTE*)&header, sizeof(header) );
+
+    return crc32( crc, &contents[sizeof(header)], size - sizeof(header) );
+}
+
+// ----------------------------------------------------------------------------
+//
+static void addSection( std::vector<BYTE>& contents, AnalysisFileSection& section, const void* entries, 
+                        size_t count, size_t entry_size, size_t multiple, UINT duration_ms )
+{
+    contents.resize( (contents.size() + ANALYSIS_FILE_ALIGN - 1) & ~(size_t)(ANALYSIS_FILE_ALIGN - 1) );
+
+    section.offset = (uint32_t)contents.size();
+    section.count = (uint32_t)count;
+    section.entry_size = (uint32_t)entry_size;
+    section.duration_ms = duration_ms;
+
+    size_t bytes = count * entry_size * multiple;
+
+    if ( bytes > 0 ) {
+        contents.resize( contents.size() + bytes );
+        memcpy( &contents[section.offset], entries, bytes );
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+void encodeTrackAnalysis( const TrackAnalysisData& analysis, std::vector<BYTE>& contents )
+{
+    AnalysisFileHeader header;
+    memset( &header, 0, sizeof(header) );
+
+    memcpy( header.magic, ANALYSIS_FILE_MAGIC, sizeof(header.magic) );
+    header.version = ANALYSIS_FILE_VERSION;
+    header.header_size = sizeof(header);
+    strncpy_s( header.link, analysis.m_info->link, sizeof(header.link) );
+    header.length_ms = analysis.m_coverage.getLength();
+    header.integrated_lufs = LOUDNESS_SILENCE_LUFS;
+
+    contents.assign( sizeof(header), 0 );
+
+    const AnalysisSegmentArray& segments = analysis.m_coverage.getSegments();
+
+    addSection( contents, header.sections[SECTION_COVERAGE], segments.size() ? &segments[0] : NULL, 
+                segments.size(), sizeof(AnalysisSegment), 1, 0 );
+
+    addSection( contents, header.sections[SECTION_AMPLITUDE], analysis.m_info->data, 
+                analysis.m_info->data_count, sizeof(uint16_t), 1, analysis.m_info->duration_ms );
+
+    if ( analysis.m_bands ) {
+        memcpy( header.band_hz, analysis.m_bands->band_hz, sizeof(header.band_hz) );
+
+        addSection( contents, header.sections[SECTION_BANDS], analysis.m_bands->data, 
+                    analysis.m_bands->data_count, sizeof(uint16_t), ANALYZE_BANDS, analysis.m_bands->duration_ms );
+    }
+
+    if ( analysis.m_beats ) {
+        header.tempo = analysis.m_beats->tempo;
+
+        addSection( contents, header.sections[SECTION_BEATS], analysis.m_beats->beats, 
+                    analysis.m_beats->beat_count, sizeof(BeatInfo), 1, 0 );
+    }
+
+    if ( analysis.m_pyramid ) {
+        const AmplitudeLevelArray& base = analysis.m_pyramid->getBase();
+
+        addSection( contents, header.sections[SECTION_PYRAMID], base.size() ? &base[0] : NULL, 
+                    base.size(), sizeof(AmplitudeLevel), 1, AMPLITUDE_BASE_MS );
+    }
+
+    if ( analysis.m_loudness ) {
+        header.integrated_lufs = analysis.m_loudness->integrated_lufs;
+
+        addSection( contents, header.sections[SECTION_LOUDNESS], analysis.m_loudness->data, 
+                    analysis.m_loudness->data_count, sizeof(LoudnessLevel), 1, analysis.m_loudness->duration_ms );
+    }
+
+    header.file_size = (uint32_t)contents.size();
+    memcpy( &contents[0], &header, sizeof(header) );
+
+    header.checksum = fileChecksum( &contents[0], contents.size() );
+    memcpy( &contents[0], &header, sizeof(header) );
+}
+
+// ----------------------------------------------------------------------------
+//
+bool isTrackAnalysisBinary( const BYTE* contents, size_t size )
+{
+    return size >= 4 && memcmp( contents, ANALYSIS_FILE_MAGIC, 4 ) == 0;
+}
+
+// ----------------------------------------------------------------------------
+// Track link of binary analysis without decoding it (NULL if not binary)
+//
+LPCSTR getTrackAnalysisLink( const BYTE* contents, size_t size )
+{
+    if ( !isTrackAnalysisBinary( contents, size ) || size < sizeof(AnalysisFileHeader) )
+        return NULL;
+
+    const AnalysisFileHeader* header = reinterpret_cast<const AnalysisFileHeader*>( contents );
+
+    return memchr( header->link, '\0', sizeof(header->link) ) != NULL ? header->link : NULL;
+}
+
+// ----------------------------------------------------------------------------
+// Entries of a present section (NULL if missing)
+//
+static const BYTE* getSection( const BYTE* contents, const AnalysisFileHeader& header, AnalysisSectionId id )
+{
+    const AnalysisFileSection& section = header.sections[id];
+
+    return section.offset != 0 ? &contents[section.offset] : NULL;
+}
+
+// ----------------------------------------------------------------------------
+// Every section must lie within the file and hold entries of the expected size
+//
+static bool checkSections( const AnalysisFileHeader& header )
+{
+    for ( int id=0; id < ANALYSIS_SECTIONS; id++ ) {
+        const AnalysisFileSection& section = header.sections[id];
+
+        if ( section.offset == 0 )
+            continue;
+
+        ULONGLONG end = section.offset + (ULONGLONG)section.count * section.entry_size * SECTION_ENTRY_MULTIPLE[id];
+
+        if ( section.entry_size != SECTION_ENTRY_SIZE[id] || section.offset < sizeof(AnalysisFileHeader) || end > header.file_size )
+            return false;
+    }
+
+    return header.sections[SECTION_AMPLITUDE].offset != 0;
+}
+
+// ----------------------------------------------------------------------------
+// Whether binary analysis covers the whole track with every part, from the header and 
+// coverage alone (the file is not checked or decoded)
+//
+bool isTrackAnalysisFileComplete( const BYTE* contents, size_t size )
+{
+    if ( getTrackAnalysisLink( contents, size ) == NULL )
+        return false;
+
+    const AnalysisFileHeader* header = reinterpret_cast<const AnalysisFileHeader*>( contents );
+
+    if ( header->version != ANALYSIS_FILE_VERSION || header->header_size != sizeof(AnalysisFileHeader) || header->file_size != size || !checkSections( *header ) )
+        return false;
+
+    for ( int id=0; id < ANALYSIS_SECTIONS; id++ )
+        if ( header->sections[id].offset == 0 )
+            return false;
+
+    TrackCoverage coverage( header->length_ms );
+    const AnalysisSegment* segments = (const AnalysisSegment*)getSection( contents, *header, SECTION_COVERAGE );
+
+    for ( uint32_t i=0; i < header->sections[SECTION_COVERAGE].count; i++ )
+        coverage.add( segments[i].start_ms, segments[i].end_ms );
+
+    return coverage.isComplete();
+}
+
+// ----------------------------------------------------------------------------
+//
+static bool decodeTrackAnalysisBinary( const BYTE* contents, size_t size, TrackAnalysisData& analysis )
+{
+    if ( size < sizeof(AnalysisFileHeader) ) {
+        log( "Track analysis is truncated" );
+        return false;
+    }
+
+    AnalysisFileHeader header;
+    memcpy( &header, contents, sizeof(header) );
+
+    header.link[sizeof(header.link)-1] = '\0';
+
+    if ( header.version != ANALYSIS_FILE_VERSION || header.header_size != sizeof(header) ) {
+        log( "Track analysis for %s has unsupported version %d", header.link, (int)header.version );
+        return false;
+    }
+
+    if ( header.file_size != size || !checkSections( header ) || header.checksum != fileChecksum( contents, size ) ) {
+        log( "Track analysis for %s is damaged", header.link );
+        return false;
+    }
+
+    const AnalysisFileSection& amplitude = header.sections[SECTION_AMPLITUDE];
+
+    AnalyzeInfo* info = (AnalyzeInfo*)calloc( sizeof(AnalyzeInfo) + (sizeof(uint16_t) * amplitude.count), 1 );
+
+    strncpy_s( info->link, header.link, sizeof(info->link) );
+    info->duration_ms = amplitude.duration_ms;
+    info->data_count = amplitude.count;
+    memcpy( info->data, getSection( contents, header, SECTION_AMPLITUDE ), sizeof(uint16_t) * amplitude.count );
+
+    analysis.m_info = info;
+
+    if ( header.sections[SECTION_BANDS].offset != 0 ) {
+        const AnalysisFileSection& section = header.sections[SECTION_BANDS];
+
+        BandAnalyzeInfo* bands = (BandAnalyzeInfo*)calloc( sizeof(BandAnalyzeInfo) + (sizeof(uint16_t) * section.count * ANALYZE_BANDS), 1 );
+
+        strncpy_s( bands->link, header.link, sizeof(bands->link) );
+        bands->duration_ms = section.duration_ms;
+        bands->data_count = section.count;
+        memcpy( bands->band_hz, header.band_hz, sizeof(bands->band_hz) );
+        memcpy( bands->data, getSection( contents, header, SECTION_BANDS ), sizeof(uint16_t) * section.count * ANALYZE_BANDS );
+
+        analysis.m_bands = bands;
+    }
+
+    if ( header.sections[SECTION_BEATS].offset != 0 ) {
+        const AnalysisFileSection& section = header.sections[SECTION_BEATS];
+
+        BeatAnalyzeInfo* beats = (BeatAnalyzeInfo*)calloc( sizeof(BeatAnalyzeInfo) + (sizeof(BeatInfo) * section.count), 1 );
+
+        strncpy_s( beats->link, header.link, sizeof(beats->link) );
+        beats->tempo = header.tempo;
+        beats->beat_count = section.count;
+        memcpy( beats->beats, getSection( contents, header, SECTION_BEATS ), sizeof(BeatInfo) * section.count );
+
+        analysis.m_beats = beats;
+    }
+
+    if ( header.sections[SECTION_PYRAMID].offset != 0 ) {
+        AmplitudePyramid* pyramid = new AmplitudePyramid();
+
+        pyramid->setBase( (const AmplitudeLevel*)getSection( contents, header, SECTION_PYRAMID ), header.sections[SECTION_PYRAMID].count );
+
+        analysis.m_pyramid = pyramid;
+    }
+
+    if ( header.sections[SECTION_LOUDNESS].offset != 0 ) {
+        const AnalysisFileSection& section = header.sections[SECTION_LOUDNESS];
+
+        LoudnessAnalyzeInfo* loudness = (LoudnessAnalyzeInfo*)calloc( sizeof(LoudnessAnalyzeInfo) + (sizeof(LoudnessLevel) * section.count), 1 );
+
+        strncpy_s( loudness->link, header.link, sizeof(loudness->link) );
+        loudness->duration_ms = section.duration_ms;
+        loudness->data_count = section.count;
+        loudness->integrated_lufs = header.integrated_lufs;
+        memcpy( loudness->data, getSection( contents, header, SECTION_LOUDNESS ), sizeof(LoudnessLevel) * section.count );
+
+        analysis.m_loudness = loudness;
+    }
+
+    TrackCoverage coverage( header.length_ms );
+    const AnalysisSegment* segments = (const AnalysisSegment*)getSection( contents, header, SECTION_COVERAGE );
+
+    for ( uint32_t i=0; segments != NULL && i < header.sections[SECTION_COVERAGE].count; i++ )
+        coverage.add( segments[i].start_ms, segments[i].end_ms );
+
+    if ( !analysis.m_bands || !analysis.m_beats || !analysis.m_pyramid || !analysis.m_loudness )
+        coverage.clear();
+
+    analysis.m_coverage = coverage;
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Analysis saved as JSON before the binary format
+//
+static bool decodeTrackAnalysisJson( const BYTE* contents, size_t size, TrackAnalysisData& analysis )
+{
+    CString data( (LPCSTR)contents, (int)size );
+
+    SimpleJsonParser parser;
+
+    try {
+        parser.parse( data );
+
+        CString spotify_id = parser.get<CString>( "link" );
+
+        SimpleJsonParser amplitute_parser = parser.get<SimpleJsonParser>( "amplitude" );
+
+        size_t data_count = amplitute_parser.get<size_t>( "data_count" );
+        UINT duration_ms = amplitute_parser.get<size_t>( "duration_ms" );
+        std::vector<uint16_t> amplitude_data = amplitute_parser.getArrayAsVector<uint16_t>( "data" );
+
+        AnalyzeInfo* info = (AnalyzeInfo*)calloc( sizeof(AnalyzeInfo) + (sizeof(uint16_t) * data_count), 1 );
+        for ( size_t i=0; i < data_count; i++ )
+            info->data[i] = amplitude_data[i];
+
+        strncpy_s( info->link, spotify_id, sizeof(info->link) );
+        info->data_count = data_count;
+        info->duration_ms = duration_ms;
+        analysis.m_info = info;
+
+        if ( parser.has_key( "bands" ) ) {
+            SimpleJsonParser band_parser = parser.get<SimpleJsonParser>( "bands" );
+
+            size_t band_count = band_parser.get<size_t>( "data_count" );
+            std::vector<UINT> band_hz = band_parser.getArrayAsVector<UINT>( "band_hz" );
+
+            BandAnalyzeInfo* bands = (BandAnalyzeInfo*)calloc( sizeof(BandAnalyzeInfo) + (sizeof(uint16_t) * band_count * ANALYZE_BANDS), 1 );
+
+            strncpy_s( bands->link, spotify_id, sizeof(bands->link) );
+            bands->data_count = band_count;
+            bands->duration_ms = band_parser.get<UINT>( "duration_ms" );
+
+            for ( UINT edge=0; edge < ANALYZE_BANDS+1 && edge < band_hz.size(); edge++ )
+                bands->band_hz[edge] = band_hz[edge];
+
+            for ( UINT band=0; band < ANALYZE_BANDS; band++ ) {
+                std::vector<uint16_t> levels = band_parser.getArrayAsVector<uint16_t>( bandNames[band] );
+
+                for ( size_t i=0; i < band_count && i < levels.size(); i++ )
+                    bands->data[ band * band_count + i ] = levels[i];
+            }
+
+            analysis.m_bands = bands;
+        }
+
+        if ( parser.has_key( "beats" ) ) {
+            SimpleJsonParser beat_parser = parser.get<SimpleJsonParser>( "beats" );
+
+            std::vector<UINT> times = beat_parser.getArrayAsVector<UINT>( "time_ms" );
+            std::vector<UINT> confidence = beat_parser.getArrayAsVector<UINT>( "confidence" );
+
+            BeatAnalyzeInfo* beats = (BeatAnalyzeInfo*)calloc( sizeof(BeatAnalyzeInfo) + (sizeof(BeatInfo) * times.size()), 1 );
+
+            strncpy_s( beats->link, spotify_id, sizeof(beats->link) );
+            beats->tempo = beat_parser.get<float>( "tempo" );
+            beats->beat_count = times.size();
+
+            for ( size_t i=0; i < times.size(); i++ ) {
+                beats->beats[i].time_ms = times[i];
+                beats->beats[i].confidence = ( i < confidence.size() ) ? confidence[i] / 100.0f : 0.0f;
+            }
+
+            analysis.m_beats = beats;
+        }
+
+        // Only the base is saved; the coarser levels are rebuilt from it
+        if ( parser.has_key( "pyramid" ) ) {
+            SimpleJsonParser pyramid_parser = parser.get<SimpleJsonParser>( "pyramid" );
+
+            std::vector<int> min_samples = pyramid_parser.getArrayAsVector<int>( "min" );
+            std::vector<int> max_samples = pyramid_parser.getArrayAsVector<int>( "max" );
+            std::vector<UINT> rms = pyramid_parser.getArrayAsVector<UINT>( "rms" );
+
+            size_t count = min( rms.size(), min( min_samples.size(), max_samples.size() ) );
+            AmplitudeLevelArray base( count );
+
+            for ( size_t i=0; i < count; i++ ) {
+                base[i].min_sample = (int16_t)min_samples[i];
+                base[i].max_sample = (int16_t)max_samples[i];
+                base[i].rms = (uint16_t)rms[i];
+            }
+
+            AmplitudePyramid* pyramid = new AmplitudePyramid();
+            pyramid->setBase( count ? &base[0] : NULL, count );
+
+            analysis.m_pyramid = pyramid;
+        }
+
+        if ( parser.has_key( "loudness" ) ) {
+            SimpleJsonParser loudness_parser = parser.get<SimpleJsonParser>( "loudness" );
+
+            std::vector<UINT> rms = loudness_parser.getArrayAsVector<UINT>( "rms" );
+            std::vector<int> short_term = loudness_parser.getArrayAsVector<int>( "short_term" );
+
+            size_t count = min( rms.size(), short_term.size() );
+
+            LoudnessAnalyzeInfo* loudness = (LoudnessAnalyzeInfo*)calloc( sizeof(LoudnessAnalyzeInfo) + (sizeof(LoudnessLevel) * count), 1 );
+
+            strncpy_s( loudness->link, spotify_id, sizeof(loudness->link) );
+            loudness->duration_ms = loudness_parser.get<UINT>( "duration_ms" );
+            loudness->data_count = count;
+            loudness->integrated_lufs = loudness_parser.get<float>( "integrated_lufs" );
+
+            for ( size_t i=0; i < count; i++ ) {
+                loudness->data[i].rms = (uint16_t)rms[i];
+                loudness->data[i].short_term_lufs = short_term[i] / 10.0f;
+            }
+
+            analysis.m_loudness = loudness;
+        }
+
+        // Analysis saved before coverage was added came from a whole play.  Analysis missing
+        // any part (saved before that part existed) is treated as unanalyzed so the next 
+        // play fills it in.
+        TrackCoverage coverage( (DWORD)(data_count * duration_ms) );
+
+        if ( parser.has_key( "coverage" ) ) {
+            SimpleJsonParser coverage_parser = parser.get<SimpleJsonParser>( "coverage" );
+
+            std::vector<UINT> segment_start = coverage_parser.getArrayAsVector<UINT>( "start_ms" );
+            std::vector<UINT> segment_end = coverage_parser.getArrayAsVector<UINT>( "end_ms" );
+
+            coverage.setLength( parser.get<UINT>( "length_ms" ) );
+
+            for ( size_t i=0; i < segment_start.size() && i < segment_end.size(); i++ )
+                coverage.add( segment_start[i], segment_end[i] );
+        }
+        else
+            coverage.add( 0, coverage.getLength() );
+
+        if ( !analysis.m_bands || !analysis.m_beats || !analysis.m_pyramid || !analysis.m_loudness )
+            coverage.clear();
+
+        analysis.m_coverage = coverage;
+
+        return true;
+    }
+    catch ( std::exception& e ) {
+        log( StudioException( "JSON parser error (%s) data (%s)", e.what(), data ) );
+        freeTrackAnalysisData( analysis );
+        return false;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Binary analysis or JSON analysis saved by earlier versions
+//
+bool decodeTrackAnalysis( const BYTE* contents, size_t size, TrackAnalysisData& analysis )
+{
+    if ( isTrackAnalysisBinary( contents, size ) )
+        return decodeTrackAnalysisBinary( contents, size, analysis );
+
+    return decodeTrackAnalysisJson( contents, size, analysis );
+}
+
+// ----------------------------------------------------------------------------
+// Written beside the file and moved over it so a failed write leaves the old analysis
+//
+bool writeTrackAnalysisFile( LPCSTR filename, const TrackAnalysisData& analysis )
+{
+    std::vector<BYTE> contents;
+
+    encodeTrackAnalysis( analysis, contents );
+
+    CString temp_filename( filename );
+    temp_filename += ".tmp";
+
+    FILE* hFile = _fsopen( temp_filename, "wb", _SH_DENYWR );
+    if ( hFile == NULL ) {
+        log( "Unable to write track analysis to %s", (LPCSTR)temp_filename );
+        return false;
+    }
+
+    size_t written = fwrite( &contents[0], 1, contents.size(), hFile );
+    bool closed = fclose( hFile ) == 0;
+
+    if ( written != contents.size() || !closed || !MoveFileEx( temp_filename, filename, MOVEFILE_REPLACE_EXISTING ) ) {
+        log( "Unable to write track analysis to %s", filename );
+        DeleteFile( temp_filename );
+        return false;
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+//
+bool readTrackAnalysisFile( LPCSTR filename, TrackAnalysisData& analysis )
+{
+    MappedFile file;
+
+    if ( !file.open( filename ) ) {
+        log( "Unable to read track analysis from %s", filename );
+        return false;
+    }
+
+    return decodeTrackAnalysis( file.getData(), file.getSize(), analysis );
+}
+
+// ----------------------------------------------------------------------------
+//
+void freeTrackAnalysisData( TrackAnalysisData& analysis )
+{
+    if ( analysis.m_info )
+        free( analysis.m_info );
+    if ( analysis.m_bands )
+        free( analysis.m_bands );
+    if ( analysis.m_beats )
+        free( analysis.m_beats );
+    if ( analysis.m_pyramid )
+        delete analysis.m_pyramid;
+    if ( analysis.m_loudness )
+        free( analysis.m_loudness );
+
+    analysis.m_info = NULL;
+    analysis.m_bands = NULL;
+    analysis.m_beats = NULL;
+    analysis.m_pyramid = NULL;
+    analysis.m_loudness = NULL;
+}
+
+// ----------------------------------------------------------------------------
+//
+size_t getTrackAnalysisBytes( const TrackAnalysisData& analysis )
+{
+    size_t bytes = sizeof(AnalyzeInfo) + (sizeof(uint16_t) * analysis.m_info->data_count);
+
+    if ( analysis.m_bands )
+        bytes += sizeof(BandAnalyzeInfo) + (sizeof(uint16_t) * analysis.m_bands->data_count * ANALYZE_BANDS);
+    if ( analysis.m_beats )
+        bytes += sizeof(BeatAnalyzeInfo) + (sizeof(BeatInfo) * analysis.m_beats->beat_count);
+    if ( analysis.m_pyramid )
+        bytes += sizeof(AmplitudePyramid) + (sizeof(AmplitudeLevel) * analysis.m_pyramid->getPointCount());
+    if ( analysis.m_loudness )
+        bytes += sizeof(LoudnessAnalyzeInfo) + (sizeof(LoudnessLevel) * analysis.m_loudness->data_count);
+
+    return bytes + (sizeof(AnalysisSegment) * analysis.m_coverage.getSegments().size());
+}
@@ -0,0 +1,67 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+#pragma once
+
+#include "stdafx.h"
+#include "MusicPlayerApi.h"
+#include "AmplitudePyramid.h"
+#include "TrackCoverage.h"
+
+// The parts of one track's saved analysis (any but m_info may be NULL)
+//
+struct TrackAnalysisData 
+{
+    AnalyzeInfo*        m_info;
+    BandAnalyzeInfo*    m_bands;
+    BeatAnalyzeInfo*    m_beats;
+    AmplitudePyramid*   m_pyramid;
+    LoudnessAnalyzeInfo* m_loudness;
+    TrackCoverage       m_coverage;
+
+    TrackAnalysisData() :
+        m_info( NULL ),
+        m_bands( NULL ),
+        m_beats( NULL ),
+        m_pyramid( NULL ),
+        m_loudness( NULL )
+    {}
+};
+
+CString makeTrackAnalysisFileName( LPCSTR directory, LPCSTR spotify_id );
+
+// Analysis is saved in a versioned binary format (see TrackAnalysisFile.cpp) that is read
+// through a file mapping.  JSON files saved by earlier versions are still read.
+bool writeTrackAnalysisFile( LPCSTR filename, const TrackAnalysisData& analysis );
+bool readTrackAnalysisFile( LPCSTR filename, TrackAnalysisData& analysis );
+
+void encodeTrackAnalysis( const TrackAnalysisData& analysis, std::vector<BYTE>& contents );
+bool decodeTrackAnalysis( const BYTE* contents, size_t size, TrackAnalysisData& analysis );
+bool isTrackAnalysisBinary( const BYTE* contents, size_t size );
+LPCSTR getTrackAnalysisLink( const BYTE* contents, size_t size );
+bool isTrackAnalysisFileComplete( const BYTE* contents, size_t size );
+
+// Frees every part (the parts are not owned by TrackAnalysisData otherwise)
+void freeTrackAnalysisData( TrackAnalysisData& analysis );
+
+// Memory held by the parts
+size_t getTrackAnalysisBytes( const TrackAnalysisData& analysis );
@@ -22,34 +22,119 @@ MA 02111-1307, USA.
 
 #include "stdafx.h"
 #include "TrackAnalyzer.h"
+#include "AnalyzerKernels.h"
+#include "AudioFormatConverter.h"
 
-#define _USE_MATH_DEFINES
-#include <math.h>
+// ----------------------------------------------------------------------------
+//
+// Band edges in Hz (bass, mid, treble)
+static const UINT BAND_EDGES_HZ[ANALYZE_BANDS+1] = { 20, 250, 4000, 16000 };
+
+// ----------------------------------------------------------------------------
+// Smallest power of 2 that covers one band hop (1024 at 44.1 and 48kHz)
+//
+UINT TrackAnalyzer::getBandFftSize( UINT sample_rate )
+{
+    UINT hop = (sample_rate * BAND_SAMPLE_MS) / 1000;
+    UINT size = MIN_BAND_FFT_SIZE;
+
+    while ( size < hop )
+        size *= 2;
+
+    return size;
+}
 
 // ----------------------------------------------------------------------------
+// Analysis from a seek starts at the next amplitude sample so every partial run lands
+// on the same amplitude, band and pyramid grid
 //
-TrackAnalyzer::TrackAnalyzer( WAVEFORMATEX* format, DWORD track_length_ms, LPCSTR spotify_link ) :
+DWORD TrackAnalyzer::alignStart( DWORD start_ms )
+{
+    return ((start_ms + AMPLITUDE_SAMPLE_MS - 1) / AMPLITUDE_SAMPLE_MS) * AMPLITUDE_SAMPLE_MS;
+}
+
+// ----------------------------------------------------------------------------
+//
+TrackAnalyzer::TrackAnalyzer( WAVEFORMATEX* format, DWORD track_length_ms, LPCSTR spotify_link, DWORD start_ms, SimdLevel simd ) :
+    m_frame_bytes( format->nBlockAlign ),
+    m_sample_rate( format->nSamplesPerSec ),
+    m_simd( simd ),
     m_data_index( 0 ),
-    m_sample_index( 0 )
+    m_sample_index( alignStart( start_ms ) / AMPLITUDE_SAMPLE_MS ),
+    m_loudness( format->nSamplesPerSec, simd ),
+    m_pyramid( new AmplitudePyramid( format->nSamplesPerSec ) ),
+    m_fft( getBandFftSize( format->nSamplesPerSec ), simd ),
+    m_band_index( alignStart( start_ms ) / BAND_SAMPLE_MS ),
+    m_beat_tracker( m_fft.getBins(), m_fft.getSize(), BAND_SAMPLE_MS, alignStart( start_ms ) ),
+    m_link( spotify_link ),
+    m_start_ms( alignStart( start_ms ) ),
+    m_hop_count( 0 ),
+    m_stream( NULL ),
+    m_live_pending( false ),
+    m_degraded( false ),
+    m_skip_frames( (UINT)((ULONGLONG)(alignStart( start_ms ) - start_ms) * format->nSamplesPerSec / 1000) ),
+    m_frames_analyzed( 0 ),
+    m_coverage( track_length_ms )
 {
-    static const UINT SAMPLE_MS = 500;           // Sample every 500ms
+    m_sample_size = (format->nSamplesPerSec * AMPLITUDE_SAMPLE_MS) / 1000;            
 
-    m_numChannels = format->nChannels;
+    m_block = new int16_t[m_sample_size * ANALYZER_CHANNELS];
+    m_window = new float[m_sample_size * ANALYZER_CHANNELS];
 
-    m_sample_size = (format->nSamplesPerSec * SAMPLE_MS) / 1000;            
+    makeHannWindow( m_window, m_sample_size, ANALYZER_CHANNELS );
 
-    m_sample_left = new int16_t[m_sample_size];
-    m_sample_right = new int16_t[m_sample_size];
+    m_pyramid->startAt( m_start_ms );
 
-    UINT amplitude_samples = (track_length_ms+SAMPLE_MS-1) / SAMPLE_MS;
+    UINT amplitude_samples = (track_length_ms+AMPLITUDE_SAMPLE_MS-1) / AMPLITUDE_SAMPLE_MS;
 
     m_analyze_info = (AnalyzeInfo*)calloc( sizeof(AnalyzeInfo) + (sizeof(uint16_t) * amplitude_samples), 1 );
 
     m_analyze_info->data_count = amplitude_samples;
-    m_analyze_info->duration_ms = SAMPLE_MS;
+    m_analyze_info->duration_ms = AMPLITUDE_SAMPLE_MS;
 
     strncpy_s( m_analyze_info->link, spotify_link, sizeof(m_analyze_info->link) );
 
+    m_loudness_info = (LoudnessAnalyzeInfo*)calloc( sizeof(LoudnessAnalyzeInfo) + (sizeof(LoudnessLevel) * amplitude_samples), 1 );
+
+    m_loudness_info->data_count = amplitude_samples;
+    m_loudness_info->duration_ms = AMPLITUDE_SAMPLE_MS;
+    m_loudness_info->integrated_lufs = LOUDNESS_SILENCE_LUFS;
+
+    for ( UINT i=0; i < amplitude_samples; i++ )
+        m_loudness_info->data[i].short_term_lufs = LOUDNESS_SILENCE_LUFS;
+
+    strncpy_s( m_loudness_info->link, spotify_link, sizeof(m_loudness_info->link) );
+
+    // Band analysis
+    UINT fft_size = m_fft.getSize();
+
+    m_band_hop = (format->nSamplesPerSec * BAND_SAMPLE_MS) / 1000;
+    m_fft_input.resize( fft_size, 0.0f );
+    m_fft_fill = fft_size - m_band_hop;                 // First transform after one hop (zero history)
+    m_fft_window.resize( fft_size );
+    m_power.resize( m_fft.getBins() );
+
+    makeHannWindow( &m_fft_window[0], fft_size, 1 );
+
+    double window_power = 0.0;
+    for ( UINT i=0; i < fft_size; i++ )
+        window_power += m_fft_window[i] * m_fft_window[i];
+
+    m_band_scale = (float)(2.0 / (fft_size * window_power));
+
+    for ( UINT band=0; band <= ANALYZE_BANDS; band++ ) 
+        m_band_bins[band] = min( (UINT)((ULONGLONG)BAND_EDGES_HZ[band] * fft_size / format->nSamplesPerSec), fft_size / 2 );
+
+    UINT band_samples = (track_length_ms+BAND_SAMPLE_MS-1) / BAND_SAMPLE_MS;
+
+    m_band_info = (BandAnalyzeInfo*)calloc( sizeof(BandAnalyzeInfo) + (sizeof(uint16_t) * band_samples * ANALYZE_BANDS), 1 );
+
+    m_band_info->data_count = band_samples;
+    m_band_info->duration_ms = BAND_SAMPLE_MS;
+    memcpy( m_band_info->band_hz, BAND_EDGES_HZ, sizeof(BAND_EDGES_HZ) );
+
+    strncpy_s( m_band_info->link, spotify_link, sizeof(m_band_info->link) );
+
     log_status( "Analyzing track '%s'", (LPCSTR)spotify_link );
 }
 
@@ -57,51 +142,175 @@ TrackAnalyzer::TrackAnalyzer( WAVEFORMATEX* format, DWORD track_length_ms, LPCST
 //
 TrackAnalyzer::~TrackAnalyzer()
 {
-    if ( m_sample_left )
-        delete m_sample_left;
-    if ( m_sample_right )
-        delete m_sample_right;
+    if ( m_block )
+        delete [] m_block;
+    if ( m_window )
+        delete [] m_window;
     if ( m_analyze_info ) 
         free( m_analyze_info );
-
-    m_sample_left = m_sample_right = NULL;
+    if ( m_band_info ) 
+        free( m_band_info );
+    if ( m_loudness_info ) 
+        free( m_loudness_info );
+    if ( m_pyramid )
+        delete m_pyramid;
+
+    m_block = NULL;
+    m_window = NULL;
     m_analyze_info = NULL;
+    m_band_info = NULL;
+    m_loudness_info = NULL;
+    m_pyramid = NULL;
+}
+
+// ----------------------------------------------------------------------------
+// FORMAT SPECIALIZATIONS
+//
+// One analyzer class per input sample type and channel count.  Stereo goes into the block
+// with a single copy or conversion; other layouts take the first two channels (mono pads
+// the right channel with silence) in a loop the compiler can unroll for the fixed stride.
+// ----------------------------------------------------------------------------
+
+static inline void convertSamples( const int16_t* input, int16_t* output, size_t count, SimdLevel simd )
+{
+    memcpy( output, input, count * sizeof(int16_t) );
+}
+
+static inline void convertSamples( const float* input, int16_t* output, size_t count, SimdLevel simd )
+{
+    floatToSamples( input, output, count, simd );
+}
+
+static inline int16_t toBlockSample( int16_t sample )
+{
+    return sample;
+}
+
+static inline int16_t toBlockSample( float sample )
+{
+    sample *= 32767.0f;
+
+    return (int16_t)( sample >= 32767.0f ? 32767 : sample <= -32768.0f ? -32768 : (int)sample );
+}
+
+template <typename SampleT, UINT CHANNELS>
+class FormatTrackAnalyzer : public TrackAnalyzer
+{
+public:
+    FormatTrackAnalyzer( WAVEFORMATEX* format, DWORD track_length_ms, LPCSTR spotify_link, DWORD start_ms, SimdLevel simd ) :
+        TrackAnalyzer( format, track_length_ms, spotify_link, start_ms, simd )
+    {}
+
+protected:
+    void copyFrames( const BYTE* data, int16_t* block, UINT frames, SimdLevel simd );
+};
+
+// ----------------------------------------------------------------------------
+//
+template <typename SampleT, UINT CHANNELS>
+void FormatTrackAnalyzer<SampleT, CHANNELS>::copyFrames( const BYTE* data, int16_t* block, UINT frames, SimdLevel simd )
+{
+    const SampleT* samples = reinterpret_cast<const SampleT *>( data );
+
+    if ( CHANNELS == ANALYZER_CHANNELS ) {
+        convertSamples( samples, block, frames * ANALYZER_CHANNELS, simd );
+        return;
+    }
+
+    for ( UINT frame=0; frame < frames; frame++, samples += CHANNELS, block += ANALYZER_CHANNELS ) {
+        block[LEFT_CHANNEL] = toBlockSample( samples[LEFT_CHANNEL] );
+        block[RIGHT_CHANNEL] = ( CHANNELS == 1 ) ? 0 : toBlockSample( samples[RIGHT_CHANNEL] );
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+template <typename SampleT>
+static TrackAnalyzer* createFormatAnalyzer( WAVEFORMATEX* format, DWORD track_length_ms, LPCSTR spotify_link, DWORD start_ms, SimdLevel simd )
+{
+    switch ( format->nChannels ) {
+        case 1: return new FormatTrackAnalyzer<SampleT, 1>( format, track_length_ms, spotify_link, start_ms, simd );
+        case 2: return new FormatTrackAnalyzer<SampleT, 2>( format, track_length_ms, spotify_link, start_ms, simd );
+        case 3: return new FormatTrackAnalyzer<SampleT, 3>( format, track_length_ms, spotify_link, start_ms, simd );
+        case 4: return new FormatTrackAnalyzer<SampleT, 4>( format, track_length_ms, spotify_link, start_ms, simd );
+        case 5: return new FormatTrackAnalyzer<SampleT, 5>( format, track_length_ms, spotify_link, start_ms, simd );
+        case 6: return new FormatTrackAnalyzer<SampleT, 6>( format, track_length_ms, spotify_link, start_ms, simd );
+        case 7: return new FormatTrackAnalyzer<SampleT, 7>( format, track_length_ms, spotify_link, start_ms, simd );
+        case 8: return new FormatTrackAnalyzer<SampleT, 8>( format, track_length_ms, spotify_link, start_ms, simd );
+    }
+
+    throw StudioException( "Unable to analyze audio with %d channels", (int)format->nChannels );
+}
+
+// ----------------------------------------------------------------------------
+//
+bool TrackAnalyzer::canAnalyze( const WAVEFORMATEX* format )
+{
+    return AudioFormatConverter::getSampleType( format ) != SAMPLE_UNSUPPORTED &&
+           format->nChannels > 0 && format->nChannels <= MAX_ANALYZER_CHANNELS &&
+           format->nBlockAlign == format->nChannels * (format->wBitsPerSample / 8) &&
+           format->nSamplesPerSec > 0;
+}
+
+// ----------------------------------------------------------------------------
+// Picks the analyzer specialized for the format (16-bit PCM or 32-bit float, 1 to 
+// MAX_ANALYZER_CHANNELS channels)
+//
+TrackAnalyzer* TrackAnalyzer::create( WAVEFORMATEX* format, DWORD track_length_ms, LPCSTR spotify_link, DWORD start_ms, SimdLevel simd )
+{
+    if ( !canAnalyze( format ) )
+        throw StudioException( "Unable to analyze audio format %d (%d bits, %d channels)", 
+                               (int)format->wFormatTag, (int)format->wBitsPerSample, (int)format->nChannels );
+
+    if ( AudioFormatConverter::getSampleType( format ) == SAMPLE_FLOAT32 )
+        return createFormatAnalyzer<float>( format, track_length_ms, spotify_link, start_ms, simd );
+
+    return createFormatAnalyzer<int16_t>( format, track_length_ms, spotify_link, start_ms, simd );
 }
 
 // ----------------------------------------------------------------------------
 //
 HRESULT TrackAnalyzer::addData(  UINT32 numFramesAvailable, BYTE *pData )
 {
-    int16_t* data = reinterpret_cast<int16_t *>(pData);
+    const BYTE* data = pData;
 
-    for ( unsigned frame=0; frame < numFramesAvailable; frame++ ) {
-        if ( data ) {
-            m_sample_left[m_data_index] = *data++;
+    if ( m_skip_frames > 0 ) {
+        UINT skip = min( numFramesAvailable, m_skip_frames );
 
-            if ( m_numChannels > 1 ) 
-                m_sample_right[m_data_index] = *data++;
-            else
-                m_sample_right[m_data_index] = 0;
+        if ( data )
+            data = &data[ skip * m_frame_bytes ];
 
-            if ( m_numChannels > 2 )				// Skip any other channels
-                data = &data[m_numChannels-2];
-        }
-        else {
-            m_sample_left[m_data_index] = m_sample_right[m_data_index] = 0;
-        }
+        numFramesAvailable -= skip;
+        m_skip_frames -= skip;
+    }
 
-        m_data_index++;
+    if ( data != NULL && numFramesAvailable > 0 )
+        m_coverage.add( m_start_ms + (DWORD)(m_frames_analyzed * 1000 / m_sample_rate),
+                        m_start_ms + (DWORD)((m_frames_analyzed + numFramesAvailable) * 1000 / m_sample_rate) );
 
-        if ( m_data_index >= m_sample_size ) {
-            applyWindowFunction( m_sample_size, m_sample_left );
+    m_frames_analyzed += numFramesAvailable;
+
+    while ( numFramesAvailable > 0 ) {
+        UINT frames = min( numFramesAvailable, m_sample_size - m_data_index );
+        int16_t* block = &m_block[ m_data_index * ANALYZER_CHANNELS ];
 
-            if (m_numChannels > 1 ) {
-                applyWindowFunction( m_sample_size, m_sample_right );
-            }
+        if ( data == NULL )
+            memset( block, 0, frames * ANALYZER_CHANNELS * sizeof(int16_t) );
+        else
+            copyFrames( data, block, frames, m_simd );
 
-            int16_t* sample_data[] = { m_sample_left, m_sample_right };
+        addBandFrames( block, frames );
+        m_pyramid->addFrames( block, frames, m_simd );
+        m_loudness.addFrames( block, frames );
 
-            processAmplitudes( m_sample_size, sample_data );
+        if ( data )
+            data = &data[ frames * m_frame_bytes ];
+
+        numFramesAvailable -= frames;
+        m_data_index += frames;
+
+        if ( m_data_index >= m_sample_size ) {
+            processAmplitudes( m_sample_size, m_window );
 
             m_data_index = 0;
         }
@@ -111,19 +320,32 @@ HRESULT TrackAnalyzer::addData(  UINT32 numFramesAvailable, BYTE *pData )
 };
 
 // ----------------------------------------------------------------------------
+// Analyze frames in place in the audio ring buffer
+//
+HRESULT TrackAnalyzer::addData( const AudioFrameSpans& spans )
+{
+    for ( UINT i=0; i < spans.m_count; i++ )
+        addData( spans.m_span[i].m_frames, spans.m_span[i].m_data );
+
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+// The final partial block gets a window of its own length
 //
 HRESULT TrackAnalyzer::finishData()
 {
-    if ( m_data_index > 0 ) {
-        applyWindowFunction( m_data_index, m_sample_left );
+    m_pyramid->finish();
 
-        if ( m_numChannels > 1 ) {
-            applyWindowFunction( m_data_index, m_sample_right );
-        }
+    if ( m_live_pending )
+        publishLiveFrame();
+
+    if ( m_data_index > 0 ) {
+        std::vector<float> window( m_data_index * ANALYZER_CHANNELS );
 
-        int16_t* sample_data[] = { m_sample_left, m_sample_right };
+        makeHannWindow( &window[0], m_data_index, ANALYZER_CHANNELS );
 
-        processAmplitudes( m_data_index, sample_data );
+        processAmplitudes( m_data_index, &window[0] );
 
         m_data_index = 0;
     }
@@ -132,36 +354,143 @@ HRESULT TrackAnalyzer::finishData()
 }
 
 // ----------------------------------------------------------------------------
+// Peak windowed amplitude and RMS across both channels in one pass over the block.  The
+// loudness meter has already seen the block's frames as they were copied in.
 //
-HRESULT TrackAnalyzer::processAmplitudes( size_t sample_size, int16_t* sample_data[] ) {
-    // Determine peak amplitude for both channels
-    int16_t amplitude = 0;
-    for ( size_t i=0; i < sample_size; i++ ) {
-        int16_t sample = abs(sample_data[LEFT_CHANNEL][i]);
-        if ( sample > amplitude )
-            amplitude = sample;
+HRESULT TrackAnalyzer::processAmplitudes( size_t sample_size, const float* window ) {
+    ULONGLONG squares = 0;
 
-        if ( m_numChannels > 1 ) {
-            int16_t sample = abs(sample_data[RIGHT_CHANNEL][i]);
-            if ( sample > amplitude )
-                amplitude = sample;
-        }
-    }
+    float peak = windowedPeak( m_block, window, sample_size * ANALYZER_CHANNELS, squares, m_simd );
+
+    uint16_t amplitude = (uint16_t)min( peak, 32767.0f );
+
+    if ( m_sample_index < m_analyze_info->data_count ) {
+        LoudnessLevel& level = m_loudness_info->data[ m_sample_index ];
+
+        level.rms = (uint16_t)min( 32767.0, sqrt( (double)squares / (sample_size * ANALYZER_CHANNELS) ) + 0.5 );
+        level.short_term_lufs = m_loudness.getShortTerm();
 
-    if ( m_sample_index < m_analyze_info->data_count )
         m_analyze_info->data[ m_sample_index++ ] = amplitude;
+    }
 
     return 0;
 }
 
 // ----------------------------------------------------------------------------
-// Apply Hann window function
+// Integrated loudness covers everything analyzed (call after finishData)
+//
+LoudnessAnalyzeInfo* TrackAnalyzer::captureLoudnessData( void )
+{
+    LoudnessAnalyzeInfo* value = m_loudness_info;
+
+    if ( value != NULL )
+        value->integrated_lufs = m_loudness.getIntegrated();
+
+    m_loudness_info = NULL;
+
+    return value;
+}
+
+// ----------------------------------------------------------------------------
+// Mixes new block frames to mono and runs a transform every band hop
+//
+void TrackAnalyzer::addBandFrames( const int16_t* block, UINT frames )
+{
+    UINT fft_size = m_fft.getSize();
+
+    while ( frames > 0 ) {
+        UINT count = min( frames, fft_size - m_fft_fill );
+
+        stereoToMono( block, &m_fft_input[m_fft_fill], count, m_simd );
+
+        block = &block[ count * ANALYZER_CHANNELS ];
+        frames -= count;
+        m_fft_fill += count;
+
+        if ( m_fft_fill == fft_size ) {
+            processBands();
+
+            memmove( &m_fft_input[0], &m_fft_input[m_band_hop], (fft_size - m_band_hop) * sizeof(float) );
+            m_fft_fill = fft_size - m_band_hop;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Band level is the RMS of the band's share of the signal (Parseval, corrected for the
+// window's energy)
 //
-void TrackAnalyzer::applyWindowFunction( unsigned m_sample_size, int16_t* sampleSet )
-{	
-    static const double TWO_PI = M_PI * 2.0;
+void TrackAnalyzer::processBands( void )
+{
+    // Degraded analysis repeats the last spectrum on odd hops
+    if ( !m_degraded || (m_hop_count & 1) == 0 ) {
+        m_fft.powerSpectrum( &m_fft_input[0], &m_fft_window[0], &m_power[0] );
+        m_beat_tracker.addSpectrum( &m_power[0] );
+    }
+    else
+        m_beat_tracker.repeatSpectrum();
+
+    // Onsets are judged a hop late, so the previous frame is only complete now
+    if ( m_live_pending ) {
+        m_live_frame.onset = m_beat_tracker.isOnset();
+        m_live_frame.onset_strength = m_beat_tracker.getOnsetStrength();
+        publishLiveFrame();
+    }
+
+    float total_power = 0.0f;
+    for ( UINT bin=0; bin < m_fft.getBins(); bin++ )
+        total_power += m_power[bin];
+
+    m_live_frame.time_ms = m_start_ms + m_hop_count * BAND_SAMPLE_MS;
+    m_live_frame.level = (uint16_t)min( sqrtf( total_power * m_band_scale ), 32767.0f );
+    m_live_frame.onset = false;
+    m_live_frame.onset_strength = 0.0f;
+
+    for ( UINT band=0; band < ANALYZE_BANDS; band++ ) {
+        float power = 0.0f;
+
+        for ( UINT bin=m_band_bins[band]; bin < m_band_bins[band+1]; bin++ )
+            power += m_power[bin];
+
+        m_live_frame.bands[band] = (uint16_t)min( sqrtf( power * m_band_scale ), 32767.0f );
 
-    for ( unsigned bin=0; bin < m_sample_size; bin++ ) {
-        sampleSet[bin] = (int16_t)( (float)sampleSet[bin] * 0.5f * (1.0F - (float) cos(TWO_PI * bin / (m_sample_size - 1.0F))) );
+        if ( m_band_index < m_band_info->data_count )
+            m_band_info->data[ band * m_band_info->data_count + m_band_index ] = m_live_frame.bands[band];
     }
+
+    if ( m_band_index < m_band_info->data_count )
+        m_band_index++;
+
+    m_hop_count++;
+    m_live_pending = true;
+}
+
+// ----------------------------------------------------------------------------
+//
+void TrackAnalyzer::publishLiveFrame( void )
+{
+    if ( m_stream )
+        m_stream->publish( m_live_frame );
+
+    m_live_pending = false;
+}
+
+// ----------------------------------------------------------------------------
+// Beats found so far (call after finishData for the whole track)
+//
+BeatAnalyzeInfo* TrackAnalyzer::captureBeatData( void )
+{
+    const BeatArray& beats = m_beat_tracker.getBeats();
+
+    BeatAnalyzeInfo* beat_info = (BeatAnalyzeInfo*)calloc( sizeof(BeatAnalyzeInfo) + (sizeof(BeatInfo) * beats.size()), 1 );
+
+    beat_info->tempo = m_beat_tracker.getTempo();
+    beat_info->beat_count = beats.size();
+
+    if ( beats.size() > 0 )
+        memcpy( beat_info->beats, &beats[0], sizeof(BeatInfo) * beats.size() );
+
+    strncpy_s( beat_info->link, (LPCSTR)m_link, sizeof(beat_info->link) );
+
+    return beat_info;
 }
@@ -22,25 +22,95 @@ MA 02111-1307, USA.
 
 #pragma once
 
+#include "AudioFrameBuffer.h"
+#include "SimdSupport.h"
+#include "RealFft.h"
+#include "BeatTracker.h"
+#include "AmplitudePyramid.h"
+#include "AnalysisStream.h"
+#include "TrackCoverage.h"
+#include "LoudnessMeter.h"
+
+#define ANALYZER_CHANNELS       2                   // Blocks hold the first two channels (mono pads right with silence)
+#define MAX_ANALYZER_CHANNELS   8                   // Widest input layout
+#define AMPLITUDE_SAMPLE_MS     500                 // Amplitude resolution (analysis starts on this grid)
+#define BAND_SAMPLE_MS          20                  // Band level resolution
+#define MIN_BAND_FFT_SIZE       1024
+
+// Live frames (one per band hop) are queued until they play, so the analysis stream must
+// hold everything between the analyzer and the render position
+static_assert( (ULONGLONG)ANALYSIS_STREAM_FRAMES * BAND_SAMPLE_MS >= (ULONGLONG)AUDIO_RING_FRAMES * 1000 / 44100 + AUDIO_TIMER_BUFFER_MS,
+               "ANALYSIS_STREAM_FRAMES does not cover the audio ring and device buffer" );
+
+// Analysis is done on blocks of interleaved stereo int16.  Input frames are reduced to 
+// that by a subclass specialized for the input sample type and channel count (see create),
+// so the frame loops have no format tests.
+
 class TrackAnalyzer
 {
+    UINT                        m_frame_bytes;          // Input frame size
+    UINT                        m_sample_rate;
+    SimdLevel                   m_simd;
 
-    UINT                        m_numChannels;
-
-    // Audio sample storage 
-    int16_t*					m_sample_left;
-    int16_t*					m_sample_right;
-    unsigned					m_sample_size;
-    unsigned					m_data_index;
+    // Audio sample storage (interleaved stereo)
+    int16_t*                    m_block;
+    float*                      m_window;               // Hann window for a full block (one weight per sample)
+    unsigned                    m_sample_size;          // Frames per block
+    unsigned                    m_data_index;
 
     AnalyzeInfo*                m_analyze_info;
     UINT                        m_sample_index;
 
+    LoudnessMeter               m_loudness;             // K-weighted loudness of the frames as they are blocked
+    LoudnessAnalyzeInfo*        m_loudness_info;        // RMS and short-term loudness per amplitude sample
+
+    AmplitudePyramid*           m_pyramid;              // Min/max/RMS from AMPLITUDE_BASE_MS up
+
+    // Spectral band levels - an FFT of the mono mix every BAND_SAMPLE_MS over the last 
+    // FFT size frames
+    RealFft                     m_fft;
+    UINT                        m_band_hop;             // Frames between transforms
+    std::vector<float>          m_fft_input;            // Mono history, newest at the end
+    UINT                        m_fft_fill;
+    std::vector<float>          m_fft_window;
+    std::vector<float>          m_power;
+    UINT                        m_band_bins[ANALYZE_BANDS+1];
+    float                       m_band_scale;           // Power sum to RMS squared
+    BandAnalyzeInfo*            m_band_info;
+    UINT                        m_band_index;
+
+    // Onsets and beats from the same spectra
+    BeatTracker                 m_beat_tracker;
+    CString                     m_link;
+
+    // Live frames (one per band hop)
+    DWORD                       m_start_ms;             // Track position of the first frame analyzed
+    UINT                        m_hop_count;
+    AnalysisStream*             m_stream;               // NULL when not publishing
+    AnalysisFrame               m_live_frame;           // Last hop (published once its onset is known)
+    bool                        m_live_pending;
+
+    bool                        m_degraded;             // Transform every other hop only
+
+    // Parts of the track analyzed from real audio (frames analyzed as silence are not covered)
+    UINT                        m_skip_frames;          // Frames before the aligned start
+    ULONGLONG                   m_frames_analyzed;      // Frames since m_start_ms
+    TrackCoverage               m_coverage;
+
+protected:
+    TrackAnalyzer( WAVEFORMATEX* format, DWORD track_length_ms, LPCSTR spotify_link, DWORD start_ms, SimdLevel simd );
+
+    // Reduces frames of input to interleaved stereo in block
+    virtual void copyFrames( const BYTE* data, int16_t* block, UINT frames, SimdLevel simd ) = 0;
+
 public:
-    TrackAnalyzer( WAVEFORMATEX* format, DWORD track_length_ms, LPCSTR spotify_link );
-    ~TrackAnalyzer();
+    virtual ~TrackAnalyzer();
+
+    static TrackAnalyzer* create( WAVEFORMATEX* format, DWORD track_length_ms, LPCSTR spotify_link, DWORD start_ms=0, SimdLevel simd=getSimdLevel() );
+    static bool canAnalyze( const WAVEFORMATEX* format );
 
     HRESULT addData( UINT32 numFramesAvailable, BYTE *pData  );
+    HRESULT addData( const AudioFrameSpans& spans );
     HRESULT finishData();
 
     inline AnalyzeInfo* captureAnalyzerData() {
@@ -49,8 +119,49 @@ public:
         return value;
     }
 
+    LoudnessAnalyzeInfo* captureLoudnessData( void );
+
+    inline BandAnalyzeInfo* captureBandData() {
+        BandAnalyzeInfo* value = m_band_info;
+        m_band_info = NULL;
+        return value;
+    }
+
+    inline const TrackCoverage& getCoverage() const {
+        return m_coverage;
+    }
+
+    inline LPCSTR getLink() const {
+        return (LPCSTR)m_link;
+    }
+
+    // Halves the spectral time resolution (bands, onsets and beats) to catch up
+    inline void setDegraded( bool degraded ) {
+        m_degraded = degraded;
+    }
+
+    inline void setLiveStream( AnalysisStream* stream ) {
+        m_stream = stream;
+    }
+
+    inline AmplitudePyramid* capturePyramid() {
+        AmplitudePyramid* value = m_pyramid;
+        m_pyramid = NULL;
+        return value;
+    }
+
+    inline void takeNewBeats( BeatArray& beats ) {
+        m_beat_tracker.takeNewBeats( beats );
+    }
+
+    BeatAnalyzeInfo* captureBeatData( void );
+
 private:
-    void applyWindowFunction( unsigned m_sample_size, int16_t* sampleSet );
-    HRESULT processAmplitudes( size_t sample_size, int16_t* sample_data[] );
-};
+    static UINT getBandFftSize( UINT sample_rate );
+    static DWORD alignStart( DWORD start_ms );
 
+    void addBandFrames( const int16_t* block, UINT frames );
+    void processBands( void );
+    void publishLiveFrame( void );
+    HRESULT processAmplitudes( size_t sample_size, const float* window );
+};
@@ -0,0 +1,97 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#include "stdafx.h"
+#include "TrackCoverage.h"
+
+// ----------------------------------------------------------------------------
+//
+void TrackCoverage::add( DWORD start_ms, DWORD end_ms )
+{
+    if ( end_ms <= start_ms )
+        return;
+
+    AnalysisSegment merged = { start_ms, end_ms };
+
+    AnalysisSegmentArray::iterator first = m_segments.begin();
+    while ( first != m_segments.end() && first->end_ms < start_ms )
+        first++;
+
+    AnalysisSegmentArray::iterator last = first;
+    while ( last != m_segments.end() && last->start_ms <= end_ms ) {
+        merged.start_ms = min( merged.start_ms, last->start_ms );
+        merged.end_ms = max( merged.end_ms, last->end_ms );
+        last++;
+    }
+
+    first = m_segments.erase( first, last );
+    m_segments.insert( first, merged );
+}
+
+// ----------------------------------------------------------------------------
+//
+void TrackCoverage::add( const TrackCoverage& coverage )
+{
+    for ( const AnalysisSegment& segment : coverage.m_segments )
+        add( segment.start_ms, segment.end_ms );
+
+    if ( m_length_ms == 0 )
+        m_length_ms = coverage.m_length_ms;
+}
+
+// ----------------------------------------------------------------------------
+//
+bool TrackCoverage::covers( DWORD start_ms, DWORD end_ms ) const
+{
+    for ( const AnalysisSegment& segment : m_segments ) {
+        if ( segment.start_ms > start_ms )
+            break;
+        if ( segment.end_ms >= end_ms )
+            return true;
+    }
+
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+// Analysis stops a little short of the track length so anything in the last
+// ANALYSIS_END_SLACK_MS only needs the coverage to reach it
+//
+bool TrackCoverage::coversBlock( DWORD start_ms, DWORD end_ms ) const
+{
+    DWORD limit = ( m_length_ms > ANALYSIS_END_SLACK_MS ) ? m_length_ms - ANALYSIS_END_SLACK_MS : 0;
+
+    return covers( min( start_ms, limit ), min( end_ms, limit ) );
+}
+
+// ----------------------------------------------------------------------------
+//
+DWORD TrackCoverage::getCoveredMs( void ) const
+{
+    DWORD covered_ms = 0;
+
+    for ( const AnalysisSegment& segment : m_segments )
+        covered_ms += segment.end_ms - segment.start_ms;
+
+    return covered_ms;
+}
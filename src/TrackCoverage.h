@@ -0,0 +1,77 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#pragma once
+
+#include "stdafx.h"
+#include "MusicPlayerApi.h"
+
+#define ANALYSIS_END_SLACK_MS       1000        // Coverage this close to the end reaches it
+#define MIN_ANALYSIS_SEGMENT_MS     2000        // Shorter runs are not kept
+
+typedef std::vector<AnalysisSegment> AnalysisSegmentArray;
+
+// The parts of a track that have been analyzed as sorted, non-overlapping segments. 
+// Segments that touch or overlap are merged as they are added.
+//
+class TrackCoverage
+{
+    DWORD                   m_length_ms;
+    AnalysisSegmentArray    m_segments;
+
+public:
+    TrackCoverage( DWORD length_ms=0 ) :
+        m_length_ms( length_ms )
+    {}
+
+    void add( DWORD start_ms, DWORD end_ms );
+    void add( const TrackCoverage& coverage );
+
+    bool covers( DWORD start_ms, DWORD end_ms ) const;
+    bool coversBlock( DWORD start_ms, DWORD end_ms ) const;
+    DWORD getCoveredMs( void ) const;
+
+    inline bool isComplete( void ) const {
+        return coversBlock( 0, m_length_ms );
+    }
+
+    inline bool isEmpty( void ) const {
+        return m_segments.empty();
+    }
+
+    inline void clear( void ) {
+        m_segments.clear();
+    }
+
+    inline DWORD getLength( void ) const {
+        return m_length_ms;
+    }
+
+    inline void setLength( DWORD length_ms ) {
+        m_length_ms = length_ms;
+    }
+
+    inline const AnalysisSegmentArray& getSegments( void ) const {
+        return m_segments;
+    }
+};
@@ -23,10 +23,20 @@ MA 02111-1307, USA.
 #include "stdafx.h"
 #include "TrackTimer.h"
 
+// ----------------------------------------------------------------------------
+//
+static const ULONG BEAT_LATE_MS = 50;               // Beats missed by more than this are not published
+static const ULONG TIMER_PERIOD_MS = 100;
+
 // ----------------------------------------------------------------------------
 //
 TrackTimer::TrackTimer( SpotifyEngine* engine ) :
     m_engine( engine ),
+    m_stream( NULL ),
+    m_start_frame( 0 ),
+    m_track_seek( 0 ),
+    m_render_position( 0 ),
+    m_next_beat( 0 ),
     Threadable( "TrackTimer" )
 {
 }
@@ -44,6 +54,8 @@ UINT TrackTimer::run()
     CSingleLock lock( &m_lock, FALSE );
 
     while ( isRunning() ) {
+        ULONG sleep_ms = TIMER_PERIOD_MS;
+
         m_lock.Lock();
 
         if ( m_tracking && !m_paused ) {
@@ -59,11 +71,24 @@ UINT TrackTimer::run()
                 m_engine->sendEvent( PlayerEvent::TRACK_POSITION, m_track_position, (LPCSTR)m_track_link );
                 m_next_notify = time + 1000L;
             }
+
+            // Publish beats as they are played and wake for the next one
+            ULONG render_position = updateRenderPosition();
+
+            while ( m_next_beat < m_beats.size() && m_beats[m_next_beat].time_ms <= render_position ) {
+                const BeatInfo& beat = m_beats[m_next_beat++];
+
+                if ( render_position - beat.time_ms <= BEAT_LATE_MS )
+                    m_engine->sendBeatEvent( beat.time_ms, (LPCSTR)m_track_link, beat.confidence );
+            }
+
+            if ( m_next_beat < m_beats.size() )
+                sleep_ms = min( sleep_ms, m_beats[m_next_beat].time_ms - render_position );
         }
 
         m_lock.Unlock();
 
-        Sleep(100);
+        Sleep( sleep_ms );
     }
     
     return 0;
@@ -79,6 +104,11 @@ void TrackTimer::stop() {
     m_tracking = m_paused = false;
     m_track_link.Empty();
     m_last_time = m_next_notify = m_track_position = 0L;
+    m_stream = NULL;
+    m_start_frame = 0;
+    m_track_seek = m_render_position = 0L;
+    m_beats.clear();
+    m_next_beat = 0;
 }
 
 // ----------------------------------------------------------------------------
@@ -108,7 +138,7 @@ void TrackTimer::resume()
 
 // ----------------------------------------------------------------------------
 //
-void TrackTimer::start( ULONG track_length, ULONG track_seek, LPCSTR track_link )
+void TrackTimer::start( ULONG track_length, ULONG track_seek, LPCSTR track_link, AudioOutputStream* stream, ULONGLONG start_frame )
 {
     CSingleLock lock( &m_lock, TRUE );
 
@@ -119,8 +149,91 @@ void TrackTimer::start( ULONG track_length, ULONG track_seek, LPCSTR track_link
     m_next_notify = 0L;
     m_track_position = track_seek;
     m_last_time = GetCurrentTime();
+    m_stream = stream;
+    m_start_frame = start_frame;
+    m_track_seek = m_render_position = track_seek;
+
+    m_beats.clear();
+    if ( m_saved_beats_link == track_link )
+        m_beats.swap( m_saved_beats );
+
+    m_saved_beats.clear();
+    m_saved_beats_link.Empty();
+
+    // Skip beats before the seek position
+    for ( m_next_beat=0; m_next_beat < m_beats.size() && m_beats[m_next_beat].time_ms < track_seek; m_next_beat++ )
+        ;
 
     lock.Unlock();
 
     m_engine->sendEvent( PlayerEvent::TRACK_PLAY, getTrackPosition(), m_track_link );
 }
+
+// ----------------------------------------------------------------------------
+// Beats found while the track is being analyzed (ignored if the track has beats already)
+//
+void TrackTimer::addBeats( LPCSTR track_link, const BeatArray& beats )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    if ( !m_tracking || m_track_link != track_link )
+        return;
+
+    for ( const BeatInfo& beat : beats ) {
+        if ( m_beats.empty() || beat.time_ms > m_beats.back().time_ms )
+            m_beats.push_back( beat );
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Saved beats for the track (replacing any found so far).  Beats for a track that has not
+// started are kept for start().
+//
+void TrackTimer::setBeats( LPCSTR track_link, const BeatArray& beats )
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    if ( !m_tracking || m_track_link != track_link ) {
+        m_saved_beats_link = track_link;
+        m_saved_beats = beats;
+        return;
+    }
+
+    m_beats = beats;
+
+    // Skip beats already played
+    ULONG render_position = updateRenderPosition();
+
+    for ( m_next_beat=0; m_next_beat < m_beats.size() && m_beats[m_next_beat].time_ms < render_position; m_next_beat++ )
+        ;
+}
+
+// ----------------------------------------------------------------------------
+//
+ULONG TrackTimer::getRenderPosition()
+{
+    CSingleLock lock( &m_lock, TRUE );
+
+    return m_tracking ? updateRenderPosition() : 0L;
+}
+
+// ----------------------------------------------------------------------------
+// Frames played since the track's first frame, at the stream's rate.  Until the device
+// reaches the track (the previous track's tail is still playing) it is at the seek point.
+// Called with m_lock held.
+//
+ULONG TrackTimer::updateRenderPosition()
+{
+    if ( m_stream == NULL || m_stream->getSamplesPerSecond() == 0 )
+        return m_track_position;
+
+    ULONGLONG played = m_stream->getPlayedFrames();
+
+    if ( played > m_start_frame ) {
+        ULONG position = (ULONG)min( (ULONGLONG)m_track_length, 
+            m_track_seek + ( played - m_start_frame ) * 1000 / m_stream->getSamplesPerSecond() );
+        m_render_position = max( m_render_position, position );
+    }
+
+    return m_render_position;
+}
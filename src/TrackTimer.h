@@ -23,6 +23,8 @@ MA 02111-1307, USA.
 #pragma once
 
 #include "Threadable.h"
+#include "BeatTracker.h"
+#include "AudioOutputStream.h"
 
 class SpotifyEngine;
 
@@ -40,8 +42,20 @@ class TrackTimer : public Threadable
     ULONG               m_track_length;             // Track total length
     ULONG               m_track_position;           // Current track position
 
+    AudioOutputStream*  m_stream;                   // Stream the track is rendered to
+    ULONGLONG           m_start_frame;              // Stream's delivered frames before the track's first
+    ULONG               m_track_seek;               // Track position of the first delivered frame
+    ULONG               m_render_position;          // Track position the device has played
+
+    BeatArray           m_beats;                    // Beats for the track (saved or as analyzed)
+    size_t              m_next_beat;                // Next beat to publish
+    CString             m_saved_beats_link;         // Track the saved beats below are for
+    BeatArray           m_saved_beats;              // Saved beats loaded before their track started
+
     virtual UINT run();
 
+    ULONG updateRenderPosition();
+
 public:
     TrackTimer( SpotifyEngine*  engine );
     ~TrackTimer();
@@ -54,11 +68,21 @@ public:
         return m_tracking ? m_track_length - m_track_position : 0L;
     }
 
+    // Track position of the audio the device is playing (the timer's position runs from
+    // the first delivery and leads it by the buffered audio)
+    ULONG getRenderPosition();
+
+    inline bool isTracking() const {
+        return m_tracking;
+    }
+
     inline bool isPaused() const {
         return m_paused;
     }
 
-    void start( ULONG track_length, ULONG track_seek, LPCSTR track_link );
+    void start( ULONG track_length, ULONG track_seek, LPCSTR track_link, AudioOutputStream* stream, ULONGLONG start_frame );
+    void addBeats( LPCSTR track_link, const BeatArray& beats );
+    void setBeats( LPCSTR track_link, const BeatArray& beats );
     void stop();
     void resume();
     void pause();
@@ -0,0 +1,222 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#include "stdafx.h"
+#include "WasapiAudioSink.h"
+
+// ----------------------------------------------------------------------------
+//
+WasapiAudioSink::WasapiAudioSink( LPCWSTR endpoint_id, LPCSTR name ) :
+    m_endpoint_id( endpoint_id ),
+    m_name( name ),
+    m_pEnumerator( NULL ),
+    m_pDevice( NULL ),
+    m_pAudioClient( NULL ),
+    m_pRenderClient( NULL ),
+    m_pwfx( NULL ),
+    m_bufferFrameCount( 0 ),
+    m_event_driven( false )
+{
+}
+
+// ----------------------------------------------------------------------------
+//
+WasapiAudioSink::~WasapiAudioSink(void)
+{
+    close();
+}
+
+// ----------------------------------------------------------------------------
+//
+void WasapiAudioSink::open( void )
+{
+    HRESULT hr;
+
+    hr = CoCreateInstance(
+           __uuidof(MMDeviceEnumerator), NULL,
+           CLSCTX_ALL, __uuidof(IMMDeviceEnumerator),
+           (void**)&m_pEnumerator);
+    AUDIO_OUTPUT_ASSERT( hr, "Cannot create COM device enumerator instance" );
+
+    hr = m_pEnumerator->GetDevice( m_endpoint_id, &m_pDevice );
+    AUDIO_OUTPUT_ASSERT( hr, "GetDevice %S failed", (LPCWSTR)m_endpoint_id );
+
+    activate();
+
+    hr = m_pAudioClient->GetMixFormat(&m_pwfx);                 // This is what the render device can do
+    AUDIO_OUTPUT_ASSERT( hr, "GetMixFormat failed" );
+}
+
+// ----------------------------------------------------------------------------
+//
+void WasapiAudioSink::activate( void )
+{
+    HRESULT hr = m_pDevice->Activate(
+                    __uuidof(IAudioClient), CLSCTX_ALL,
+                    NULL, (void**)&m_pAudioClient);
+    AUDIO_OUTPUT_ASSERT( hr, "Activate failed" );
+}
+
+// ----------------------------------------------------------------------------
+//
+void WasapiAudioSink::close( void )
+{
+    if ( m_pwfx ) {
+        CoTaskMemFree(m_pwfx);
+        m_pwfx = NULL;
+    }
+
+    SAFE_RELEASE(m_pEnumerator)
+    SAFE_RELEASE(m_pDevice)
+    SAFE_RELEASE(m_pAudioClient)
+    SAFE_RELEASE(m_pRenderClient)
+}
+
+// ----------------------------------------------------------------------------
+// Event driven streams ask for a buffer of one period and are woken by the engine; if the 
+// endpoint will not do that we start over with a fresh client in timer mode.
+//
+void WasapiAudioSink::initialize( const WAVEFORMATEX* format, bool auto_convert, bool event_driven, UINT period_ms )
+{
+    HRESULT hr;
+    DWORD stream_flags = auto_convert ? 0x80000000 : 0;     // AUDCLNT_STREAMFLAGS_AUTOCONVERTPCM | AUDCLNT_STREAMFLAGS_SRC_DEFAULT_QUALITY
+
+    m_event_driven = false;
+
+    if ( event_driven ) {
+        hr = m_pAudioClient->Initialize(
+                             AUDCLNT_SHAREMODE_SHARED,
+                             stream_flags | AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+                             (REFERENCE_TIME)period_ms * REFTIMES_PER_MILLISEC,
+                             0,
+                             format,
+                             NULL);
+
+        if ( SUCCEEDED(hr) )
+            hr = m_pAudioClient->SetEventHandle( m_buffer_event );
+
+        if ( SUCCEEDED(hr) )
+            m_event_driven = true;
+        else {
+            log_status( "Audio output stream %s event driven mode unavailable (0x%lx), using timer mode", (LPCSTR)m_name, hr );
+
+            SAFE_RELEASE(m_pAudioClient)                        // Cannot re-initialize a client
+            activate();
+        }
+    }
+
+    if ( !m_event_driven ) {
+        hr = m_pAudioClient->Initialize(
+                             AUDCLNT_SHAREMODE_SHARED,
+                             stream_flags,
+                             (REFERENCE_TIME)AUDIO_TIMER_BUFFER_MS * REFTIMES_PER_MILLISEC,
+                             0,
+                             format,
+                             NULL);
+
+        if ( AUDCLNT_E_UNSUPPORTED_FORMAT == hr ) {
+            AUDIO_OUTPUT_ASSERT( hr, "%s does not support [%d %d-bit channel(s) @ %dHz, format %X]", 
+                                     (LPCSTR)m_name, format->nChannels, format->wBitsPerSample, 
+                                     format->nSamplesPerSec, format->wFormatTag );
+        }
+        AUDIO_OUTPUT_ASSERT( hr, "Initialize failed" );
+    }
+
+    // Get the size of the allocated buffer.
+    hr = m_pAudioClient->GetBufferSize( &m_bufferFrameCount );
+    AUDIO_OUTPUT_ASSERT( hr, "GetBufferSize failed" );
+
+    hr = m_pAudioClient->GetService(
+                         __uuidof(IAudioRenderClient),
+                         (void**)&m_pRenderClient);
+
+    AUDIO_OUTPUT_ASSERT( hr, "GetService failed" );
+}
+
+// ----------------------------------------------------------------------------
+//
+UINT32 WasapiAudioSink::getPadding( void )
+{
+    UINT32 numFramesPadding;
+
+    HRESULT hr = m_pAudioClient->GetCurrentPadding( &numFramesPadding );
+    AUDIO_OUTPUT_ASSERT( hr, "GetCurrentPadding failed" );
+
+    return numFramesPadding;
+}
+
+// ----------------------------------------------------------------------------
+//
+BYTE* WasapiAudioSink::getBuffer( UINT32 frames )
+{
+    BYTE *pData;
+
+    HRESULT hr = m_pRenderClient->GetBuffer( frames, &pData );
+    AUDIO_OUTPUT_ASSERT( hr, "GetBuffer failed" );
+
+    return pData;
+}
+
+// ----------------------------------------------------------------------------
+//
+void WasapiAudioSink::releaseBuffer( UINT32 frames )
+{
+    HRESULT hr = m_pRenderClient->ReleaseBuffer( frames, 0 );
+    AUDIO_OUTPUT_ASSERT( hr, "ReleaseBuffer failed" );
+}
+
+// ----------------------------------------------------------------------------
+//
+void WasapiAudioSink::start( void )
+{
+    HRESULT hr = m_pAudioClient->Start(); 
+    AUDIO_OUTPUT_ASSERT( hr, "Start failed" );
+}
+
+// ----------------------------------------------------------------------------
+//
+void WasapiAudioSink::stop( void )
+{
+    HRESULT hr = m_pAudioClient->Stop();
+    AUDIO_OUTPUT_ASSERT( hr, "Stop failed" );
+}
+
+// ----------------------------------------------------------------------------
+//
+void WasapiAudioSink::reset( void )
+{
+    HRESULT hr = m_pAudioClient->Reset();  // Reset stream's clock & buffers
+    AUDIO_OUTPUT_ASSERT( hr, "Reset failed" );
+}
+
+// ----------------------------------------------------------------------------
+//
+bool WasapiAudioSink::waitForBuffer( HANDLE wake, DWORD timeout_ms )
+{
+    if ( !m_event_driven )
+        return ::WaitForSingleObject( wake, timeout_ms ) == WAIT_TIMEOUT;
+
+    HANDLE events[] = { m_buffer_event, wake };
+
+    return ::WaitForMultipleObjects( 2, events, FALSE, timeout_ms ) == WAIT_OBJECT_0;
+}
@@ -0,0 +1,82 @@
+/* 
+Copyright (C) 2018 Robert DeSantis
+hopluvr at gmail dot com
+
+This file is part of DMX Studio.
+
+DMX Studio is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3 of the License, or (at your
+option) any later version.
+
+DMX Studio is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with DMX Studio; see the file _COPYING.txt.  If not, write to
+the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+MA 02111-1307, USA.
+*/
+
+
+#pragma once
+
+#include "stdafx.h"
+#include "AudioSink.h"
+
+// WASAPI shared mode render endpoint
+
+class WasapiAudioSink : public AudioSink
+{
+    CStringW					m_endpoint_id;				// Device endpoint ID
+    CString                     m_name;
+
+    IMMDeviceEnumerator *		m_pEnumerator;
+    IMMDevice *					m_pDevice;
+    IAudioClient *				m_pAudioClient;
+    IAudioRenderClient *		m_pRenderClient;
+    WAVEFORMATEX *				m_pwfx;
+
+    UINT32						m_bufferFrameCount;
+    bool                        m_event_driven;
+    CEvent                      m_buffer_event;             // Signaled by the audio engine each period
+
+public:
+    WasapiAudioSink( LPCWSTR endpoint_id, LPCSTR name );
+    virtual ~WasapiAudioSink(void);
+
+    LPCSTR getName( void ) const {
+        return m_name;
+    }
+
+    const WAVEFORMATEX* getMixFormat( void ) const {
+        return m_pwfx;
+    }
+
+    bool isEventDriven( void ) const {
+        return m_event_driven;
+    }
+
+    UINT32 getBufferFrames( void ) const {
+        return m_bufferFrameCount;
+    }
+
+    void open( void );
+    void close( void );
+    void initialize( const WAVEFORMATEX* format, bool auto_convert, bool event_driven, UINT period_ms );
+
+    UINT32 getPadding( void );
+    BYTE* getBuffer( UINT32 frames );
+    void releaseBuffer( UINT32 frames );
+
+    void start( void );
+    void stop( void );
+    void reset( void );
+
+    bool waitForBuffer( HANDLE wake, DWORD timeout_ms );
+
+private:
+    void activate( void );
+};